@@ -43,6 +43,45 @@
  * */
 #define PP_NEXT_MULTIPLE(val, div) ((val) + (div) - (val) % (div))
 
+#ifdef PP_GRASS_LAZY
+
+/**
+ * @brief Is the grass of a cell alive? In the lazy representation each cell
+ * keeps the iteration at which its grass regrows, so that cells are only
+ * written when grass is eaten.
+ *
+ * @param g Iteration at which the cell grass regrows.
+ * @param iter Current iteration.
+ * */
+#define PP_GRASS_ALIVE(g, iter) ((g) <= (iter))
+
+/**
+ * @brief Value stored in a cell when its grass is eaten.
+ *
+ * @param iter Current iteration.
+ * @param restart Number of iterations it takes for grass to regrow.
+ * */
+#define PP_GRASS_EATEN(iter, restart) ((iter) + (restart))
+
+/**
+ * @brief Grass countdown value of a cell, i.e. the number of iterations
+ * until its grass regrows (zero if grass is alive).
+ *
+ * @param g Iteration at which the cell grass regrows.
+ * @param iter Current iteration.
+ * */
+#define PP_GRASS_COUNTDOWN(g, iter) ((g) > (iter) ? (g) - (iter) : 0)
+
+#else
+
+/* In the countdown representation each cell keeps the number of iterations
+ * until its grass regrows, decremented every iteration. */
+#define PP_GRASS_ALIVE(g, iter) ((g) == 0)
+#define PP_GRASS_EATEN(iter, restart) (restart)
+#define PP_GRASS_COUNTDOWN(g, iter) (g)
+
+#endif
+
 /** Sheep identifier. */
 #define SHEEP_ID 0x0
 
@@ -77,5 +116,44 @@ typedef struct pp_statistics_ocl {
 
 } PPStatisticsOcl;
 
+/**
+ * @brief Index, in the regrowth histogram, of the cells whose grass regrows
+ * in the given iteration.
+ *
+ * The regrowth histogram has one entry per iteration in a window of
+ * `restart` iterations. Cells whose grass is eaten in iteration `iter`
+ * regrow in iteration `iter + restart`, which has the same index as
+ * `iter`, so each entry can be reused as soon as it is consumed.
+ *
+ * @param iter Iteration in which grass regrows.
+ * @param restart Number of iterations it takes for grass to regrow.
+ * */
+#define PP_GRASS_REGROW_IDX(iter, restart) ((iter) % (restart))
+
+/**
+ * @brief Derive the grass statistics of an iteration from those of the
+ * previous iteration, in constant time.
+ *
+ * In each iteration, the countdown of every dead cell is decremented, the
+ * cells in the regrowth histogram entry of the iteration become alive, and
+ * the cells eaten by sheep die with a countdown of `restart`.
+ *
+ * @param grass Number of cells with live grass, in the previous iteration
+ * on input and in the given iteration on output.
+ * @param grass_en Total grass countdown value, in the previous iteration on
+ * input and in the given iteration on output.
+ * @param eaten Number of cells whose grass was eaten in the given iteration.
+ * @param regrow Regrowth histogram, updated with the eaten cells.
+ * @param iter Iteration, larger than zero.
+ * @param num_cells Number of cells.
+ * @param restart Number of iterations it takes for grass to regrow.
+ * */
+void pp_grass_stats_next(uint * grass, uint * grass_en, uint eaten,
+	__global uint * regrow, uint iter, uint num_cells, uint restart) {
 
+	uint idx = PP_GRASS_REGROW_IDX(iter, restart);
 
+	*grass_en = *grass_en - (num_cells - *grass) + eaten * restart;
+	*grass = *grass + regrow[idx] - eaten;
+	regrow[idx] = eaten;
+}
@@ -26,21 +26,79 @@
 #include "pp_cpu.h"
 
 /**
- * The default maximum number of agents: 16777216. Each agent requires
- * 16 bytes, thus by default 256Mb of memory will be allocated for the
- * agents buffer. A higher value may lead to faster simulations
- * given that it will increase the success rate of new agent
- * allocations, but on the other hand memory allocation and
- * initialization may take longer.
+ * The default maximum number of agents when the agents buffer is allocated
+ * up front, i.e. in the CSR engine and in the wavefront schedule: 16777216.
+ * Each agent requires 8 bytes, thus by default 128Mb of memory will be
+ * allocated for the agents buffer. Otherwise the agents buffer is grown on
+ * demand, and by default is only limited by the device.
  * */
 #define PPC_DEFAULT_MAX_AGENTS 16777216
 
+/**
+ * Size of each agent in the agents buffer, in either agent layout.
+ * */
+#define PPC_AGENT_SIZE 8
+
+/**
+ * Number of agents by which the agents buffer is grown, when grown on
+ * demand: 1048576, i.e. 8Mb at a time.
+ * */
+#define PPC_AGENTS_CHUNK 1048576
+
+/**
+ * Default number of agent slots in each slab handed out to work-items by
+ * the agent allocator. Each work-item needs at least one slab, so the
+ * maximum number of agents must be at least the global work size times the
+ * slab size.
+ * */
+#define PPC_DEFAULT_SLAB_SIZE 1024
+
 /**
  * Default maximum number of agents which can be shuffled in the same
  * loop.
  * */
 #define PPC_DEFAULT_MAX_AGENTS_SHUF 256
 
+/** Default agent layout in device memory. */
+#define PPC_DEFAULT_AG_LAYOUT "aos"
+
+/**
+ * Default simulation engine. The `list` engine keeps agents in per-cell
+ * linked lists, while the `csr` engine keeps the agents of each cell
+ * contiguous in memory, rebuilding the agents array after agents move.
+ * */
+#define PPC_DEFAULT_ENGINE "list"
+
+/**
+ * Default row scheduling of the list engine. The `static` schedule
+ * launches the step kernels once for each row turn, the `wavefront`
+ * schedule performs the complete simulation in a single launch, with
+ * work-items synchronizing with their neighbours through device-side
+ * progress flags, the `ondemand` schedule launches each step kernel once
+ * per iteration, with work-items taking blocks of rows from a device-side
+ * dispenser, the `tiled` schedule splits the environment in 2D tiles
+ * coloured as a four-colour checkerboard, launching the step 1 kernel once
+ * per colour, and the `atomic` schedule launches each step kernel once per
+ * iteration over the whole environment, with agents moving into their
+ * destination cells through atomic list insertion.
+ * */
+#define PPC_DEFAULT_SCHED "static"
+
+/** Default grass representation. */
+#define PPC_DEFAULT_GRASS "countdown"
+
+/** Default grass statistics mode. */
+#define PPC_DEFAULT_GRASS_STATS "inc"
+
+/**
+ * Default number of rows in each block dispensed in the on-demand
+ * schedule.
+ * */
+#define PPC_DEFAULT_BLOCK_ROWS 2
+
+/** Default tile width and height in the tiled schedule. */
+#define PPC_DEFAULT_TILE_SIZE 16
+
 /** A description of the program. */
 #define PPC_DESCRIPTION "OpenCL predator-prey simulation for the CPU"
 
@@ -98,8 +156,85 @@ typedef struct pp_c_args {
 	/** Maximum number of agents shuffled in the same loop. */
 	cl_uint max_agents_ptrs;
 
+	/** Number of agent slots in each allocator slab. */
+	cl_uint slab_size;
+
+	/** Agent layout in device memory. */
+	gchar * ag_layout;
+
+	/** Simulation engine. */
+	gchar * engine;
+
+	/** Row scheduling of the list engine. */
+	gchar * sched;
+
+	/** Number of rows in each block of the on-demand schedule. */
+	cl_uint block_rows;
+
+	/** Tile width in the tiled schedule. */
+	cl_uint tile_x;
+
+	/** Tile height in the tiled schedule. */
+	cl_uint tile_y;
+
+	/** Vector (of uints) width for grass kernel (0 means auto-detect). */
+	cl_uint vw_grass;
+
+	/** Gather work performed by each work-item? */
+	gboolean busy_stats;
+
+	/** Grass representation. */
+	gchar * grass;
+
+	/** Grass statistics mode. */
+	gchar * grass_stats;
+
 } PPCArgs;
 
+/**
+ * Agent layout in device memory, and the bytes of agent state touched per
+ * agent by each pass over the agents.
+ * */
+typedef struct pp_c_ag_layout {
+
+	/** Layout name. */
+	const char * name;
+
+	/** Compiler options which select the layout. */
+	const char * compiler_opts;
+
+	/** Bytes touched per agent when moving agents (step1). */
+	cl_uint move;
+
+	/** Bytes touched per agent when shuffling agents (step2). */
+	cl_uint shuffle;
+
+	/** Bytes touched per agent when agents act (step2). */
+	cl_uint act;
+
+	/** Bytes touched per agent checked by a wolf looking for sheep. */
+	cl_uint scan;
+
+	/** Number of separate arrays (i.e. cache lines, if agents are scattered
+	 * in memory) touched per agent. */
+	cl_uint arrays;
+
+} PPCAgLayout;
+
+/** Available agent layouts, with the bytes touched per agent by each pass of
+ * the list engine. In the array of structures layout any field access
+ * touches the whole 8-byte agent. In the structure of arrays layout agents
+ * are split into the 4-byte `next`, 2-byte `energy` and 2-byte `type|action`
+ * arrays. Moving, shuffling and acting each access all three fields, so
+ * those passes touch the same 8 bytes per agent in both layouts, over three
+ * arrays instead of one. Only the check of a sheep by a wolf, which reads
+ * its `next` and `energy` fields, touches fewer bytes. */
+static const PPCAgLayout ag_layouts[] = {
+	{"aos", "",                 8, 8, 8, 8, 1},
+	{"soa", "-D PPC_AG_SOA ",   8, 8, 8, 6, 3},
+	{NULL, NULL, 0, 0, 0, 0, 0}
+};
+
 /**
  * Work sizes for kernels step1 and step2, and other work/memory
  * sizes related to the simulation.
@@ -131,15 +266,43 @@ typedef struct pp_c_data_sizes {
 	/** Size of stats data structure. */
 	size_t stats;
 
+	/** Size of partial stats data structure. */
+	size_t stats_parts;
+
 	/** Size of matrix data structure. */
 	size_t matrix;
 
+	/** Size of grass data structure. */
+	size_t grass;
+
+	/** Size of grass regrowth histogram. */
+	size_t regrow;
+
 	/** Size of agents data structure. */
 	size_t agents;
 
 	/** Number of RNG seeds required for RNG. */
 	size_t rng_seeds_count;
 
+	/** Size of agent allocator state data structure. */
+	size_t allocs;
+
+	/** Size of cell agent ranges data structure (CSR engine only). */
+	size_t ranges;
+
+	/** Size of work-item partial sums data structure (CSR engine only). */
+	size_t sums;
+
+	/** Size of work-item progress data structure (wavefront schedule
+	 * only). */
+	size_t progress;
+
+	/** Size of block locks data structure (on-demand schedule only). */
+	size_t locks;
+
+	/** Size of work performed by each work-item data structure. */
+	size_t busy;
+
 } PPCDataSizes;
 
 /**
@@ -150,15 +313,57 @@ typedef struct pp_c_buffers_device {
 	/** Statistics. */
 	CCLBuffer * stats;
 
+	/** Partial statistics of each work-item. */
+	CCLBuffer * stats_parts;
+
 	/** Matrix of environment cells. */
 	CCLBuffer * matrix;
 
+	/** Grass countdown of each cell. */
+	CCLBuffer * grass;
+
+	/** Number of cells whose grass regrows in each of the next
+	 * iterations. */
+	CCLBuffer * regrow;
+
 	/** Array of agents. */
 	CCLBuffer * agents;
 
 	/** Array of RNG seeds. */
 	CCLBuffer * rng_seeds;
 
+	/** Agent allocator state of each work-item. */
+	CCLBuffer * allocs;
+
+	/** Counter of agent slabs handed out to work-items. */
+	CCLBuffer * slabs;
+
+	/** Rebuilt array of agents (CSR engine only). */
+	CCLBuffer * agents_swap;
+
+	/** Agent ranges of each cell (CSR engine only). */
+	CCLBuffer * ranges;
+
+	/** Agent ranges of each cell in the rebuilt agents array (CSR engine
+	 * only). */
+	CCLBuffer * ranges_swap;
+
+	/** Space required by the cells of each work-item in the rebuilt agents
+	 * array (CSR engine only). */
+	CCLBuffer * sums;
+
+	/** Progress of each work-item (wavefront schedule only). */
+	CCLBuffer * progress;
+
+	/** Block dispensers (on-demand schedule only). */
+	CCLBuffer * dispensers;
+
+	/** Block locks (on-demand schedule only). */
+	CCLBuffer * locks;
+
+	/** Work performed by each work-item. */
+	CCLBuffer * busy;
+
 } PPCBuffersDevice;
 
 /** Command line arguments and respective default values. */
@@ -167,7 +372,9 @@ static PPCArgs args = {NULL, NULL,
 	NULL,
 #endif
 	NULL, 0, 0, -1, FALSE, PP_DEFAULT_SEED,
-	NULL, PPC_DEFAULT_MAX_AGENTS, PPC_DEFAULT_MAX_AGENTS_SHUF};
+	NULL, 0, PPC_DEFAULT_MAX_AGENTS_SHUF,
+	PPC_DEFAULT_SLAB_SIZE, NULL, NULL, NULL, PPC_DEFAULT_BLOCK_ROWS,
+	PPC_DEFAULT_TILE_SIZE, PPC_DEFAULT_TILE_SIZE, 0, FALSE, NULL, NULL};
 
 /** Valid command line options. */
 static GOptionEntry entries[] = {
@@ -206,37 +413,208 @@ static GOptionEntry entries[] = {
 		"Random number generator: " CLO_RNG_IMPLS " (default is " PP_RNG_DEFAULT ")",
 		"RNG"},
 	{"max-agents",      'm', 0, G_OPTION_ARG_INT,      &args.max_agents,
-		"Maximum number of agents (default is " G_STRINGIFY(PPC_DEFAULT_MAX_AGENTS) ")",
+		"Maximum number of agents (default is " G_STRINGIFY(PPC_DEFAULT_MAX_AGENTS) \
+		" in the csr engine and wavefront schedule, otherwise only limited " \
+		"by the device, as the agents buffer is grown on demand)",
 		"SIZE"},
 	{"max-agents-shuff",'u', 0, G_OPTION_ARG_INT,      &args.max_agents_ptrs,
 		"Maximum number of agents which can be shuffled in the same " \
 		"loop (default is " G_STRINGIFY(PPC_DEFAULT_MAX_AGENTS_SHUF) "). If "
 		"set to 1 or 0, shuffling is disabled.",
 		"SIZE"},
+	{"slab-size",       'b', 0, G_OPTION_ARG_INT,      &args.slab_size,
+		"Number of agent slots in each slab handed out to work-items by the " \
+		"agent allocator (default is " G_STRINGIFY(PPC_DEFAULT_SLAB_SIZE) ")",
+		"SIZE"},
+	{"agent-layout",    'a', 0, G_OPTION_ARG_STRING,   &args.ag_layout,
+		"Agent layout in device memory: aos (array of structures) or soa " \
+		"(structure of arrays within each slab) (default is " \
+		PPC_DEFAULT_AG_LAYOUT ")",
+		"LAYOUT"},
+	{"engine",          'e', 0, G_OPTION_ARG_STRING,   &args.engine,
+		"Simulation engine: list (agents in per-cell linked lists) or csr " \
+		"(agents of each cell stored contiguously, array rebuilt after " \
+		"agents move) (default is " PPC_DEFAULT_ENGINE ")",
+		"ENGINE"},
+	{"sched",           'w', 0, G_OPTION_ARG_STRING,   &args.sched,
+		"Row scheduling of the list engine: static (one launch per row " \
+		"turn), wavefront (single launch, work-items wait for their " \
+		"neighbours), ondemand (one launch per step, work-items take " \
+		"blocks of rows on demand), tiled (2D tiles in a four-colour " \
+		"checkerboard, one step 1 launch per colour) or atomic (one " \
+		"launch per step over all cells, agents moved with atomic list " \
+		"insertion) (default is " PPC_DEFAULT_SCHED ")",
+		"SCHED"},
+	{"block-rows",      'k', 0, G_OPTION_ARG_INT,      &args.block_rows,
+		"Number of rows in each block of the ondemand row scheduling, at " \
+		"least 2 (default is " G_STRINGIFY(PPC_DEFAULT_BLOCK_ROWS) ")",
+		"SIZE"},
+	{"tile-x",          'x', 0, G_OPTION_ARG_INT,      &args.tile_x,
+		"Tile width in the tiled row scheduling, at least 2 (default is " \
+		G_STRINGIFY(PPC_DEFAULT_TILE_SIZE) ")",
+		"SIZE"},
+	{"tile-y",          'y', 0, G_OPTION_ARG_INT,      &args.tile_y,
+		"Tile height in the tiled row scheduling, at least 2 (default is " \
+		G_STRINGIFY(PPC_DEFAULT_TILE_SIZE) ")",
+		"SIZE"},
+	{"vw-grass",          0, 0, G_OPTION_ARG_INT,      &args.vw_grass,
+		"Vector (of uints) width for grass kernel, 1, 2, 4, 8 or 16, default "
+		"is 0 (auto-detect)",
+		"WIDTH"},
+	{"busy-stats",        0, 0, G_OPTION_ARG_NONE,     &args.busy_stats,
+		"Gather and show the work performed by each work-item in the list " \
+		"engine",
+		NULL},
+	{"grass",             0, 0, G_OPTION_ARG_STRING,   &args.grass,
+		"Grass representation: countdown (each cell keeps the iterations " \
+		"until its grass regrows, decremented every iteration) or lazy " \
+		"(each cell keeps the iteration at which its grass regrows, only " \
+		"written when grass is eaten) (default is " PPC_DEFAULT_GRASS ")",
+		"GRASS"},
+	{"grass-stats",       0, 0, G_OPTION_ARG_STRING,   &args.grass_stats,
+		"Grass statistics: inc (derived from the cells eaten in each " \
+		"iteration and a histogram of regrowth iterations) or full " \
+		"(gathered from all cells, for validation) (default is " \
+		PPC_DEFAULT_GRASS_STATS ")",
+		"MODE"},
 	{G_OPTION_REMAINING, 0,  0, G_OPTION_ARG_CALLBACK, pp_args_fail,
 		NULL, NULL},
 	{ NULL, 0, 0, 0, NULL, NULL, NULL }
 };
 
+/**
+ * Find agent layout with the given name.
+ *
+ * @param[in] name Agent layout name.
+ * @return The agent layout with the given name, or `NULL` if there is no
+ * such layout.
+ * */
+static const PPCAgLayout * ppc_ag_layout_find(const char * name) {
+
+	/* Agent layout. */
+	const PPCAgLayout * layout;
+
+	/* Search for layout with the given name. */
+	for (layout = ag_layouts; layout->name; ++layout) {
+		if (g_strcmp0(layout->name, name) == 0)
+			return layout;
+	}
+
+	/* Layout not found. */
+	return NULL;
+}
+
+/**
+ * Is the CSR simulation engine selected?
+ *
+ * @param[in] args Parsed command line arguments.
+ * @return `TRUE` if the CSR engine is selected, `FALSE` otherwise.
+ * */
+static gboolean ppc_engine_is_csr(PPCArgs args) {
+	return g_strcmp0(args.engine, "csr") == 0;
+}
+
+/**
+ * Is the given row scheduling selected?
+ *
+ * @param[in] args Parsed command line arguments.
+ * @param[in] sched Row scheduling name.
+ * @return `TRUE` if the given row scheduling is selected, `FALSE`
+ * otherwise.
+ * */
+static gboolean ppc_sched_is(PPCArgs args, const char * sched) {
+	return g_strcmp0(args.sched, sched) == 0;
+}
+
+/**
+ * Is the lazy grass representation selected? In this case the grass kernel
+ * is not launched, and agent actions compare the iteration at which grass
+ * regrows with the current iteration.
+ *
+ * @param[in] args Parsed command line arguments.
+ * @return `TRUE` if the lazy grass representation is selected, `FALSE`
+ * otherwise.
+ * */
+static gboolean ppc_grass_is_lazy(PPCArgs args) {
+	return g_strcmp0(args.grass, "lazy") == 0;
+}
+
+/**
+ * Are grass statistics derived incrementally, from the cells eaten in each
+ * iteration, instead of being gathered from all cells?
+ *
+ * @param[in] args Parsed command line arguments.
+ * @return `TRUE` if grass statistics are derived incrementally, `FALSE`
+ * otherwise.
+ * */
+static gboolean ppc_grass_stats_is_inc(PPCArgs args) {
+	return g_strcmp0(args.grass_stats, "inc") == 0;
+}
+
+/**
+ * Is the agents buffer grown on demand? This is the case in the list engine,
+ * except for the wavefront schedule, where the simulation is performed by a
+ * single kernel launch.
+ *
+ * @param[in] args Parsed command line arguments.
+ * @return `TRUE` if the agents buffer is grown on demand, `FALSE` if it is
+ * allocated up front.
+ * */
+static gboolean ppc_agents_growable(PPCArgs args) {
+	return !ppc_engine_is_csr(args) && !ppc_sched_is(args, "wavefront");
+}
+
 /**
  * Determine effective worksizes to use in simulation.
  *
  * @param[in] args Parsed command line arguments.
  * @param[in] workSizes Work sizes for kernels step1 and step2, and other
  * work/memory sizes related to the simulation.
+ * @param[in] num_cols Number of columns in (width of) simulation
+ * environment.
  * @param[in] num_rows Number of rows in (height of) simulation environment.
+ * @param[in] cu Number of device compute units.
  * @param[out] err Return location for a GError.
  * */
 static void ppc_worksizes_calc(PPCArgs args, PPCWorkSizes * workSizes,
-	cl_uint num_rows, GError ** err) {
+	cl_uint num_cols, cl_uint num_rows, cl_uint cu, GError ** err) {
 
 	/* Get local work size. */
 	workSizes->lws = args.lws;
 
 	/* Determine maximum number of global work-items which can be used for
-	 * current problem (each pair of work-items must process rows which are
-	 * separated by two rows not being processed) */
-	workSizes->max_gws = num_rows / PPC_D_MIN;
+	 * current problem. In the list engine, each pair of work-items must
+	 * process rows which are separated by two rows not being processed. In
+	 * the CSR engine, cells can be processed in any order, but each
+	 * work-item should process at least one row worth of cells. The same
+	 * applies to the atomic schedule of the list engine. */
+	workSizes->max_gws =
+		ppc_engine_is_csr(args) || ppc_sched_is(args, "atomic")
+		? num_rows : num_rows / PPC_D_MIN;
+
+	/* In the tiled schedule, each work-item processes at least one of the
+	 * tiles of the current colour. There is an even number of tiles along
+	 * each dimension, and each colour has a quarter of them. */
+	if (ppc_sched_is(args, "tiled")) {
+		g_if_err_create_goto(*err, PP_ERROR,
+			(num_cols / args.tile_x < 2) || (num_rows / args.tile_y < 2),
+			PP_INVALID_ARGS, error_handler,
+			"There must be at least two tiles along each dimension.");
+		workSizes->max_gws = (num_cols / args.tile_x / 2)
+			* (num_rows / args.tile_y / 2);
+	}
+
+	/* In the wavefront and on-demand schedules all work-items must run
+	 * concurrently, as they wait for each other. As such, each work-item must
+	 * be in its own work-group, and there can be no more work-items than
+	 * compute units. */
+	if (ppc_sched_is(args, "wavefront") || ppc_sched_is(args, "ondemand")) {
+		g_if_err_create_goto(*err, PP_ERROR, workSizes->lws > 1,
+			PP_INVALID_ARGS, error_handler,
+			"The %s schedule requires a local work size of 1.", args.sched);
+		workSizes->lws = 1;
+		workSizes->max_gws = MIN(workSizes->max_gws, cu);
+	}
 
 	/* Determine effective number of global work-items to use. */
 	if (args.gws > 0) {
@@ -347,6 +725,9 @@ static void ppc_simulation_info_print(CCLDevice * dev,
 	PPCWorkSizes workSizes, PPCArgs args, gchar * compiler_opts,
 	GError ** err) {
 
+	/* Agent layout. */
+	const PPCAgLayout * layout;
+
 	/* Error reporting object. */
 	GError* err_internal = NULL;
 
@@ -372,6 +753,36 @@ static void ppc_simulation_info_print(CCLDevice * dev,
 	/* ...Maximum number of agents */
 	printf("     Maximum number of agents   : %d\n",
 		(int) workSizes.max_agents);
+	/* ...Agent slab size */
+	printf("     Agent slab size            : %d\n", (int) args.slab_size);
+	/* ...Agent layout */
+	printf("     Agent layout               : %s\n", args.ag_layout);
+	/* ...Simulation engine */
+	printf("     Simulation engine          : %s\n", args.engine);
+	/* ...Row scheduling */
+	if (!ppc_engine_is_csr(args))
+		printf("     Row scheduling             : %s\n", args.sched);
+	/* ...Rows per block */
+	if (ppc_sched_is(args, "ondemand"))
+		printf("     Rows per block             : %d\n", args.block_rows);
+	/* ...Grass representation */
+	printf("     Grass representation       : %s\n", args.grass);
+	/* ...Grass vector width */
+	if (!ppc_grass_is_lazy(args))
+		printf("     Grass vector width         : %d\n", args.vw_grass);
+	/* ...Grass statistics */
+	printf("     Grass statistics           : %s\n", args.grass_stats);
+	/* ...Tile size */
+	if (ppc_sched_is(args, "tiled"))
+		printf("     Tile size                  : %dx%d\n", args.tile_x,
+			args.tile_y);
+	/* ...Bytes touched per agent for each agent layout */
+	for (layout = ag_layouts; layout->name; ++layout) {
+		printf("     Agent bytes (%s)          : move %d, shuffle %d, "
+			"act %d, scan %d (%d array%s)\n", layout->name, layout->move,
+			layout->shuffle, layout->act, layout->scan, layout->arrays,
+			layout->arrays > 1 ? "s" : "");
+	}
 	/* ...RNG seed */
 	printf("     Random seed                : %u\n", args.rng_seed);
 	/* ...Compiler options (out of table) */
@@ -394,6 +805,43 @@ finish:
 
 }
 
+/**
+ * Determine the number of slabs the agents buffer should have, so that the
+ * agent allocator doesn't run out of slabs in the next iteration. Agents
+ * reproduce at most once per iteration, so the newborns never require more
+ * slabs than those already handed out, plus a new slab for each work-item
+ * whose current slab is partially used. The result is rounded up to a whole
+ * number of chunks.
+ *
+ * @param[in] slabs_used Number of slabs already handed out.
+ * @param[in] gws Global work size.
+ * @return Number of slabs the agents buffer should have.
+ * */
+static size_t ppc_agents_slabs_required(size_t slabs_used, size_t gws) {
+
+	/* Number of slabs in each chunk. */
+	size_t chunk = MAX(PPC_AGENTS_CHUNK / args.slab_size, 1);
+
+	/* Round up to a whole number of chunks. */
+	return ((2 * slabs_used + gws + chunk - 1) / chunk) * chunk;
+}
+
+/**
+ * Bound the number of slabs the agents buffer should have, so that the agent
+ * allocator doesn't run out of slabs in the next two iterations.
+ *
+ * @param[in] slabs_used Number of slabs already handed out.
+ * @param[in] gws Global work size.
+ * @param[in] max_slabs Maximum number of slabs in the agents buffer.
+ * @return Number of slabs the agents buffer should have.
+ * */
+static cl_uint ppc_agents_slabs_bound(size_t slabs_used, size_t gws,
+	cl_uint max_slabs) {
+
+	return MIN(ppc_agents_slabs_required(
+		ppc_agents_slabs_required(slabs_used, gws), gws), max_slabs);
+}
+
 /**
  * Determine buffer sizes.
  *
@@ -407,11 +855,57 @@ static void ppc_datasizes_get(PPParameters params,
 	/* Statistics */
 	dataSizes->stats = (params.iters + 1) * sizeof(PPStatistics);
 
-	/* Matrix (each cell in device occupies 8 bytes). */
+	/* Partial statistics of each work-item, which are reduced once per
+	 * iteration. In the wavefront schedule the simulation runs in a single
+	 * launch, so the partial statistics of all iterations are kept and
+	 * reduced at the end. */
+	dataSizes->stats_parts = ws.gws * sizeof(PPStatistics)
+		* (ppc_sched_is(args, "wavefront") ? params.iters + 1 : 1);
+
+	/* Matrix (each cell in device occupies 8 bytes: one agent list per
+	 * agent type). */
 	dataSizes->matrix = params.grid_x * params.grid_y * 8;
 
-	/* Agents (each agent in device occupies 16 bytes). */
-	dataSizes->agents = ws.max_agents * 16;
+	/* Grass (each cell in device occupies 4 bytes), padded to a multiple of
+	 * the grass kernel vector width. */
+	dataSizes->grass =
+		pp_next_multiple(params.grid_x * params.grid_y, args.vw_grass)
+		* sizeof(cl_uint);
+
+	/* Grass regrowth histogram (one 4 byte counter for each of the
+	 * iterations grass takes to regrow). */
+	dataSizes->regrow = MAX(params.grass_restart, 1) * sizeof(cl_uint);
+
+	/* Agents (each agent in device occupies 8 bytes). If the agents buffer is
+	 * grown on demand, start with enough space for the initial agents to
+	 * double, plus a partially used slab for each work-item. */
+	if (ppc_agents_growable(args)) {
+		dataSizes->agents = MIN(ppc_agents_slabs_required(
+			(params.init_sheep + params.init_wolves + args.slab_size - 1)
+			/ args.slab_size + ws.gws, ws.gws),
+			ws.max_agents / args.slab_size)
+			* args.slab_size * PPC_AGENT_SIZE;
+	} else {
+		dataSizes->agents = ws.max_agents * PPC_AGENT_SIZE;
+	}
+
+	/* Agent allocator state (each work-item state occupies 12 bytes). */
+	dataSizes->allocs = ws.gws * 12;
+
+	/* Cell agent ranges (each cell range occupies 8 bytes). */
+	dataSizes->ranges = params.grid_x * params.grid_y * 8;
+
+	/* Work-item partial sums (each sum occupies 4 bytes). */
+	dataSizes->sums = ws.gws * sizeof(cl_uint);
+
+	/* Work-item progress (each progress value occupies 4 bytes). */
+	dataSizes->progress = ws.gws * sizeof(cl_uint);
+
+	/* Block locks (each lock occupies 4 bytes). */
+	dataSizes->locks = (params.grid_y / args.block_rows) * sizeof(cl_uint);
+
+	/* Work performed by each work-item (each counter occupies 8 bytes). */
+	dataSizes->busy = ws.gws * sizeof(cl_ulong);
 
 }
 
@@ -445,6 +939,10 @@ static void ppc_buffers_init(CCLContext * ctx, CCLQueue * cq,
 	/* Zero pattern. */
 	const cl_uchar zero = 0;
 
+	/* Number of slabs which fit in the agents buffer. */
+	const cl_uint num_slabs =
+		dataSizes.agents / (args.slab_size * PPC_AGENT_SIZE);
+
 	/* ************************* */
 	/* Initialize device buffers */
 	/* ************************* */
@@ -455,12 +953,28 @@ static void ppc_buffers_init(CCLContext * ctx, CCLQueue * cq,
 		NULL, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
-	/* Grass matrix */
+	/* Partial statistics, initially zero. */
+	buffersDevice->stats_parts = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+		dataSizes.stats_parts, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Cell matrix */
 	buffersDevice->matrix = ccl_buffer_new(ctx,
 		CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, dataSizes.matrix,
 		NULL, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
+	/* Grass */
+	buffersDevice->grass = ccl_buffer_new(ctx,
+		CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, dataSizes.grass,
+		NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Grass regrowth histogram, filled by the init kernel. */
+	buffersDevice->regrow = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+		dataSizes.regrow, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
 	/* Get RNG seeds from the CL_Ops RNG. */
 	buffersDevice->rng_seeds = clo_rng_get_device_seeds(rng_clo);
 
@@ -470,6 +984,68 @@ static void ppc_buffers_init(CCLContext * ctx, CCLQueue * cq,
 		NULL, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
+	/* Agent allocator state, initialized by the init kernel. */
+	buffersDevice->allocs = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+		dataSizes.allocs, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Counter of agent slabs handed out to work-items, followed by the
+	 * number of slabs available. */
+	buffersDevice->slabs = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+		2 * sizeof(cl_uint), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Buffers required by the CSR engine. */
+	if (ppc_engine_is_csr(args)) {
+
+		/* Rebuilt agent array */
+		buffersDevice->agents_swap = ccl_buffer_new(ctx,
+			CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, dataSizes.agents,
+			NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Cell agent ranges, initialized by the init kernel. */
+		buffersDevice->ranges = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+			dataSizes.ranges, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Cell agent ranges in the rebuilt agent array. */
+		buffersDevice->ranges_swap = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+			dataSizes.ranges, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Work-item partial sums. */
+		buffersDevice->sums = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+			dataSizes.sums, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	}
+
+	/* Progress of each work-item in the wavefront schedule. */
+	if (ppc_sched_is(args, "wavefront")) {
+		buffersDevice->progress = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+			dataSizes.progress, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
+
+	/* Block dispensers and locks of the on-demand schedule. */
+	if (ppc_sched_is(args, "ondemand")) {
+
+		buffersDevice->dispensers = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+			2 * sizeof(cl_uint), NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		buffersDevice->locks = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+			dataSizes.locks, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	}
+
+	/* Work performed by each work-item. */
+	buffersDevice->busy = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+		dataSizes.busy, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
 	/* ************************************************************** */
 	/* Set buffers contents to zero. Nothing in the OpenCL spec. says */
 	/* that new buffers have zero'ed contents, so we do this just in  */
@@ -481,16 +1057,85 @@ static void ppc_buffers_init(CCLContext * ctx, CCLQueue * cq,
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 	ccl_event_set_name(evt, "Fill: stats");
 
-	evt = ccl_buffer_enqueue_fill(buffersDevice->agents, cq, &zero,
-		sizeof(cl_uchar), 0, dataSizes.agents, NULL, &err_internal);
+	evt = ccl_buffer_enqueue_fill(buffersDevice->stats_parts, cq, &zero,
+		sizeof(cl_uchar), 0, dataSizes.stats_parts, NULL, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
-	ccl_event_set_name(evt, "Fill: agents");
+	ccl_event_set_name(evt, "Fill: stats_parts");
+
+	/* Agents are always written before being read, so the agent buffers are
+	 * not cleared, which would touch all of their pages up front. */
 
 	evt = ccl_buffer_enqueue_fill(buffersDevice->matrix, cq, &zero,
 		sizeof(cl_uchar), 0, dataSizes.matrix, NULL, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 	ccl_event_set_name(evt, "Fill: matrix");
 
+	/* Padding cells of the grass buffer must be zero. */
+	evt = ccl_buffer_enqueue_fill(buffersDevice->grass, cq, &zero,
+		sizeof(cl_uchar), 0, dataSizes.grass, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Fill: grass");
+
+	/* No grass regrows until the init kernel says so. */
+	evt = ccl_buffer_enqueue_fill(buffersDevice->regrow, cq, &zero,
+		sizeof(cl_uchar), 0, dataSizes.regrow, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Fill: regrow");
+
+	/* No slabs have been handed out... */
+	evt = ccl_buffer_enqueue_fill(buffersDevice->slabs, cq, &zero,
+		sizeof(cl_uchar), 0, sizeof(cl_uint), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Fill: slabs");
+
+	/* ...and all slabs in the agents buffer are available. */
+	evt = ccl_buffer_enqueue_fill(buffersDevice->slabs, cq, &num_slabs,
+		sizeof(cl_uint), sizeof(cl_uint), sizeof(cl_uint), NULL,
+		&err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Fill: slabs available");
+
+	if (ppc_engine_is_csr(args)) {
+
+		/* The agent counters in the rebuilt ranges must start at zero. */
+		evt = ccl_buffer_enqueue_fill(buffersDevice->ranges_swap, cq, &zero,
+			sizeof(cl_uchar), 0, dataSizes.ranges, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Fill: ranges_swap");
+
+	}
+
+	if (buffersDevice->progress) {
+
+		/* Work-items start with no progress. */
+		evt = ccl_buffer_enqueue_fill(buffersDevice->progress, cq, &zero,
+			sizeof(cl_uchar), 0, dataSizes.progress, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Fill: progress");
+
+	}
+
+	if (buffersDevice->dispensers) {
+
+		/* Dispensers start from the first block... */
+		evt = ccl_buffer_enqueue_fill(buffersDevice->dispensers, cq, &zero,
+			sizeof(cl_uchar), 0, 2 * sizeof(cl_uint), NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Fill: dispensers");
+
+		/* ...and blocks start unlocked. */
+		evt = ccl_buffer_enqueue_fill(buffersDevice->locks, cq, &zero,
+			sizeof(cl_uchar), 0, dataSizes.locks, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Fill: locks");
+
+	}
+
+	evt = ccl_buffer_enqueue_fill(buffersDevice->busy, cq, &zero,
+		sizeof(cl_uchar), 0, dataSizes.busy, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Fill: busy");
+
 	/* If we got here, everything is OK. */
 	g_assert(*err == NULL);
 	goto finish;
@@ -510,13 +1155,14 @@ finish:
 }
 
 /**
- * Set fixed kernel arguments.
+ * Set fixed kernel arguments for the CSR engine. Arguments which swap
+ * between buffers in each iteration are set during the simulation.
  *
  * @param[in] prg Program wrapper.
  * @param[in] buffersDevice Device buffers.
  * @param[out] err Return location for a GError.
  * */
-static void ppc_kernelargs_set(CCLProgram * prg,
+static void ppc_kernelargs_set_csr(CCLProgram * prg,
 	PPCBuffersDevice * buffersDevice, GError ** err) {
 
 	/* Internal error handling object. */
@@ -524,31 +1170,50 @@ static void ppc_kernelargs_set(CCLProgram * prg,
 
 	/* Kernel wrappers. */
 	CCLKernel * init_krnl = NULL;
-	CCLKernel * step1_krnl = NULL;
+	CCLKernel * move_krnl = NULL;
+	CCLKernel * scan1_krnl = NULL;
+	CCLKernel * scan2_krnl = NULL;
+	CCLKernel * scatter_krnl = NULL;
 	CCLKernel * step2_krnl = NULL;
 
 	/* Get kernels. */
-	init_krnl = ccl_program_get_kernel(prg, "init", &err_internal);
+	init_krnl = ccl_program_get_kernel(prg, "csr_init", &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
-	step1_krnl = ccl_program_get_kernel(prg, "step1", &err_internal);
+	move_krnl = ccl_program_get_kernel(prg, "csr_move", &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
-	step2_krnl = ccl_program_get_kernel(prg, "step2", &err_internal);
+	scan1_krnl = ccl_program_get_kernel(prg, "csr_scan1", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	scan2_krnl = ccl_program_get_kernel(prg, "csr_scan2", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	scatter_krnl = ccl_program_get_kernel(prg, "csr_scatter", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	step2_krnl = ccl_program_get_kernel(prg, "csr_step2", &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
 	/* Init kernel. */
 	ccl_kernel_set_args(init_krnl, buffersDevice->agents,
-		buffersDevice->matrix, buffersDevice->stats,
+		buffersDevice->grass, buffersDevice->ranges,
+		buffersDevice->stats_parts, buffersDevice->rng_seeds,
+		buffersDevice->regrow, NULL);
+
+	/* Move kernel - Move agents, count agents per cell. */
+	ccl_kernel_set_args(move_krnl, ccl_arg_skip, ccl_arg_skip, ccl_arg_skip,
 		buffersDevice->rng_seeds, NULL);
 
-	/* Step1 kernel - Move agents, grow grass. */
-	ccl_kernel_set_args(step1_krnl, buffersDevice->agents,
-		buffersDevice->matrix, buffersDevice->rng_seeds, ccl_arg_skip,
+	/* Scan kernels - Determine where agents of each cell will be placed. */
+	ccl_kernel_set_args(scan1_krnl, ccl_arg_skip, buffersDevice->sums,
 		NULL);
+	ccl_kernel_set_args(scan2_krnl, ccl_arg_skip, buffersDevice->sums,
+		NULL);
+
+	/* Scatter kernel - Rebuild agents array. */
+	ccl_kernel_set_args(scatter_krnl, ccl_arg_skip, ccl_arg_skip,
+		ccl_arg_skip, ccl_arg_skip, buffersDevice->stats_parts, NULL);
 
 	/* Step2 kernel - Agent actions, get stats. */
-	ccl_kernel_set_args(step2_krnl, buffersDevice->agents,
-		buffersDevice->matrix, buffersDevice->rng_seeds,
-		buffersDevice->stats, ccl_arg_skip, ccl_arg_skip, NULL);
+	ccl_kernel_set_args(step2_krnl, ccl_arg_skip, buffersDevice->grass,
+		ccl_arg_skip, ccl_arg_skip, buffersDevice->rng_seeds,
+		buffersDevice->stats_parts, ccl_arg_skip, NULL);
 
 	/* If we got here, everything is OK. */
 	g_assert(*err == NULL);
@@ -565,17 +1230,14 @@ finish:
 }
 
 /**
- * Perform simulation!
+ * Set fixed kernel arguments.
  *
- * @param[in] workSizes Work sizes for kernels step1 and step2, and
- * other work/memory sizes related to the simulation.
- * @param[in] params Simulation parameters.
- * @param[in] cq Command queue wrapper.
  * @param[in] prg Program wrapper.
+ * @param[in] buffersDevice Device buffers.
  * @param[out] err Return location for a GError.
  * */
-static void ppc_simulate(PPCWorkSizes workSizes, PPParameters params,
-	CCLQueue * cq, CCLProgram* prg, GError ** err) {
+static void ppc_kernelargs_set(CCLProgram * prg,
+	PPCBuffersDevice * buffersDevice, GError ** err) {
 
 	/* Internal error handling object. */
 	GError * err_internal = NULL;
@@ -584,61 +1246,710 @@ static void ppc_simulate(PPCWorkSizes workSizes, PPParameters params,
 	CCLKernel * init_krnl = NULL;
 	CCLKernel * step1_krnl = NULL;
 	CCLKernel * step2_krnl = NULL;
+	CCLKernel * step_krnl = NULL;
+	CCLKernel * grass_krnl = NULL;
+	CCLKernel * reduce_krnl = NULL;
+	CCLKernel * grass_stats_krnl = NULL;
 
-	/* Event wrapper. */
-	CCLEvent * evt = NULL;
+	/* Grass kernel - Grow grass, used by both engines. */
+	grass_krnl = ccl_program_get_kernel(prg, "grass", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_kernel_set_args(grass_krnl, buffersDevice->grass, NULL);
 
-	/* Current iteration. */
-	cl_uint iter;
+	/* Statistics reduction kernel - Reduce partial stats, used by both
+	 * engines. */
+	reduce_krnl = ccl_program_get_kernel(prg, "stats_reduce", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_kernel_set_args(reduce_krnl, buffersDevice->stats,
+		buffersDevice->stats_parts, ccl_arg_skip, ccl_arg_skip, NULL);
+
+	/* Incremental grass statistics kernel - Derive grass stats from the
+	 * cells eaten, used by both engines. */
+	if (ppc_grass_stats_is_inc(args)) {
+		grass_stats_krnl =
+			ccl_program_get_kernel(prg, "stats_grass", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_kernel_set_args(grass_stats_krnl, buffersDevice->stats,
+			buffersDevice->regrow, ccl_arg_skip, ccl_arg_skip, NULL);
+	}
 
-    /* If local work group size is not given or is 0, set it to NULL and
-     * let OpenCL decide. */
-	size_t * local_size = (workSizes.lws > 0 ? &workSizes.lws : NULL);
+	/* The CSR engine has its own kernels. */
+	if (ppc_engine_is_csr(args)) {
+		ppc_kernelargs_set_csr(prg, buffersDevice, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		goto finish;
+	}
 
-	/* Get initialization kernel. */
+	/* Get kernels. */
 	init_krnl = ccl_program_get_kernel(prg, "init", &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
-
-	/* Get step1 kernel. */
 	step1_krnl = ccl_program_get_kernel(prg, "step1", &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
-
-	/* Get step2 kernel. */
 	step2_krnl = ccl_program_get_kernel(prg, "step2", &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
-	/* Launch initialization kernel. */
-	evt = ccl_kernel_enqueue_ndrange(init_krnl, cq, 1, NULL,
-		&workSizes.gws, local_size, NULL, &err_internal);
-	g_if_err_propagate_goto(err, err_internal, error_handler);
-	ccl_event_set_name(evt, "K: init");
+	/* Init kernel. */
+	ccl_kernel_set_args(init_krnl, buffersDevice->agents,
+		buffersDevice->matrix, buffersDevice->grass,
+		buffersDevice->stats_parts, buffersDevice->rng_seeds,
+		buffersDevice->allocs, buffersDevice->slabs, buffersDevice->regrow,
+		NULL);
 
-	/* Simulation loop. */
-	for (iter = 1; iter <= params.iters; iter++) {
+	/* Step1 kernel - Move agents. */
+	ccl_kernel_set_args(step1_krnl, buffersDevice->agents,
+		buffersDevice->matrix, buffersDevice->rng_seeds,
+		buffersDevice->allocs, buffersDevice->busy, ccl_arg_skip, NULL);
 
-		/* Step 1:  Move agents, grow grass */
-		for (cl_uint t = 0; t < workSizes.rows_per_workitem; ++t) {
+	/* Step2 kernel - Agent actions, get stats. */
+	ccl_kernel_set_args(step2_krnl, buffersDevice->agents,
+		buffersDevice->matrix, buffersDevice->grass,
+		buffersDevice->rng_seeds, buffersDevice->stats_parts,
+		buffersDevice->allocs, buffersDevice->slabs, buffersDevice->busy,
+		ccl_arg_skip, ccl_arg_skip, NULL);
+
+	/* Fused step kernel - Complete simulation with wavefront schedule. */
+	if (ppc_sched_is(args, "wavefront")) {
+
+		step_krnl = ccl_program_get_kernel(prg, "step", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		ccl_kernel_set_args(step_krnl, buffersDevice->agents,
+			buffersDevice->matrix, buffersDevice->grass,
+			buffersDevice->rng_seeds, buffersDevice->stats_parts,
+			buffersDevice->allocs, buffersDevice->slabs, buffersDevice->busy,
+			buffersDevice->progress, NULL);
+	}
 
-			/* Set turn on step1_kernel */
-			ccl_kernel_set_arg(step1_krnl, 3, ccl_arg_priv(t, cl_uint));
+	/* On-demand step kernels - Same as step1 and step2, with rows taken
+	 * from dispensers. */
+	if (ppc_sched_is(args, "ondemand")) {
+
+		step1_krnl = ccl_program_get_kernel(
+			prg, "ondemand_step1", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		step2_krnl = ccl_program_get_kernel(
+			prg, "ondemand_step2", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		ccl_kernel_set_args(step1_krnl, buffersDevice->agents,
+			buffersDevice->matrix, buffersDevice->rng_seeds,
+			buffersDevice->allocs, buffersDevice->busy,
+			buffersDevice->dispensers, buffersDevice->locks, NULL);
+
+		ccl_kernel_set_args(step2_krnl, buffersDevice->agents,
+			buffersDevice->matrix, buffersDevice->grass,
+			buffersDevice->rng_seeds, buffersDevice->stats_parts,
+			buffersDevice->allocs, buffersDevice->slabs, buffersDevice->busy,
+			buffersDevice->dispensers, ccl_arg_skip, NULL);
+	}
 
-			/* Run kernel */
-			evt = ccl_kernel_enqueue_ndrange(step1_krnl, cq, 1, NULL,
-				&workSizes.gws, local_size, NULL, &err_internal);
-			g_if_err_propagate_goto(err, err_internal, error_handler);
-			ccl_event_set_name(evt, "K: step1");
+	/* Tiled step kernels - Same as step1 and step2, over 2D tiles. */
+	if (ppc_sched_is(args, "tiled")) {
 
+		step1_krnl = ccl_program_get_kernel(prg, "tile_step1", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		step2_krnl = ccl_program_get_kernel(prg, "tile_step2", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		ccl_kernel_set_args(step1_krnl, buffersDevice->agents,
+			buffersDevice->matrix, buffersDevice->rng_seeds,
+			buffersDevice->allocs, buffersDevice->busy, ccl_arg_skip, NULL);
+
+		ccl_kernel_set_args(step2_krnl, buffersDevice->agents,
+			buffersDevice->matrix, buffersDevice->grass,
+			buffersDevice->rng_seeds, buffersDevice->stats_parts,
+			buffersDevice->allocs, buffersDevice->slabs, buffersDevice->busy,
+			ccl_arg_skip, NULL);
+	}
+
+	/* Atomic step kernels - Same as step1 and step2, over all cells. */
+	if (ppc_sched_is(args, "atomic")) {
+
+		step1_krnl = ccl_program_get_kernel(
+			prg, "atomic_step1", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		step2_krnl = ccl_program_get_kernel(
+			prg, "atomic_step2", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		ccl_kernel_set_args(step1_krnl, buffersDevice->agents,
+			buffersDevice->matrix, buffersDevice->rng_seeds,
+			buffersDevice->allocs, buffersDevice->busy, NULL);
+
+		ccl_kernel_set_args(step2_krnl, buffersDevice->agents,
+			buffersDevice->matrix, buffersDevice->grass,
+			buffersDevice->rng_seeds, buffersDevice->stats_parts,
+			buffersDevice->allocs, buffersDevice->slabs, buffersDevice->busy,
+			ccl_arg_skip, NULL);
+	}
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+
+finish:
+
+	/* Return. */
+	return;
+}
+
+/**
+ * Reduce the partial statistics of the given iterations into the global
+ * statistics.
+ *
+ * @param[in] cq Command queue wrapper.
+ * @param[in] reduce_krnl Statistics reduction kernel.
+ * @param[in] grass_stats_krnl Incremental grass statistics kernel, or `NULL`
+ * if grass statistics are gathered from all cells.
+ * @param[in] num_parts Number of partial statistics per iteration, i.e. the
+ * global work size.
+ * @param[in] iter First iteration to reduce.
+ * @param[in] num_iters Number of iterations to reduce.
+ * @param[out] err Return location for a GError.
+ * */
+static void ppc_stats_reduce(CCLQueue * cq, CCLKernel * reduce_krnl,
+	CCLKernel * grass_stats_krnl, cl_uint num_parts, cl_uint iter,
+	size_t num_iters, GError ** err) {
+
+	/* Incremental grass statistics kernel runs with a single work-item. */
+	size_t one = 1;
+	cl_uint grass_iters = (cl_uint) num_iters;
+
+	/* Internal error handling object. */
+	GError * err_internal = NULL;
+
+	/* Event wrapper. */
+	CCLEvent * evt = NULL;
+
+	/* Set number of partial statistics and first iteration. */
+	ccl_kernel_set_args(reduce_krnl, ccl_arg_skip, ccl_arg_skip,
+		ccl_arg_priv(num_parts, cl_uint), ccl_arg_priv(iter, cl_uint), NULL);
+
+	/* Run kernel, one work-item per iteration. */
+	evt = ccl_kernel_enqueue_ndrange(reduce_krnl, cq, 1, NULL,
+		&num_iters, NULL, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "K: stats_reduce");
+
+	/* Derive grass statistics of the reduced iterations, if required. */
+	if (grass_stats_krnl) {
+
+		ccl_kernel_set_args(grass_stats_krnl, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_priv(iter, cl_uint), ccl_arg_priv(grass_iters, cl_uint),
+			NULL);
+
+		evt = ccl_kernel_enqueue_ndrange(grass_stats_krnl, cq, 1, NULL,
+			&one, NULL, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: stats_grass");
+	}
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+
+finish:
+
+	/* Return. */
+	return;
+}
+
+/**
+ * Grow grass in all cells. Nothing is done in the lazy grass representation,
+ * where cells keep the iteration at which their grass regrows.
+ *
+ * @param[in] cq Command queue wrapper.
+ * @param[in] grass_krnl Grass kernel.
+ * @param[in] gws Global work size.
+ * @param[in] lws Local work size, or `NULL` to let OpenCL decide.
+ * @param[out] err Return location for a GError.
+ * */
+static void ppc_grass_grow(CCLQueue * cq, CCLKernel * grass_krnl,
+	size_t gws, size_t * lws, GError ** err) {
+
+	/* Internal error handling object. */
+	GError * err_internal = NULL;
+
+	/* Event wrapper. */
+	CCLEvent * evt = NULL;
+
+	/* Lazy grass does not grow. */
+	if (ppc_grass_is_lazy(args)) goto finish;
+
+	/* Run kernel. */
+	evt = ccl_kernel_enqueue_ndrange(grass_krnl, cq, 1, NULL,
+		&gws, lws, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "K: grass");
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+
+finish:
+
+	/* Return. */
+	return;
+}
+
+/**
+ * Grow the agents buffer if the agent allocator may run out of slabs in the
+ * next iteration.
+ *
+ * The number of slabs handed out so far is read without blocking, and used
+ * in the following call, where it accounts for all iterations but the
+ * previous one. Waiting for it only waits for the iteration before the
+ * previous one to finish, so the host stays one iteration ahead of the
+ * device. Since agents reproduce at most once per iteration, the slabs
+ * required for the previous and the next iteration are bounded from this
+ * number. Only if the bound doesn't fit in the agents buffer is the exact
+ * number read, waiting for the previous iteration to finish, and the buffer
+ * grown so that it covers two more iterations. Nothing is read once the
+ * agents buffer has the maximum number of slabs.
+ *
+ * @param[in] ctx Context wrapper.
+ * @param[in] cq Command queue wrapper.
+ * @param[in] step1_krnl Step 1 kernel, whose first argument is the agents
+ * buffer.
+ * @param[in] step2_krnl Step 2 kernel, whose first argument is the agents
+ * buffer.
+ * @param[in,out] buffersDevice Device buffers.
+ * @param[in,out] num_slabs Number of slabs which fit in the agents buffer.
+ * @param[in,out] slabs_read Destination of the non-blocking read of the
+ * number of slabs handed out so far, which must remain valid until the read
+ * is complete.
+ * @param[in,out] slabs_evt Event of the pending non-blocking read, or `NULL`
+ * if there is none.
+ * @param[in] workSizes Work sizes for kernels, and other work/memory sizes
+ * related to the simulation.
+ * @param[out] err Return location for a GError.
+ * */
+static void ppc_agents_grow(CCLContext * ctx, CCLQueue * cq,
+	CCLKernel * step1_krnl, CCLKernel * step2_krnl,
+	PPCBuffersDevice * buffersDevice, cl_uint * num_slabs,
+	cl_uint * slabs_read, CCLEvent ** slabs_evt,
+	PPCWorkSizes workSizes, GError ** err) {
+
+	/* Internal error handling object. */
+	GError * err_internal = NULL;
+
+	/* Event wrapper. */
+	CCLEvent * evt = NULL;
+
+	/* Event wait list. */
+	CCLEventWaitList ewl = NULL;
+
+	/* Grown agents buffer. */
+	CCLBuffer * agents = NULL;
+
+	/* Size of each slab in the agents buffer. */
+	size_t slab_bytes = args.slab_size * PPC_AGENT_SIZE;
+
+	/* Maximum number of slabs in the agents buffer. */
+	cl_uint max_slabs = workSizes.max_agents / args.slab_size;
+
+	/* Number of slabs handed out so far. */
+	cl_uint slabs_used = 0;
+
+	/* Number of slabs required for the previous and the next iteration. */
+	cl_uint slabs_required = *num_slabs;
+
+	/* Can the agents buffer still grow? */
+	if (*num_slabs < max_slabs) {
+
+		/* Bound the number of slabs required from the number read in the
+		 * previous call, if any. */
+		if (*slabs_evt != NULL) {
+			ccl_event_wait(ccl_ewl(&ewl, *slabs_evt, NULL), &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			*slabs_evt = NULL;
+			slabs_required =
+				ppc_agents_slabs_bound(*slabs_read, workSizes.gws, max_slabs);
+		} else {
+			slabs_required = max_slabs;
 		}
 
-		/* Step 2:  Agent actions, get stats */
+		/* If there is no such bound or it doesn't fit in the agents
+		 * buffer, get the exact number of slabs handed out so far. */
+		if (slabs_required > *num_slabs) {
+			evt = ccl_buffer_enqueue_read(buffersDevice->slabs, cq, CL_TRUE,
+				0, sizeof(cl_uint), &slabs_used, NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "Read: slabs");
+			slabs_required =
+				ppc_agents_slabs_bound(slabs_used, workSizes.gws, max_slabs);
+		}
+	}
+
+	/* Grow agents buffer, if required. */
+	if (slabs_required > *num_slabs) {
+
+		/* Create grown agents buffer. */
+		agents = ccl_buffer_new(ctx,
+			CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
+			slabs_required * slab_bytes, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Copy the slabs handed out so far, the remaining ones don't hold
+		 * any agents. */
+		evt = ccl_buffer_enqueue_copy(buffersDevice->agents, agents, cq,
+			0, 0, MIN(slabs_used, *num_slabs) * slab_bytes, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Copy: agents");
+
+		/* Replace agents buffer. The old buffer is only released by OpenCL
+		 * after the copy is complete. */
+		ccl_buffer_destroy(buffersDevice->agents);
+		buffersDevice->agents = agents;
+		*num_slabs = slabs_required;
+
+		/* Make new slabs available to the agent allocator. */
+		evt = ccl_buffer_enqueue_fill(buffersDevice->slabs, cq, num_slabs,
+			sizeof(cl_uint), sizeof(cl_uint), sizeof(cl_uint), NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Fill: slabs available");
+
+		/* Step kernels use the grown agents buffer from now on. */
+		ccl_kernel_set_arg(step1_krnl, 0, agents);
+		ccl_kernel_set_arg(step2_krnl, 0, agents);
+	}
+
+	/* Read the number of slabs handed out so far without blocking, for the
+	 * next call, unless the agents buffer can't grow any further. */
+	if (*num_slabs < max_slabs) {
+		*slabs_evt = ccl_buffer_enqueue_read(buffersDevice->slabs, cq,
+			CL_FALSE, 0, sizeof(cl_uint), slabs_read, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(*slabs_evt, "Read: slabs");
+	}
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+
+finish:
+
+	/* Return. */
+	return;
+}
+
+/**
+ * Perform simulation!
+ *
+ * @param[in] workSizes Work sizes for kernels step1 and step2, and
+ * other work/memory sizes related to the simulation.
+ * @param[in] params Simulation parameters.
+ * @param[in] ctx Context wrapper.
+ * @param[in] cq Command queue wrapper.
+ * @param[in] prg Program wrapper.
+ * @param[in] buffersDevice Device buffers.
+ * @param[in] dataSizes Sizes of simulation data structures.
+ * @param[out] err Return location for a GError.
+ * */
+static void ppc_simulate(PPCWorkSizes workSizes, PPParameters params,
+	CCLContext * ctx, CCLQueue * cq, CCLProgram* prg,
+	PPCBuffersDevice * buffersDevice, PPCDataSizes dataSizes,
+	GError ** err) {
+
+	/* Internal error handling object. */
+	GError * err_internal = NULL;
+
+	/* Kernel wrappers. */
+	CCLKernel * init_krnl = NULL;
+	CCLKernel * step1_krnl = NULL;
+	CCLKernel * step2_krnl = NULL;
+	CCLKernel * step_krnl = NULL;
+	CCLKernel * grass_krnl = NULL;
+	CCLKernel * reduce_krnl = NULL;
+	CCLKernel * grass_stats_krnl = NULL;
+
+	/* Event wrapper. */
+	CCLEvent * evt = NULL;
+
+	/* Current iteration. */
+	cl_uint iter;
+
+	/* Number of slabs which fit in the agents buffer. */
+	cl_uint num_slabs =
+		dataSizes.agents / (args.slab_size * PPC_AGENT_SIZE);
+
+	/* Number of slabs handed out so far, as read without blocking, and the
+	 * event of the pending read, if any. */
+	cl_uint slabs_read = 0;
+	CCLEvent * slabs_evt = NULL;
+
+	/* Event wait list. */
+	CCLEventWaitList ewl = NULL;
+
+    /* If local work group size is not given or is 0, set it to NULL and
+     * let OpenCL decide. */
+	size_t * local_size = (workSizes.lws > 0 ? &workSizes.lws : NULL);
+
+	/* Get initialization kernel. */
+	init_krnl = ccl_program_get_kernel(prg, "init", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Get step1 kernel. */
+	step1_krnl = ccl_program_get_kernel(prg, "step1", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Get step2 kernel. */
+	step2_krnl = ccl_program_get_kernel(prg, "step2", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Get grass kernel. */
+	grass_krnl = ccl_program_get_kernel(prg, "grass", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Get statistics reduction kernel. */
+	reduce_krnl = ccl_program_get_kernel(prg, "stats_reduce", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Get incremental grass statistics kernel, if required. */
+	if (ppc_grass_stats_is_inc(args)) {
+		grass_stats_krnl =
+			ccl_program_get_kernel(prg, "stats_grass", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
+
+	/* Launch initialization kernel. */
+	evt = ccl_kernel_enqueue_ndrange(init_krnl, cq, 1, NULL,
+		&workSizes.gws, local_size, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "K: init");
+
+	/* In the wavefront schedule, the complete simulation is performed by
+	 * a single launch of the fused step kernel. */
+	if (ppc_sched_is(args, "wavefront")) {
+
+		/* Get fused step kernel. */
+		step_krnl = ccl_program_get_kernel(prg, "step", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Run kernel */
+		evt = ccl_kernel_enqueue_ndrange(step_krnl, cq, 1, NULL,
+			&workSizes.gws, local_size, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: step");
+
+		/* Reduce partial statistics of all iterations. */
+		ppc_stats_reduce(cq, reduce_krnl, grass_stats_krnl,
+			workSizes.gws, 0, params.iters + 1, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Nothing else to do. */
+		goto finish;
+	}
+
+	/* Reduce initial partial statistics. */
+	ppc_stats_reduce(cq, reduce_krnl, grass_stats_krnl,
+		workSizes.gws, 0, 1, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* In the on-demand schedule, each step kernel is launched once per
+	 * iteration. */
+	if (ppc_sched_is(args, "ondemand")) {
+
+		/* Get on-demand step kernels. */
+		step1_krnl = ccl_program_get_kernel(
+			prg, "ondemand_step1", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		step2_krnl = ccl_program_get_kernel(
+			prg, "ondemand_step2", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Simulation loop. */
+		for (iter = 1; iter <= params.iters; iter++) {
+
+			/* Grow agents buffer, if required */
+			ppc_agents_grow(ctx, cq, step1_krnl, step2_krnl, buffersDevice,
+				&num_slabs, &slabs_read, &slabs_evt, workSizes, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+			/* Grow grass */
+			ppc_grass_grow(cq, grass_krnl, workSizes.gws, local_size,
+				&err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+			/* Step 1:  Move agents */
+			evt = ccl_kernel_enqueue_ndrange(step1_krnl, cq, 1, NULL,
+				&workSizes.gws, local_size, NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "K: ondemand_step1");
+
+			/* Step 2:  Agent actions, get stats */
+			ccl_kernel_set_arg(step2_krnl, 9, ccl_arg_priv(iter, cl_uint));
+			evt = ccl_kernel_enqueue_ndrange(step2_krnl, cq, 1, NULL,
+				&workSizes.gws, local_size, NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "K: ondemand_step2");
+
+			/* Reduce partial statistics of current iteration. */
+			ppc_stats_reduce(cq, reduce_krnl, grass_stats_krnl,
+				workSizes.gws, iter, 1, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		}
+
+		/* Nothing else to do. */
+		goto finish;
+	}
+
+	/* In the tiled schedule, the step 1 kernel is launched once for each
+	 * tile colour, and the step 2 kernel once per iteration. */
+	if (ppc_sched_is(args, "tiled")) {
 
-		/* Set current iteration on step2_kernel. */
-		ccl_kernel_set_arg(step2_krnl, 4, ccl_arg_priv(iter, cl_uint));
+		/* Get tiled step kernels. */
+		step1_krnl = ccl_program_get_kernel(prg, "tile_step1", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		step2_krnl = ccl_program_get_kernel(prg, "tile_step2", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
 
+		/* Simulation loop. */
+		for (iter = 1; iter <= params.iters; iter++) {
+
+			/* Grow agents buffer, if required */
+			ppc_agents_grow(ctx, cq, step1_krnl, step2_krnl, buffersDevice,
+				&num_slabs, &slabs_read, &slabs_evt, workSizes, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+			/* Grow grass */
+			ppc_grass_grow(cq, grass_krnl, workSizes.gws, local_size,
+				&err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+			/* Step 1:  Move agents */
+			for (cl_uint c = 0; c < 4; ++c) {
+
+				/* Set tile colour on step1_kernel */
+				ccl_kernel_set_arg(step1_krnl, 5, ccl_arg_priv(c, cl_uint));
+
+				/* Run kernel */
+				evt = ccl_kernel_enqueue_ndrange(step1_krnl, cq, 1, NULL,
+					&workSizes.gws, local_size, NULL, &err_internal);
+				g_if_err_propagate_goto(err, err_internal, error_handler);
+				ccl_event_set_name(evt, "K: tile_step1");
+
+			}
+
+			/* Step 2:  Agent actions, get stats */
+			ccl_kernel_set_arg(step2_krnl, 8, ccl_arg_priv(iter, cl_uint));
+			evt = ccl_kernel_enqueue_ndrange(step2_krnl, cq, 1, NULL,
+				&workSizes.gws, local_size, NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "K: tile_step2");
+
+			/* Reduce partial statistics of current iteration. */
+			ppc_stats_reduce(cq, reduce_krnl, grass_stats_krnl,
+				workSizes.gws, iter, 1, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		}
+
+		/* Nothing else to do. */
+		goto finish;
+	}
+
+	/* In the atomic schedule, each step kernel is launched once per
+	 * iteration over all cells. */
+	if (ppc_sched_is(args, "atomic")) {
+
+		/* Get atomic step kernels. */
+		step1_krnl = ccl_program_get_kernel(
+			prg, "atomic_step1", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		step2_krnl = ccl_program_get_kernel(
+			prg, "atomic_step2", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Simulation loop. */
+		for (iter = 1; iter <= params.iters; iter++) {
+
+			/* Grow agents buffer, if required */
+			ppc_agents_grow(ctx, cq, step1_krnl, step2_krnl, buffersDevice,
+				&num_slabs, &slabs_read, &slabs_evt, workSizes, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+			/* Grow grass */
+			ppc_grass_grow(cq, grass_krnl, workSizes.gws, local_size,
+				&err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+			/* Step 1:  Move agents */
+			evt = ccl_kernel_enqueue_ndrange(step1_krnl, cq, 1, NULL,
+				&workSizes.gws, local_size, NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "K: atomic_step1");
+
+			/* Step 2:  Agent actions, get stats */
+			ccl_kernel_set_arg(step2_krnl, 8, ccl_arg_priv(iter, cl_uint));
+			evt = ccl_kernel_enqueue_ndrange(step2_krnl, cq, 1, NULL,
+				&workSizes.gws, local_size, NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "K: atomic_step2");
+
+			/* Reduce partial statistics of current iteration. */
+			ppc_stats_reduce(cq, reduce_krnl, grass_stats_krnl,
+				workSizes.gws, iter, 1, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		}
+
+		/* Nothing else to do. */
+		goto finish;
+	}
+
+	/* Simulation loop. */
+	for (iter = 1; iter <= params.iters; iter++) {
+
+		/* Grow agents buffer, if required */
+		ppc_agents_grow(ctx, cq, step1_krnl, step2_krnl, buffersDevice,
+			&num_slabs, &slabs_read, &slabs_evt, workSizes, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Grow grass */
+		ppc_grass_grow(cq, grass_krnl, workSizes.gws, local_size,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Step 1:  Move agents */
+		for (cl_uint t = 0; t < workSizes.rows_per_workitem; ++t) {
+
+			/* Set turn on step1_kernel */
+			ccl_kernel_set_arg(step1_krnl, 5, ccl_arg_priv(t, cl_uint));
+
+			/* Run kernel */
+			evt = ccl_kernel_enqueue_ndrange(step1_krnl, cq, 1, NULL,
+				&workSizes.gws, local_size, NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "K: step1");
+
+		}
+
+		/* Step 2:  Agent actions, get stats */
+		ccl_kernel_set_arg(step2_krnl, 9, ccl_arg_priv(iter, cl_uint));
 		for (cl_uint t = 0; t < workSizes.rows_per_workitem; ++t) {
 
 			/* Set turn on step2_kernel */
-			ccl_kernel_set_arg(step2_krnl, 5, ccl_arg_priv(t, cl_uint));
+			ccl_kernel_set_arg(step2_krnl, 8, ccl_arg_priv(t, cl_uint));
 
 			/* Run kernel */
 			evt = ccl_kernel_enqueue_ndrange(step2_krnl, cq, 1, NULL,
@@ -648,6 +1959,172 @@ static void ppc_simulate(PPCWorkSizes workSizes, PPParameters params,
 
 		}
 
+		/* Reduce partial statistics of current iteration. */
+		ppc_stats_reduce(cq, reduce_krnl, grass_stats_krnl,
+			workSizes.gws, iter, 1, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	}
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+
+finish:
+
+	/* Wait for the pending read of the number of slabs handed out so far,
+	 * whose destination is about to go out of scope. Errors are reported
+	 * when the command queue is finished. */
+	if (slabs_evt != NULL)
+		ccl_event_wait(ccl_ewl(&ewl, slabs_evt, NULL), NULL);
+
+	/* Return. */
+	return;
+}
+
+/**
+ * Perform simulation with the CSR engine!
+ *
+ * @param[in] workSizes Work sizes for kernels, and other work/memory sizes
+ * related to the simulation.
+ * @param[in] params Simulation parameters.
+ * @param[in] cq Command queue wrapper.
+ * @param[in] prg Program wrapper.
+ * @param[in] buffersDevice Device buffers.
+ * @param[out] err Return location for a GError.
+ * */
+static void ppc_simulate_csr(PPCWorkSizes workSizes, PPParameters params,
+	CCLQueue * cq, CCLProgram* prg, PPCBuffersDevice * buffersDevice,
+	GError ** err) {
+
+	/* Internal error handling object. */
+	GError * err_internal = NULL;
+
+	/* Kernel wrappers. */
+	CCLKernel * init_krnl = NULL;
+	CCLKernel * move_krnl = NULL;
+	CCLKernel * scan1_krnl = NULL;
+	CCLKernel * scan2_krnl = NULL;
+	CCLKernel * scatter_krnl = NULL;
+	CCLKernel * step2_krnl = NULL;
+	CCLKernel * grass_krnl = NULL;
+	CCLKernel * reduce_krnl = NULL;
+	CCLKernel * grass_stats_krnl = NULL;
+
+	/* Event wrapper. */
+	CCLEvent * evt = NULL;
+
+	/* Current and rebuilt agent arrays and cell ranges, swapped in each
+	 * iteration. */
+	CCLBuffer * agents = buffersDevice->agents;
+	CCLBuffer * agents_next = buffersDevice->agents_swap;
+	CCLBuffer * ranges = buffersDevice->ranges;
+	CCLBuffer * ranges_next = buffersDevice->ranges_swap;
+	CCLBuffer * swap;
+
+	/* Current iteration. */
+	cl_uint iter;
+
+    /* If local work group size is not given or is 0, set it to NULL and
+     * let OpenCL decide. */
+	size_t * local_size = (workSizes.lws > 0 ? &workSizes.lws : NULL);
+
+	/* Get kernels. */
+	init_krnl = ccl_program_get_kernel(prg, "csr_init", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	move_krnl = ccl_program_get_kernel(prg, "csr_move", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	scan1_krnl = ccl_program_get_kernel(prg, "csr_scan1", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	scan2_krnl = ccl_program_get_kernel(prg, "csr_scan2", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	scatter_krnl = ccl_program_get_kernel(prg, "csr_scatter", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	step2_krnl = ccl_program_get_kernel(prg, "csr_step2", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	grass_krnl = ccl_program_get_kernel(prg, "grass", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	reduce_krnl = ccl_program_get_kernel(prg, "stats_reduce", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Get incremental grass statistics kernel, if required. */
+	if (ppc_grass_stats_is_inc(args)) {
+		grass_stats_krnl =
+			ccl_program_get_kernel(prg, "stats_grass", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
+
+	/* Launch initialization kernel. */
+	evt = ccl_kernel_enqueue_ndrange(init_krnl, cq, 1, NULL,
+		&workSizes.gws, local_size, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "K: csr_init");
+
+	/* Reduce initial partial statistics. */
+	ppc_stats_reduce(cq, reduce_krnl, grass_stats_krnl,
+		workSizes.gws, 0, 1, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Simulation loop. */
+	for (iter = 1; iter <= params.iters; iter++) {
+
+		/* Set buffers for current iteration. */
+		ccl_kernel_set_args(move_krnl, agents, ranges, ranges_next, NULL);
+		ccl_kernel_set_arg(scan1_krnl, 0, ranges_next);
+		ccl_kernel_set_arg(scan2_krnl, 0, ranges_next);
+		ccl_kernel_set_args(scatter_krnl, agents, agents_next, ranges,
+			ranges_next, NULL);
+		ccl_kernel_set_args(step2_krnl, agents_next, ccl_arg_skip,
+			ranges_next, ranges, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_priv(iter, cl_uint), NULL);
+
+		/* Grow grass. */
+		ppc_grass_grow(cq, grass_krnl, workSizes.gws, local_size,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Step 1: Move agents, count agents per cell. */
+		evt = ccl_kernel_enqueue_ndrange(move_krnl, cq, 1, NULL,
+			&workSizes.gws, local_size, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: csr_move");
+
+		/* Determine where the agents of each cell will be placed. */
+		evt = ccl_kernel_enqueue_ndrange(scan1_krnl, cq, 1, NULL,
+			&workSizes.gws, local_size, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: csr_scan1");
+
+		evt = ccl_kernel_enqueue_ndrange(scan2_krnl, cq, 1, NULL,
+			&workSizes.gws, local_size, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: csr_scan2");
+
+		/* Rebuild agents array. */
+		evt = ccl_kernel_enqueue_ndrange(scatter_krnl, cq, 1, NULL,
+			&workSizes.gws, local_size, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: csr_scatter");
+
+		/* Step 2: Agent actions, get stats. */
+		evt = ccl_kernel_enqueue_ndrange(step2_krnl, cq, 1, NULL,
+			&workSizes.gws, local_size, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: csr_step2");
+
+		/* Reduce partial statistics of current iteration. */
+		ppc_stats_reduce(cq, reduce_krnl, grass_stats_krnl,
+			workSizes.gws, iter, 1, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		/* Rebuilt agents array and ranges become the current ones. */
+		swap = agents; agents = agents_next; agents_next = swap;
+		swap = ranges; ranges = ranges_next; ranges_next = swap;
+
 	}
 
 	/* If we got here, everything is OK. */
@@ -672,10 +2149,36 @@ finish:
 static void ppc_devicebuffers_free(PPCBuffersDevice* buffersDevice) {
 	if (buffersDevice->stats)
 		ccl_buffer_destroy(buffersDevice->stats);
+	if (buffersDevice->stats_parts)
+		ccl_buffer_destroy(buffersDevice->stats_parts);
 	if (buffersDevice->agents)
 		ccl_buffer_destroy(buffersDevice->agents);
 	if (buffersDevice->matrix)
 		ccl_buffer_destroy(buffersDevice->matrix);
+	if (buffersDevice->grass)
+		ccl_buffer_destroy(buffersDevice->grass);
+	if (buffersDevice->regrow)
+		ccl_buffer_destroy(buffersDevice->regrow);
+	if (buffersDevice->allocs)
+		ccl_buffer_destroy(buffersDevice->allocs);
+	if (buffersDevice->slabs)
+		ccl_buffer_destroy(buffersDevice->slabs);
+	if (buffersDevice->agents_swap)
+		ccl_buffer_destroy(buffersDevice->agents_swap);
+	if (buffersDevice->ranges)
+		ccl_buffer_destroy(buffersDevice->ranges);
+	if (buffersDevice->ranges_swap)
+		ccl_buffer_destroy(buffersDevice->ranges_swap);
+	if (buffersDevice->sums)
+		ccl_buffer_destroy(buffersDevice->sums);
+	if (buffersDevice->progress)
+		ccl_buffer_destroy(buffersDevice->progress);
+	if (buffersDevice->dispensers)
+		ccl_buffer_destroy(buffersDevice->dispensers);
+	if (buffersDevice->locks)
+		ccl_buffer_destroy(buffersDevice->locks);
+	if (buffersDevice->busy)
+		ccl_buffer_destroy(buffersDevice->busy);
 }
 
 /**
@@ -687,11 +2190,13 @@ static void ppc_devicebuffers_free(PPCBuffersDevice* buffersDevice) {
  * @param[in] buffersDevice Device buffers.
  * @param[in] dataSizes Sizes of simulation data structures.
  * @param[in] params Simulation parameters.
+ * @param[out] ag_updates Number of agent updates (i.e., number of agents
+ * which moved and acted, summed over all iterations).
  * @param[out] err Return location for a GError.
  * */
 static void ppc_stats_get_and_save(char * filename, CCLQueue * cq,
 	PPCBuffersDevice * buffersDevice, PPCDataSizes dataSizes,
-	PPParameters params, GError ** err) {
+	PPParameters params, cl_ulong * ag_updates, GError ** err) {
 
 	/* Event wrapper. */
 	CCLEvent* evt = NULL;
@@ -715,6 +2220,12 @@ static void ppc_stats_get_and_save(char * filename, CCLQueue * cq,
 	pp_stats_save(filename, stats, params, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
+	/* Agents existing at the end of each iteration are updated in the
+	 * next one. */
+	*ag_updates = 0;
+	for (cl_uint i = 0; i < params.iters; ++i)
+		*ag_updates += stats[i].sheep + stats[i].wolves;
+
 	/* Allocation errors? */
 	if (alloc_errors) {
 		printf("\n **** There were %lu allocation errors! **** \n",
@@ -745,6 +2256,74 @@ finish:
 	return;
 }
 
+/**
+ * Get and print statistics of the work performed by each work-item, i.e.
+ * the number of cells and agents processed by each work-item during the
+ * simulation. The imbalance is the ratio between the maximum and the mean,
+ * and is 1 when work is perfectly balanced.
+ *
+ * @param[in] cq Command queue wrapper.
+ * @param[in] buffersDevice Device buffers.
+ * @param[in] dataSizes Sizes of simulation data structures.
+ * @param[in] gws Global work size.
+ * @param[out] err Return location for a GError.
+ * */
+static void ppc_busy_get_and_print(CCLQueue * cq,
+	PPCBuffersDevice * buffersDevice, PPCDataSizes dataSizes, size_t gws,
+	GError ** err) {
+
+	/* Event wrapper. */
+	CCLEvent* evt = NULL;
+
+	/* Work performed by each work-item. */
+	cl_ulong * busy;
+
+	/* Work statistics. */
+	cl_ulong busy_min = CL_ULONG_MAX, busy_max = 0, busy_sum = 0;
+	double busy_mean;
+
+	/* Internal error handling object. */
+	GError* err_internal = NULL;
+
+	/* Map work performed by each work-item. */
+	busy = ccl_buffer_enqueue_map(buffersDevice->busy, cq, CL_TRUE,
+		CL_MAP_READ, 0, dataSizes.busy, NULL, &evt, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Map: busy");
+
+	/* Determine work statistics. */
+	for (size_t i = 0; i < gws; ++i) {
+		busy_min = MIN(busy_min, busy[i]);
+		busy_max = MAX(busy_max, busy[i]);
+		busy_sum += busy[i];
+	}
+	busy_mean = busy_sum / (double) gws;
+
+	/* Print work statistics. */
+	printf("Work per work-item: min %lu, mean %.4e, max %lu, "
+		"imbalance %.4f\n", (unsigned long) busy_min, busy_mean,
+		(unsigned long) busy_max, busy_mean > 0 ? busy_max / busy_mean : 1.0);
+
+	/* Unmap work performed by each work-item. */
+	evt = ccl_buffer_enqueue_unmap(buffersDevice->busy, cq,
+		busy, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Unmap: busy");
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+
+finish:
+
+	/* Return. */
+	return;
+}
+
 /**
  * Parse command-line options.
  *
@@ -779,6 +2358,11 @@ static void ppc_args_free(GOptionContext* context) {
 	if (args.stats) g_free(args.stats);
 	if (args.compiler_opts) g_free(args.compiler_opts);
 	if (args.rngen) g_free(args.rngen);
+	if (args.ag_layout) g_free(args.ag_layout);
+	if (args.engine) g_free(args.engine);
+	if (args.sched) g_free(args.sched);
+	if (args.grass) g_free(args.grass);
+	if (args.grass_stats) g_free(args.grass_stats);
 }
 
 /**
@@ -799,10 +2383,24 @@ static gchar* ppc_compiler_opts_build(PPCArgs args, PPParameters params,
 	GString* compilerOpts = g_string_new("");
 	g_string_append_printf(compilerOpts, "-D MAX_AGENTS=%d ",
 		args.max_agents);
+	g_string_append_printf(compilerOpts, "-D SLAB_SIZE=%d ",
+		args.slab_size);
 	g_string_append_printf(compilerOpts, "-D MAX_AGENT_SHUF=%d ",
 		args.max_agents_ptrs);
 	g_string_append_printf(compilerOpts, "-D ROWS_PER_WORKITEM=%d ",
 		(cl_uint) work_sizes.rows_per_workitem);
+	g_string_append_printf(compilerOpts, "-D D_MIN=%d ", PPC_D_MIN);
+	g_string_append_printf(compilerOpts, "-D BLOCK_ROWS=%d ",
+		args.block_rows);
+	g_string_append_printf(compilerOpts, "-D TILE_X=%d -D TILE_Y=%d ",
+		args.tile_x, args.tile_y);
+	g_string_append_printf(compilerOpts, "-D VW_GRASS=%d ", args.vw_grass);
+	if (args.busy_stats)
+		g_string_append(compilerOpts, "-D PPC_BUSY_STATS ");
+	if (ppc_grass_is_lazy(args))
+		g_string_append(compilerOpts, "-D PP_GRASS_LAZY ");
+	if (ppc_grass_stats_is_inc(args))
+		g_string_append(compilerOpts, "-D PP_GRASS_STATS_INC ");
 	g_string_append_printf(compilerOpts, "-D INIT_SHEEP=%d ",
 		params.init_sheep);
 	g_string_append_printf(compilerOpts, "-D SHEEP_GAIN_FROM_FOOD=%d ",
@@ -827,6 +2425,8 @@ static gchar* ppc_compiler_opts_build(PPCArgs args, PPParameters params,
 		params.grid_y);
 	g_string_append_printf(compilerOpts, "-D ITERS=%d ",
 		params.iters);
+	g_string_append(compilerOpts,
+		ppc_ag_layout_find(args.ag_layout)->compiler_opts);
 
 	if (cliOpts) g_string_append_printf(compilerOpts, "%s", cliOpts);
 	compilerOptsStr = compilerOpts->str;
@@ -855,7 +2455,8 @@ int main(int argc, char ** argv) {
 	/* Predator-Prey simulation data structures. */
 	PPCWorkSizes workSizes;
 	PPCDataSizes dataSizes;
-	PPCBuffersDevice buffersDevice = {NULL, NULL, NULL, NULL};
+	PPCBuffersDevice buffersDevice = {NULL, NULL, NULL, NULL, NULL, NULL,
+		NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
 	PPParameters params;
 	gchar* compilerOpts = NULL;
 
@@ -874,6 +2475,18 @@ int main(int argc, char ** argv) {
 	/* CL_Ops RNG. */
 	CloRng * rng_clo = NULL;
 
+	/* Agent layout. */
+	const PPCAgLayout * ag_layout = NULL;
+
+	/* Number of device compute units. */
+	cl_uint cu;
+
+	/* Maximum size of device memory allocations. */
+	cl_ulong max_alloc;
+
+	/* Number of agent updates performed during the simulation. */
+	cl_ulong ag_updates = 0;
+
 	/* Error management object. */
 	GError * err = NULL;
 
@@ -892,6 +2505,63 @@ int main(int argc, char ** argv) {
 	/* Use default seed if no seed was specified by user. */
 	if (!args.rngen) args.rngen = g_strdup(PP_RNG_DEFAULT);
 
+	/* Use default agent layout if no layout was specified by user. */
+	if (!args.ag_layout) args.ag_layout = g_strdup(PPC_DEFAULT_AG_LAYOUT);
+
+	/* Check that the agent layout is valid. */
+	ag_layout = ppc_ag_layout_find(args.ag_layout);
+	g_if_err_create_goto(err, PP_ERROR, ag_layout == NULL,
+		PP_INVALID_ARGS, error_handler,
+		"Unknown agent layout '%s'.", args.ag_layout);
+
+	/* Use default engine if no engine was specified by user. */
+	if (!args.engine) args.engine = g_strdup(PPC_DEFAULT_ENGINE);
+
+	/* Check that the engine is valid. */
+	g_if_err_create_goto(err, PP_ERROR,
+		(g_strcmp0(args.engine, "list") != 0) && !ppc_engine_is_csr(args),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown simulation engine '%s'.", args.engine);
+
+	/* Use default row scheduling if none was specified by user. */
+	if (!args.sched) args.sched = g_strdup(PPC_DEFAULT_SCHED);
+
+	/* Check that the row scheduling is valid. */
+	g_if_err_create_goto(err, PP_ERROR,
+		!ppc_sched_is(args, "static") && !ppc_sched_is(args, "wavefront")
+		&& !ppc_sched_is(args, "ondemand") && !ppc_sched_is(args, "tiled")
+		&& !ppc_sched_is(args, "atomic"),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown row scheduling '%s'.", args.sched);
+
+	/* Row scheduling only applies to the list engine. */
+	g_if_err_create_goto(err, PP_ERROR,
+		ppc_engine_is_csr(args) && !ppc_sched_is(args, PPC_DEFAULT_SCHED),
+		PP_INVALID_ARGS, error_handler,
+		"The %s row scheduling is only available in the list engine.",
+		args.sched);
+
+	/* Use default grass representation if none was specified by user. */
+	if (!args.grass) args.grass = g_strdup(PPC_DEFAULT_GRASS);
+
+	/* Check that the grass representation is valid. */
+	g_if_err_create_goto(err, PP_ERROR,
+		(g_strcmp0(args.grass, PPC_DEFAULT_GRASS) != 0)
+		&& !ppc_grass_is_lazy(args),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown grass representation '%s'.", args.grass);
+
+	/* Use default grass statistics mode if none was specified by user. */
+	if (!args.grass_stats)
+		args.grass_stats = g_strdup(PPC_DEFAULT_GRASS_STATS);
+
+	/* Check that the grass statistics mode is valid. */
+	g_if_err_create_goto(err, PP_ERROR,
+		(g_strcmp0(args.grass_stats, "full") != 0)
+		&& !ppc_grass_stats_is_inc(args),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown grass statistics mode '%s'.", args.grass_stats);
+
 	/* Create context with device specified by user. */
 	ctx = ccl_context_new_from_menu_full(&args.dev_idx, &err);
 	g_if_err_goto(err, error_handler);
@@ -908,17 +2578,83 @@ int main(int argc, char ** argv) {
 	pp_load_params(&params, args.params, &err);
 	g_if_err_goto(err, error_handler);
 
+	/* Get number of device compute units. */
+	cu = ccl_device_get_info_scalar(
+		dev, CL_DEVICE_MAX_COMPUTE_UNITS, cl_uint, &err);
+	g_if_err_goto(err, error_handler);
+
+	/* Determine effective grass kernel vector width. */
+	if (args.vw_grass == 0) {
+		args.vw_grass = ccl_device_get_info_scalar(
+			dev, CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT, cl_uint, &err);
+		g_if_err_goto(err, error_handler);
+	}
+
+	/* Check that the grass kernel vector width is valid. */
+	g_if_err_create_goto(err, PP_ERROR,
+		(args.vw_grass == 0) || (args.vw_grass > 16)
+		|| (args.vw_grass & (args.vw_grass - 1)),
+		PP_INVALID_ARGS, error_handler,
+		"Grass vector width (%d) must be 1, 2, 4, 8 or 16.",
+		(int) args.vw_grass);
+
+	/* Tiles must be at least 2x2, so that tiles of the same colour are at
+	 * least PPC_D_MIN cells apart. */
+	g_if_err_create_goto(err, PP_ERROR,
+		(args.tile_x < 2) || (args.tile_y < 2),
+		PP_INVALID_ARGS, error_handler,
+		"Tiles must be at least 2x2.");
+
+	/* Determine maximum number of agents, if not given by user. If the agents
+	 * buffer is grown on demand, it's only limited by the maximum size of
+	 * device memory allocations. */
+	if (args.max_agents == 0) {
+		if (ppc_agents_growable(args)) {
+			max_alloc = ccl_device_get_info_scalar(
+				dev, CL_DEVICE_MAX_MEM_ALLOC_SIZE, cl_ulong, &err);
+			g_if_err_goto(err, error_handler);
+			args.max_agents = MIN(max_alloc / PPC_AGENT_SIZE, G_MAXINT);
+		} else {
+			args.max_agents = PPC_DEFAULT_MAX_AGENTS;
+		}
+	}
+
 	/* Determine number of threads to use based on compute capabilities
 	 * and user arguments */
-	ppc_worksizes_calc(args, &workSizes, params.grid_y, &err);
+	ppc_worksizes_calc(args, &workSizes, params.grid_x, params.grid_y, cu,
+		&err);
 	g_if_err_goto(err, error_handler);
 
+	/* Blocks of the on-demand schedule must have at least two rows, so that
+	 * blocks which are not neighbours are at least PPC_D_MIN rows apart. */
+	g_if_err_create_goto(err, PP_ERROR,
+		(args.block_rows < 2) || (args.block_rows > params.grid_y),
+		PP_INVALID_ARGS, error_handler,
+		"Blocks must have between 2 and %d rows.", (int) params.grid_y);
+
 	/* Is there enough space for the initial agents? */
 	g_if_err_create_goto(err, PP_ERROR,
 		params.init_sheep + params.init_wolves > args.max_agents,
 		PP_OUT_OF_RESOURCES, error_handler,
 		"Not enough space for the initial agents.");
 
+	/* Is there at least one agent slab for each work-item? The CSR engine
+	 * does not hand out slabs, but still needs at least one of them. */
+	g_if_err_create_goto(err, PP_ERROR,
+		(args.slab_size == 0) || (args.max_agents / args.slab_size
+			< (ppc_engine_is_csr(args) ? 1 : workSizes.gws)),
+		PP_INVALID_ARGS, error_handler,
+		"Maximum number of agents (%d) must be at least the global work "
+		"size (%d) times the slab size (%d).", (int) args.max_agents,
+		(int) workSizes.gws, (int) args.slab_size);
+
+	/* The structure of arrays layout packs the 2-byte fields of each slab
+	 * into 4-byte words. */
+	g_if_err_create_goto(err, PP_ERROR,
+		(ag_layout->arrays > 1) && (args.slab_size % 2 != 0),
+		PP_INVALID_ARGS, error_handler,
+		"The %s agent layout requires an even slab size.", ag_layout->name);
+
 	/* Create RNG with specified seed. */
 	rng_clo = clo_rng_new(args.rngen, CLO_RNG_SEED_HOST_MT, NULL,
 		workSizes.gws, args.rng_seed, NULL, ctx, cq, &err);
@@ -963,12 +2699,16 @@ int main(int argc, char ** argv) {
 	g_if_err_goto(err, error_handler);
 
 	/* Simulation!! */
-	ppc_simulate(workSizes, params, cq, prg, &err);
+	if (ppc_engine_is_csr(args))
+		ppc_simulate_csr(workSizes, params, cq, prg, &buffersDevice, &err);
+	else
+		ppc_simulate(workSizes, params, ctx, cq, prg, &buffersDevice,
+			dataSizes, &err);
 	g_if_err_goto(err, error_handler);
 
 	/* Get statistics. */
-	ppc_stats_get_and_save(
-		args.stats, cq, &buffersDevice, dataSizes, params, &err);
+	ppc_stats_get_and_save(args.stats, cq, &buffersDevice, dataSizes,
+		params, &ag_updates, &err);
 	g_if_err_goto(err, error_handler);
 
 	/* Stop basic timing / profiling. */
@@ -994,6 +2734,21 @@ int main(int argc, char ** argv) {
 
 #endif
 
+	/* Print work performed by each work-item, allowing to compare row
+	 * scheduling balance. */
+	if (args.busy_stats && !ppc_engine_is_csr(args)) {
+		ppc_busy_get_and_print(cq, &buffersDevice, dataSizes,
+			workSizes.gws, &err);
+		g_if_err_goto(err, error_handler);
+	}
+
+	/* Print agent throughput, allowing to compare agent layouts. Memory
+	 * traffic is not derived from it, as the bytes touched per agent update
+	 * depend on the number of sheep checked by wolves, which isn't
+	 * counted. */
+	printf("Agent updates per second: %.4e (%s layout)\n",
+		ag_updates / ccl_prof_time_elapsed(prof), ag_layout->name);
+
 	/* If we get here, everything went Ok. */
 	g_assert(err == NULL);
 	status = PP_SUCCESS;
@@ -24,10 +24,31 @@
  *
  * The kernels in this file expect the following preprocessor defines:
  *
- * * `MAX_AGENTS` - Maximum agents in simulation.
+ * * `MAX_AGENTS` - Maximum agents in simulation. In the list engine, the
+ * agents array may hold fewer agents, and is grown by the host as required.
+ * * `SLAB_SIZE` - Number of agent slots in each slab handed out to
+ * work-items by the agent allocator.
+ * * `PPC_AG_SOA` - If defined, agents are stored as a structure of arrays
+ * within each slab (must be an even `SLAB_SIZE`) instead of an array of
+ * structures.
  * * `MAX_AGENT_SHUF` - Maximum agents to shuffle in one go.
  * * `ROWS_PER_WORKITEM` - Number of rows to be processed by each work item
  * (except possibly the last one).
+ * * `D_MIN` - Minimum distance between rows processed at the same time, which
+ * is equal to 2r + 1, where r=1 is the radius of agent movement.
+ * * `BLOCK_ROWS` - Number of rows in each block dispensed in the on-demand
+ * schedule (at least 2).
+ * * `TILE_X`, `TILE_Y` - Tile width and height in the tiled schedule (at
+ * least 2).
+ * * `PPC_BUSY_STATS` - If defined, kernels count the work performed by each
+ * work-item (cells plus agents processed).
+ * * `VW_GRASS` - Vector size used in grass kernel (vector of uints).
+ * * `PP_GRASS_LAZY` - If defined, each cell keeps the iteration at which its
+ * grass regrows instead of a countdown, and the grass kernels are not used.
+ * * `PP_GRASS_STATS_INC` - If defined, grass statistics are derived from the
+ * number of cells eaten in each iteration and a regrowth histogram, instead
+ * of being gathered from all cells. In this case, the grass count of the
+ * partial statistics holds the number of cells eaten.
  *
  * * `INIT_SHEEP` - Initial number of sheep.
  * * `SHEEP_GAIN_FROM_FOOD` - Sheep energy gain when eating grass.
@@ -49,12 +70,67 @@
 /* Marker for the end of a cell's agent list. */
 #define END_OF_AG_LIST UINT_MAX
 
+/* Marks the link of an agent being pushed into a cell in the atomic
+ * schedule, which is not yet set. */
+#define AG_LIST_PENDING (UINT_MAX - 1)
+
 /* Number of cells. */
 #define GRID_XY GRID_X * GRID_Y
 
-/* Maximum agent memory allocation attempts. */
-#ifndef MAX_ALLOC_ATTEMPTS
-	#define MAX_ALLOC_ATTEMPTS 500
+/* Number of usable places in the agents array of the CSR engine. */
+#define AG_CAPACITY ((MAX_AGENTS / SLAB_SIZE) * SLAB_SIZE)
+
+/* Index, in the slab counter buffer, of the number of slabs which fit in the
+ * agents array, i.e. which are available to the agent allocator. */
+#define SLABS_AVAILABLE 1
+
+/* Number of agent types, each with its own agent list in every cell. */
+#define NUM_AG_TYPES 2
+
+/* Distance between the progress values of consecutive iterations in the
+ * wavefront schedule, larger than the number of rows of any work-item. */
+#define PROGRESS_STRIDE (GRID_Y + 1)
+
+/* Number of row blocks dispensed in the on-demand schedule. The last block
+ * also takes the remaining rows. */
+#define NUM_BLOCKS (GRID_Y / BLOCK_ROWS)
+
+/* Exclusive bit of block locks in the on-demand schedule. The remaining bits
+ * count shared holders of the lock. */
+#define BLOCK_LOCK_EXCL 0x80000000
+
+/* Number of tiles along each dimension in the tiled schedule, which must be
+ * even so that tiles of the same colour are never neighbours, even when
+ * wrapping around the torus. The last tile along each dimension also takes
+ * the remaining cells. */
+#define NUM_TILES_X ((GRID_X / TILE_X) & ~1)
+#define NUM_TILES_Y ((GRID_Y / TILE_Y) & ~1)
+
+/* Number of tiles of each colour in the tiled schedule. */
+#define NUM_TILES_COLOUR ((NUM_TILES_X / 2) * (NUM_TILES_Y / 2))
+
+/* Add work performed by the current work-item to its busy counter, if busy
+ * statistics are enabled. */
+#ifdef PPC_BUSY_STATS
+	#define BUSY_ADD(busy, work) ((busy)[get_global_id(0)] += (work))
+#else
+	#define BUSY_ADD(busy, work) ((void) (work))
+#endif
+
+/* Number of grass vectors, the last of which may include padding cells. */
+#define GRASS_VECS PP_DIV_CEIL(GRID_XY, VW_GRASS)
+
+/* Vector type for grass kernel, which depends on chosen vector width. */
+#if VW_GRASS == 1
+	typedef uint grass_uintx;
+#elif VW_GRASS == 2
+	typedef uint2 grass_uintx;
+#elif VW_GRASS == 4
+	typedef uint4 grass_uintx;
+#elif VW_GRASS == 8
+	typedef uint8 grass_uintx;
+#elif VW_GRASS == 16
+	typedef uint16 grass_uintx;
 #endif
 
 /**
@@ -99,35 +175,144 @@ typedef struct pp_c_agent_ocl {
 } PPCAgentOcl __attribute__ ((aligned (8)));
 
 /**
- * Cell state.
+ * Agent type and action, stored together in the structure of arrays
+ * layout.
+ */
+typedef struct pp_c_agent_ocl_ta {
+
+	/** Agent type. */
+	uchar type;
+
+	/** Did agent already act? */
+	uchar action;
+
+} PPCAgentTAOcl;
+
+#ifdef PPC_AG_SOA
+
+/* Agents are stored as a structure of arrays within each slab: the `next`
+ * array (4 bytes per agent), followed by the `energy` array (2 bytes per
+ * agent) and by the `type|action` array (2 bytes per agent). Agent
+ * passes which only need some of the fields don't pull the others through
+ * the cache. */
+typedef uint PPCAgentStoreOcl;
+
+/* Start of the slab containing agent with index i. */
+#define PPC_AG_SLAB(agents, i) \
+	((agents) + ((i) / SLAB_SIZE) * 2 * SLAB_SIZE)
+
+/* Fields of agent with index i. */
+#define PPC_AG_NEXT(agents, i) \
+	(PPC_AG_SLAB(agents, i)[(i) % SLAB_SIZE])
+#define PPC_AG_ENERGY(agents, i) \
+	(((__global ushort *) (PPC_AG_SLAB(agents, i) + SLAB_SIZE)) \
+		[(i) % SLAB_SIZE])
+#define PPC_AG_TA(agents, i) \
+	(((__global PPCAgentTAOcl *) \
+		(PPC_AG_SLAB(agents, i) + SLAB_SIZE + SLAB_SIZE / 2)) \
+		[(i) % SLAB_SIZE])
+#define PPC_AG_TYPE(agents, i) (PPC_AG_TA(agents, i).type)
+#define PPC_AG_ACTION(agents, i) (PPC_AG_TA(agents, i).action)
+
+/* Store agent ag in position i. */
+#define PPC_AG_STORE(agents, i, ag) \
+	do { \
+		PPC_AG_NEXT(agents, i) = (ag).next; \
+		PPC_AG_ENERGY(agents, i) = (ag).in.sep.energy; \
+		PPC_AG_TYPE(agents, i) = (ag).in.sep.type; \
+		PPC_AG_ACTION(agents, i) = (ag).in.sep.action; \
+	} while (0)
+
+#else
+
+/* Agents are stored as an array of structures. */
+typedef PPCAgentOcl PPCAgentStoreOcl;
+
+/* Fields of agent with index i. */
+#define PPC_AG_NEXT(agents, i) ((agents)[i].next)
+#define PPC_AG_ENERGY(agents, i) ((agents)[i].in.sep.energy)
+#define PPC_AG_TYPE(agents, i) ((agents)[i].in.sep.type)
+#define PPC_AG_ACTION(agents, i) ((agents)[i].in.sep.action)
+
+/* Store agent ag in position i. */
+#define PPC_AG_STORE(agents, i, ag) ((agents)[i] = (ag))
+
+#endif
+
+/**
+ * Cell state. The grass state of each cell is kept in a separate array,
+ * where zero means the grass exists in the cell, and a positive value
+ * represents the number of iterations until grass regrows. This keeps grass
+ * contiguous, so that it can be grown with vector operations.
  * */
 typedef struct pp_c_cell_ocl {
 
-	/** Grass state. Zero means the grass exists in this cell, and a positive
-	 * value represents the number of iterations until grass regrows. */
-	uint grass;
-
-	/** Pointer to first agent in cell. */
-	uint agent_pointer;
+	/** Pointers to first agent in cell, one for each agent type (indexed
+	 * by `SHEEP_ID` and `WOLF_ID`). Keeping sheep and wolves in separate
+	 * lists lets wolves find prey in constant time, and lets each action
+	 * only walk the agents it concerns. */
+	uint agent_pointer[NUM_AG_TYPES];
 
 } PPCCellOcl;
 
+/**
+ * Agent allocator state of one work-item.
+ *
+ * Each work-item owns the slots of the slabs it claimed from the global
+ * slab counter, plus the slots of the agents which died in the cells it
+ * processed. Except in the on-demand schedule, work-items always process
+ * the same rows, so freed slots are reused by newborns of the same rows,
+ * keeping agents close to their cells in memory.
+ * */
+typedef struct pp_c_alloc_ocl {
+
+	/** First slot in the list of free slots, linked through the `next`
+	 * field of dead agents. */
+	uint free_head;
+
+	/** Next unused slot in the current slab. */
+	uint slab_next;
+
+	/** End (exclusive) of the current slab. */
+	uint slab_end;
+
+} PPCAllocOcl;
+
+/**
+ * Range of agents in a cell, used by the cell-ordered (CSR) engine, where
+ * the agents of each cell are stored contiguously in the agents array.
+ * */
+typedef struct pp_c_range_ocl {
+
+	/** Index of first agent in cell. */
+	uint start;
+
+	/** Index after the last agent in cell. While the agents arrays is being
+	 * rebuilt, this is first used to count the agents moving into the cell,
+	 * and then as the cursor where to place the next one. */
+	uint end;
+
+} PPCRangeOcl;
+
 /**
  * Remove agent from cell.
  *
  * @param agents Global agent array.
  * @param cells Array of cells.
  * @param cell_idx Index of cell from which to remove agent.
+ * @param type Type of agent to be removed from cell.
  * @param ag_idx Index of agent (with respect to the global agents array) to be
  * removed from cell.
  * @param prev_ag_idx Index of agent (with respect to the global agents array)
- * which comes before the agent to be removed (with respect to the agent list in
- * the given cell). If set to `END_OF_AG_LIST`, it means there is no previous
- * agent, i.e., the agent to remove is the first in cell.
+ * which comes before the agent to be removed (with respect to the agent list of
+ * the given type in the given cell). If set to `END_OF_AG_LIST`, it means
+ * there is no previous agent, i.e., the agent to remove is the first of its
+ * type in cell.
  */
-void rem_ag_from_cell(__global PPCAgentOcl * agents,
+void rem_ag_from_cell(__global PPCAgentStoreOcl * agents,
 		__global PPCCellOcl * cells,
 		uint cell_idx,
+		uint type,
 		uint ag_idx,
 		uint prev_ag_idx) {
 
@@ -135,12 +320,12 @@ void rem_ag_from_cell(__global PPCAgentOcl * agents,
 	if (prev_ag_idx == END_OF_AG_LIST) {
 
 		/* Agent index given by a cell. */
-		cells[cell_idx].agent_pointer = agents[ag_idx].next;
+		cells[cell_idx].agent_pointer[type] = PPC_AG_NEXT(agents, ag_idx);
 
 	} else {
 
 		/* Agent index given by another agent. */
-		agents[prev_ag_idx].next = agents[ag_idx].next;
+		PPC_AG_NEXT(agents, prev_ag_idx) = PPC_AG_NEXT(agents, ag_idx);
 	}
 
 	/* It's the callers responsability of setting agent's energy to
@@ -152,18 +337,20 @@ void rem_ag_from_cell(__global PPCAgentOcl * agents,
  *
  * @param agents Global agent array.
  * @param cells Array of cells.
+ * @param type Type of agent to add to cell.
  * @param ag_idx Index of agent (with respect to the global agents array) to
  * add to cell.
  * @param cell_idx Index of cell to which the agent will be added.
  */
-void add_ag_to_cell(__global PPCAgentOcl * agents,
+void add_ag_to_cell(__global PPCAgentStoreOcl * agents,
 		__global PPCCellOcl * cells,
+		uint type,
 		uint ag_idx,
 		uint cell_idx) {
 
 	/* Put agent in place and update cell. */
-	agents[ag_idx].next = cells[cell_idx].agent_pointer;
-	cells[cell_idx].agent_pointer = ag_idx;
+	PPC_AG_NEXT(agents, ag_idx) = cells[cell_idx].agent_pointer[type];
+	cells[cell_idx].agent_pointer[type] = ag_idx;
 
 	/* It's the callers responsability that agent has energy > 0. */
 }
@@ -171,59 +358,112 @@ void add_ag_to_cell(__global PPCAgentOcl * agents,
 /**
  * Allocate a place in the global agents array to put a new agent.
  *
- * This function uses a random allocation strategy, and works well if
- * `MAX_AGENTS` >> actual number of agents.
+ * Slots are first taken from the work-item's free list. If the free list is
+ * empty, the next unused slot of the work-item's current slab is used, and a
+ * new slab is claimed from the global slab counter when the current one is
+ * exhausted. As such, allocations are O(1) and only touch global atomics once
+ * every `SLAB_SIZE` allocations. The number of slabs available is set by the
+ * host, which grows the agents array before the allocator runs out of slabs.
  *
  * @param agents Global agent array.
- * @param seeds Array of PRNG seeds.
+ * @param alloc Allocator state of the current work-item.
+ * @param slabs Global counter of slabs already handed out, followed by the
+ * number of slabs available.
  * @return An index (with respect to the global agents array) to where to place
- * the new agent.
+ * the new agent, or `END_OF_AG_LIST` if there is no space left.
  */
-uint alloc_ag_idx(
-	__global PPCAgentOcl * agents,
-	__global clo_statetype* seeds) {
+uint alloc_ag_idx(__global PPCAgentStoreOcl * agents,
+	PPCAllocOcl * alloc,
+	__global uint * slabs) {
 
 	/* Index of place to put agent. */
 	uint ag_idx;
 
-	/* Allocation attempts. */
-	uint attempts = 0;
+	/* Is there a free slot in the free list? */
+	if (alloc->free_head != END_OF_AG_LIST) {
 
-	/* Get one value from global RNG. This way allocations only change the RNG
-	 * once, allowing for reproducible simulations. */
-	uint state = clo_rng_next(seeds, get_global_id(0));
+		/* Yes, pop it from the free list. */
+		ag_idx = alloc->free_head;
+		alloc->free_head = PPC_AG_NEXT(agents, ag_idx);
 
-	/* Find a place for the agent to stay. */
-	while (1) {
+	} else {
 
-		/* If maximum number of allocation attempts was exceeded, give up. */
-		if (++attempts >= MAX_ALLOC_ATTEMPTS) {
-			ag_idx = END_OF_AG_LIST;
-			break;
-		}
+		/* No, so use the current slab. If the current slab is exhausted,
+		 * claim a new one. */
+		if (alloc->slab_next == alloc->slab_end) {
 
-		/* Get a valid agent location. */
-		ag_idx = state % MAX_AGENTS;
+			/* Get index of next available slab. */
+			uint slab = atomic_inc(slabs);
 
-		/* Check if location is available. */
-		if (atomic_cmpxchg(
-			&agents[ag_idx].in.merg, (uint) 0, (uint) 1) == 0) {
-			break;
-		}
+			/* If there are no more slabs available, give up. */
+			if (slab >= slabs[SLABS_AVAILABLE]) return END_OF_AG_LIST;
 
-		/* If we got here, we need to find another location. Get another
-		 * pseudo-random state from which the next agent location will be
-		 * derived. This is a simple XorShift PRNG. */
-		state ^= (state << 21);
-		state ^= (state >> 35);
-		state ^= (state << 4);
+			/* Set new slab as current slab. */
+			alloc->slab_next = slab * SLAB_SIZE;
+			alloc->slab_end = alloc->slab_next + SLAB_SIZE;
+		}
 
+		/* Take next slot from current slab. */
+		ag_idx = alloc->slab_next++;
 	}
 
 	/* Return index of place where to put agent. */
 	return ag_idx;
 }
 
+/**
+ * Release the place of a dead agent in the global agents array, putting it in
+ * the free list of the current work-item.
+ *
+ * @param agents Global agent array.
+ * @param alloc Allocator state of the current work-item.
+ * @param ag_idx Index of agent (with respect to the global agents array) to
+ * release. The agent must have been removed from its cell already.
+ */
+void free_ag_idx(__global PPCAgentStoreOcl * agents,
+	PPCAllocOcl * alloc,
+	uint ag_idx) {
+
+	/* Push its place into the free list. Dead agents are not in any cell
+	 * list, so their remaining fields don't need to be touched. */
+	PPC_AG_NEXT(agents, ag_idx) = alloc->free_head;
+	alloc->free_head = ag_idx;
+}
+
+/**
+ * Swap the internal state (energy, type and action) of two agents, leaving
+ * their next pointers untouched.
+ *
+ * @param agents Global agents array.
+ * @param ag_idx1 Index of first agent.
+ * @param ag_idx2 Index of second agent.
+ */
+void swap_agents_state(__global PPCAgentStoreOcl * agents,
+	uint ag_idx1,
+	uint ag_idx2) {
+
+#ifdef PPC_AG_SOA
+
+	/* Swap energy and type|action arrays. */
+	ushort energy = PPC_AG_ENERGY(agents, ag_idx1);
+	PPCAgentTAOcl ta = PPC_AG_TA(agents, ag_idx1);
+	PPC_AG_ENERGY(agents, ag_idx1) = PPC_AG_ENERGY(agents, ag_idx2);
+	PPC_AG_TA(agents, ag_idx1) = PPC_AG_TA(agents, ag_idx2);
+	PPC_AG_ENERGY(agents, ag_idx2) = energy;
+	PPC_AG_TA(agents, ag_idx2) = ta;
+
+#else
+
+	/* Swap internal agent state (energy + type + action) as one
+	 * variable. */
+	uint ag_internal = agents[ag_idx1].in.merg;
+	agents[ag_idx1].in.merg = agents[ag_idx2].in.merg;
+	agents[ag_idx2].in.merg = ag_internal;
+
+#endif
+
+}
+
 /**
  * Shuffle agents in cell using the Durstenfeld version of the Fisher-Yates
  * shuffle.
@@ -233,7 +473,7 @@ uint alloc_ag_idx(
  * @param ag_pointers Array of pointers of agents to shuffle.
  * @param idx Index of last agent in the `ag_pointers` array.
  */
-void shuffle_agents(__global PPCAgentOcl * agents,
+void shuffle_agents(__global PPCAgentStoreOcl * agents,
 	__global clo_statetype* seeds,
 	uint * ag_pointers,
 	uint idx) {
@@ -244,18 +484,72 @@ void shuffle_agents(__global PPCAgentOcl * agents,
 		/* Get a random index for the ag_pointers array. */
 		uint j = clo_rng_next_int(seeds, i + 1);
 
-		/* Get internal agent state (energy + type) from current loop index. */
-		ulong ag_internal = agents[ag_pointers[i]].in.merg;
+		/* Swap internal agent state (energy + type) between current loop
+		 * index and random index. */
+		swap_agents_state(agents, ag_pointers[i], ag_pointers[j]);
+
+	}
+}
+
+/**
+ * Shuffle an agent list, in chunks of at most `MAX_AGENT_SHUF` agents.
+ *
+ * @param agents Global agents array.
+ * @param seeds Array of PRNG seeds.
+ * @param ag_pointers Array for keeping pointers of agents to shuffle.
+ * @param ag_ptr Pointer to first agent in list.
+ * @return Number of agents in list.
+ */
+uint shuffle_ag_list(__global PPCAgentStoreOcl * agents,
+	__global clo_statetype* seeds,
+	uint * ag_pointers,
+	uint ag_ptr) {
+
+	/* Number of agents in list. */
+	uint num_agents = 0;
+	uint idx = 0;
+
+	/* Copy pointers to an array, and shuffle agents using
+	 * that array. */
+	while (1) {
+
+		/* Copy next pointer to array. */
+		ag_pointers[idx] = ag_ptr;
+
+		/* If this is the last agent... */
+		if (ag_ptr == END_OF_AG_LIST) {
+
+			/* ...shuffle agent list using the array of
+			 * pointers... */
+			shuffle_agents(agents, seeds, ag_pointers, idx);
+
+			/* ...and get out. */
+			break;
+		}
+
+		/* Increment array index and agent count. */
+		idx++;
+		num_agents++;
+
+		/* If we're over the array limit... */
+		if (idx >= MAX_AGENT_SHUF) {
 
-		/* Put internal agent state (energy + type) from random index into
-		 * current loop index. */
-		agents[ag_pointers[i]].in.merg = agents[ag_pointers[j]].in.merg;
+			/* ...shuffle agent list using the array of
+			 * pointers... */
+			shuffle_agents(agents, seeds, ag_pointers, idx);
 
-		/* Put internal agent state (energy + type) from current loop index
-		 * into random index. */
-		agents[ag_pointers[j]].in.merg = ag_internal;
+			/* ...and reset the array index in order to start
+			 * over. */
+			idx = 0;
+		}
+
+		/* Update the agent pointer. */
+		ag_ptr = PPC_AG_NEXT(agents, ag_ptr);
 
 	}
+
+	/* Return number of agents in list. */
+	return num_agents;
 }
 
 /**
@@ -327,13 +621,22 @@ uint random_walk(__global clo_statetype* seeds, uint cell_idx) {
  *
  * @param agents Global agent array.
  * @param cells Array of cells.
- * @param stats Array of simulation statistics.
+ * @param grass Grass countdown of each cell.
+ * @param parts Partial statistics of each work-item.
  * @param seeds Array of PRNG seeds.
+ * @param allocs Agent allocator state of each work-item.
+ * @param slabs Global counter of slabs already handed out, followed by the
+ * number of slabs available.
+ * @param regrow Regrowth histogram, initially zero.
  * */
-__kernel void init(__global PPCAgentOcl * agents,
+__kernel void init(__global PPCAgentStoreOcl * agents,
 		__global PPCCellOcl * cells,
-		__global PPStatisticsOcl * stats,
-		__global clo_statetype * seeds) {
+		__global uint * grass,
+		__global PPStatisticsOcl * parts,
+		__global clo_statetype * seeds,
+		__global PPCAllocOcl * allocs,
+		__global uint * slabs,
+		__global uint * regrow) {
 
 	/* Get global ID. */
 	uint gid = get_global_id(0);
@@ -366,12 +669,16 @@ __kernel void init(__global PPCAgentOcl * agents,
 	/* Total number of agents. */
 	uint num_agents = num_sheep + num_wolves;
 
-	/* Determine base and offset indexes for placing new agents in the
-	 * agents array. */
-	uint new_ag_idx_base = num_agents * gid;
-	uint new_ag_idx_offset = 0;
+	/* Initialize allocator state for this work item, which starts with
+	 * no free slots and no slab. */
+	PPCAllocOcl alloc;
+	alloc.free_head = END_OF_AG_LIST;
+	alloc.slab_next = 0;
+	alloc.slab_end = 0;
 
 	/* Initialize stats. */
+	uint sheep_count = 0;
+	uint wolves_count = 0;
 	uint tot_sheep_en = 0;
 	uint tot_wolves_en = 0;
 	uint tot_grass_en = 0;
@@ -389,25 +696,40 @@ __kernel void init(__global PPCAgentOcl * agents,
 		if (alive) {
 
 			/* Alive. */
-			cells[i].grass = 0;
+			grass[i] = 0;
 			if (alive) grass_alive++;
 
 		} else {
 
 			/* Dead. Set coundown. */
 			uint countdown = clo_rng_next_int(seeds, GRASS_RESTART) + 1;
-			cells[i].grass = countdown;
+			grass[i] = countdown;
 			tot_grass_en += countdown;
 
+#ifdef PP_GRASS_STATS_INC
+			/* Grass regrows when the countdown reaches zero. */
+			atomic_inc(&regrow[PP_GRASS_REGROW_IDX(countdown, GRASS_RESTART)]);
+#endif
+
 		}
 
-		/* Initialize agent pointer. */
-		cells[i].agent_pointer = END_OF_AG_LIST;
+		/* Initialize agent pointers. */
+		for (uint type = 0; type < NUM_AG_TYPES; ++type)
+			cells[i].agent_pointer[type] = END_OF_AG_LIST;
 	}
 
 	/* Initialize agents. */
 	for (uint i = 0; i < num_agents; ++i) {
 
+		/* Get a place in the agents array for the new agent. */
+		uint new_ag_idx = alloc_ag_idx(agents, &alloc, slabs);
+
+		/* If there is no space left, the agent will not be created. */
+		if (new_ag_idx == END_OF_AG_LIST) {
+			errors++;
+			continue;
+		}
+
 		/* Create agent. */
 		PPCAgentOcl agent;
 		agent.in.sep.action = 0;
@@ -419,6 +741,7 @@ __kernel void init(__global PPCAgentOcl * agents,
 			agent.in.sep.energy =
 				clo_rng_next_int(seeds, SHEEP_GAIN_FROM_FOOD * 2) + 1;
 			agent.in.sep.type = SHEEP_ID;
+			sheep_count++;
 			tot_sheep_en += agent.in.sep.energy;
 
 		} else {
@@ -427,6 +750,7 @@ __kernel void init(__global PPCAgentOcl * agents,
 			agent.in.sep.energy =
 				clo_rng_next_int(seeds, WOLVES_GAIN_FROM_FOOD * 2) + 1;
 			agent.in.sep.type = WOLF_ID;
+			wolves_count++;
 			tot_wolves_en += agent.in.sep.energy;
 
 		}
@@ -435,111 +759,94 @@ __kernel void init(__global PPCAgentOcl * agents,
 		uint cell_idx =
 			cell_idx_start + clo_rng_next_int(seeds, num_cells);
 
-		/* Determine absolute index of agent in agents array. */
-		uint new_ag_idx = new_ag_idx_base + new_ag_idx_offset;
-
 		/* Put new agent in this cell */
-		agent.next = cells[cell_idx].agent_pointer;
-		cells[cell_idx].agent_pointer = new_ag_idx;
+		agent.next = cells[cell_idx].agent_pointer[agent.in.sep.type];
+		cells[cell_idx].agent_pointer[agent.in.sep.type] = new_ag_idx;
 
 		/* Save new agent in agent array */
-		agents[new_ag_idx] = agent;
-
-		/* Increase index offset for next agent. */
-		new_ag_idx_offset++;
+		PPC_AG_STORE(agents, new_ag_idx, agent);
 
 	}
 
-	/* Update global stats */
-	atomic_add(&stats[0].sheep, num_sheep);
-	atomic_add(&stats[0].wolves, num_wolves);
-	atomic_add(&stats[0].grass, grass_alive);
+	/* Save allocator state for this work item. */
+	allocs[gid] = alloc;
+
+	/* Save partial stats for this work item. */
+	parts[gid].sheep = sheep_count;
+	parts[gid].wolves = wolves_count;
+	parts[gid].grass = grass_alive;
 
-	atomic_add(&stats[0].sheep_en, tot_sheep_en);
-	atomic_add(&stats[0].wolves_en, tot_wolves_en);
-	atomic_add(&stats[0].grass_en, tot_grass_en);
+	parts[gid].sheep_en = tot_sheep_en;
+	parts[gid].wolves_en = tot_wolves_en;
+	parts[gid].grass_en = tot_grass_en;
 
-	atomic_add(&stats[0].errors, errors);
+	parts[gid].errors = errors;
 }
 
 
 /**
- * The step 1 kernel.
- *
- * This kernel performs agent movement and grows grass in cells.
+ * Move agents in a span of cells.
  *
  * @param agents Global agent array.
  * @param cells Array of cells.
  * @param seeds Array of PRNG seeds.
- * @param turn Number of times the kernel has been invoked in the current
- * iteration.
+ * @param alloc Allocator state of the current work-item.
+ * @param idx_start Index of first cell to process.
+ * @param idx_stop Index after last cell to process.
+ * @return Work performed, i.e. number of cells plus number of agents
+ * visited.
  */
-__kernel void step1(__global PPCAgentOcl * agents,
+uint move_agents_span(__global PPCAgentStoreOcl * agents,
 		__global PPCCellOcl * cells,
 		__global clo_statetype * seeds,
-		__private uint turn) {
-
-	/* Determine row to process */
-	uint y = turn + get_global_id(0) * ROWS_PER_WORKITEM;
+		PPCAllocOcl * alloc,
+		uint idx_start,
+		uint idx_stop) {
 
-	/* Check if this work-item has to process anything */
-	if (y < GRID_Y) {
-
-		/* Determine start of row. */
-		uint idx_start = y * GRID_X;
-
-		/* Determine end of row: if this is not the last work-item
-		 * (condition 1) OR if this is not the last row to process
-		 * (condition 2), then process current row until the end.
-		 * Otherwise, process all remaining cells until the end. */
-		uint idx_stop = (get_global_id(0) < get_global_size(0) - 1)
-						|| (turn < ROWS_PER_WORKITEM - 1)
-			? idx_start + GRID_X
-			: GRID_XY;
+	/* Work performed, starting with the cells. */
+	uint work = idx_stop - idx_start;
 
-		/* Cycle through cells in line */
-		for (uint cell_idx = idx_start; cell_idx < idx_stop; cell_idx++) {
+	/* Cycle through cells in line */
+	for (uint cell_idx = idx_start; cell_idx < idx_stop; cell_idx++) {
 
-			/* *** Grow grass. *** */
-			if (cells[cell_idx].grass > 0)
-				cells[cell_idx].grass--;
+		/* *** Move agents, one agent list at a time. *** */
+		for (uint type = 0; type < NUM_AG_TYPES; ++type) {
 
-			/* *** Move agents. *** */
+			/* Get first agent of this type in cell. */
+			uint ag_idx = cells[cell_idx].agent_pointer[type];
 
-			/* Get first agent in cell. */
-			uint ag_idx = cells[cell_idx].agent_pointer;
-
-			/* The following indicates that current index was obtained via cell,
-			 * and not via agent.next */
+			/* The following indicates that current index was obtained via
+			 * cell, and not via agent.next */
 			uint prev_ag_idx = END_OF_AG_LIST;
 
 			/* Cycle through agents in cell. */
 			while (ag_idx != END_OF_AG_LIST) {
 
 				/* Get index of next agent. */
-				uint next_ag_idx = agents[ag_idx].next;
+				uint next_ag_idx = PPC_AG_NEXT(agents, ag_idx);
+				work++;
 
-				/* Let's see if agent hasn't yet moved and doesn't have enough
-				 * energy left... */
-				if ((agents[ag_idx].in.sep.energy <= 1)
-					&& (!agents[ag_idx].in.sep.action)) {
+				/* Let's see if agent hasn't yet moved and doesn't have
+				 * enough energy left... */
+				if ((PPC_AG_ENERGY(agents, ag_idx) <= 1)
+					&& (!PPC_AG_ACTION(agents, ag_idx))) {
 
-					/* Agent doesn't have enough energy to stay alive, so
-					 * kill him... */
-					agents[ag_idx].in.merg = 0;
+					/* Agent doesn't have enough energy to stay alive,
+					 * so remove him from the cell... */
+					rem_ag_from_cell(agents, cells,
+						cell_idx, type, ag_idx, prev_ag_idx);
 
-					/* ...and remove him from the cell. */
-					rem_ag_from_cell(
-						agents, cells, cell_idx, ag_idx, prev_ag_idx);
+					/* ...and kill him, releasing his place. */
+					free_ag_idx(agents, alloc, ag_idx);
 
 				/* If agent has enough energy and hasn't moved yet... */
-				} else if (!agents[ag_idx].in.sep.action) {
+				} else if (!PPC_AG_ACTION(agents, ag_idx)) {
 
 					/* Set move action as performed. */
-					agents[ag_idx].in.sep.action = 1;
+					PPC_AG_ACTION(agents, ag_idx) = 1;
 
 					/* Decrement energy. */
-					agents[ag_idx].in.sep.energy--;
+					PPC_AG_ENERGY(agents, ag_idx)--;
 
 					/* Get a destination. */
 					uint neigh_idx = random_walk(seeds, cell_idx);
@@ -548,10 +855,10 @@ __kernel void step1(__global PPCAgentOcl * agents,
 					if (neigh_idx != cell_idx) {
 
 						/* If agent wants to move, then move him. */
-						rem_ag_from_cell(
-							agents, cells, cell_idx, ag_idx, prev_ag_idx);
+						rem_ag_from_cell(agents, cells,
+							cell_idx, type, ag_idx, prev_ag_idx);
 						add_ag_to_cell(
-							agents, cells, ag_idx, neigh_idx);
+							agents, cells, type, ag_idx, neigh_idx);
 
 						/* Because this agent moved out of here,
 						 * previous agent remains the same. */
@@ -577,292 +884,1905 @@ __kernel void step1(__global PPCAgentOcl * agents,
 			}
 		}
 	}
+
+	/* Return work performed. */
+	return work;
 }
 
 /**
- * The step 2 kernel.
- *
- * This kernel performs agent actions and gathers simulation statistics at the
- * end of the current iteration.
+ * Perform agent actions in a span of cells and gather their statistics.
  *
  * @param agents Global agent array.
  * @param cells Array of cells.
+ * @param grass Grass countdown of each cell, or iteration at which it
+ * regrows if `PP_GRASS_LAZY` is defined.
  * @param seeds Array of PRNG seeds.
- * @param stats Array of simulation statistics.
+ * @param alloc Allocator state of the current work-item.
+ * @param slabs Global counter of slabs already handed out, followed by the
+ * number of slabs available.
+ * @param st Partial statistics, to be updated with those of the given cells.
+ * With `PP_GRASS_STATS_INC`, the grass count is incremented for each cell
+ * whose grass is eaten, and the grass countdown is not updated.
+ * @param idx_start Index of first cell to process.
+ * @param idx_stop Index after last cell to process.
  * @param iter Current iteration.
- * @param turn Number of times the kernel has been invoked in the current
- * iteration.
+ * @return Work performed, i.e. number of cells plus number of agents
+ * which acted.
  */
-__kernel void step2(__global PPCAgentOcl * agents,
+uint act_agents_span(__global PPCAgentStoreOcl * agents,
 		__global PPCCellOcl * cells,
+		__global uint * grass,
 		__global clo_statetype * seeds,
-		__global PPStatisticsOcl * stats,
-		__private uint iter,
-		__private uint turn) {
-
-	/* Reset partial statistics */
-	uint sheep_count = 0;
-	uint wolves_count = 0;
-	uint grass_count = 0;
-	uint tot_sheep_en = 0;
-	uint tot_wolves_en = 0;
-	uint tot_grass_en = 0;
-	uint tot_errors = 0;
+		PPCAllocOcl * alloc,
+		__global uint * slabs,
+		PPStatisticsOcl * st,
+		uint idx_start,
+		uint idx_stop,
+		uint iter) {
 
 	/* Array with agent pointers, for shuffling purposes.*/
 	uint ag_pointers[MAX_AGENT_SHUF];
 
-	/* Determine row to process. */
-	uint y = turn + get_global_id(0) * ROWS_PER_WORKITEM;
+	/* Work performed, starting with the cells. */
+	uint work = idx_stop - idx_start;
 
-	/* Check if this thread has to process anything */
-	if (y < GRID_Y) {
+	/* Cycle through cells in line */
+	for (uint cell_idx = idx_start; cell_idx < idx_stop; cell_idx++) {
 
-		/* Determine start of row. */
-		uint idx_start = y * GRID_X;
+		/* Pointer for current agent. */
+		uint ag_ptr;
 
-		/* Determine end of row: if this is not the last work-item
-		 * (condition 1) OR this is not the last row to process
-		 * (condition 2), then process current row until the end.
-		 * Otherwise, process all remaining cells until the end. */
-		uint idx_stop = (get_global_id(0) < get_global_size(0) - 1)
-						|| (turn < ROWS_PER_WORKITEM - 1)
-			? idx_start + GRID_X
-			: GRID_XY;
+		/* Next agent to act in each agent list. */
+		uint ag_ptr_next[NUM_AG_TYPES];
+		ag_ptr_next[SHEEP_ID] = cells[cell_idx].agent_pointer[SHEEP_ID];
+		ag_ptr_next[WOLF_ID] = cells[cell_idx].agent_pointer[WOLF_ID];
 
-		/* Cycle through cells in line */
-		for (uint cell_idx = idx_start; cell_idx < idx_stop; cell_idx++) {
+#if MAX_AGENT_SHUF > 1
 
-			/* Pointer for current agent. */
-			uint ag_ptr;
+		/* *** Shuffle agent lists. *** */
 
-#if MAX_AGENT_SHUF > 1
+		/* Number of agents yet to act in each agent list. */
+		uint num_ag_left[NUM_AG_TYPES];
+		num_ag_left[SHEEP_ID] = shuffle_ag_list(
+			agents, seeds, ag_pointers, ag_ptr_next[SHEEP_ID]);
+		num_ag_left[WOLF_ID] = shuffle_ag_list(
+			agents, seeds, ag_pointers, ag_ptr_next[WOLF_ID]);
 
-			/* *** Shuffle agent list. *** */
+#endif
 
-			/* Get pointer to first agent. */
-			ag_ptr = cells[cell_idx].agent_pointer;
-			uint idx = 0;
+		/* First and last newly born agent pointers of each type. */
+		uint new_ag_ptr_first[NUM_AG_TYPES];
+		uint new_ag_ptr_last[NUM_AG_TYPES];
+		for (uint type = 0; type < NUM_AG_TYPES; ++type) {
+			new_ag_ptr_first[type] = END_OF_AG_LIST;
+			new_ag_ptr_last[type] = END_OF_AG_LIST;
+		}
 
-			/* Copy pointers to an array, and shuffle agents using
-			 * that array. */
-			while (1) {
+		/* For each agent in cell */
+		while ((ag_ptr_next[SHEEP_ID] != END_OF_AG_LIST)
+			|| (ag_ptr_next[WOLF_ID] != END_OF_AG_LIST)) {
 
-				/* Copy next pointer to array. */
-				ag_pointers[idx] = ag_ptr;
+			/* Type of next agent to act. */
+			uint type;
 
-				/* If this is the last agent... */
-				if (ag_ptr == END_OF_AG_LIST) {
+#if MAX_AGENT_SHUF > 1
 
-					/* ...shuffle agent list using the array of
-					 * pointers... */
-					shuffle_agents(agents, seeds, ag_pointers, idx);
+			/* Interleave the shuffled lists at random, so that the
+			 * agents in the cell act in a random order. */
+			if (num_ag_left[WOLF_ID] == 0)
+				type = SHEEP_ID;
+			else if (num_ag_left[SHEEP_ID] == 0)
+				type = WOLF_ID;
+			else
+				type = clo_rng_next_int(seeds,
+						num_ag_left[SHEEP_ID] + num_ag_left[WOLF_ID])
+					< num_ag_left[SHEEP_ID] ? SHEEP_ID : WOLF_ID;
+			num_ag_left[type]--;
 
-					/* ...and get out. */
-					break;
-				}
+#else
 
-				/* Increment array index. */
-				idx++;
+			/* Without shuffling, sheep act before wolves. */
+			type = ag_ptr_next[SHEEP_ID] != END_OF_AG_LIST
+				? SHEEP_ID : WOLF_ID;
 
-				/* If we're over the array limit... */
-				if (idx >= MAX_AGENT_SHUF) {
+#endif
 
-					/* ...shuffle agent list using the array of
-					 * pointers... */
-					shuffle_agents(agents, seeds, ag_pointers, idx);
+			/* Get agent and advance in its list. */
+			ag_ptr = ag_ptr_next[type];
+			ag_ptr_next[type] = PPC_AG_NEXT(agents, ag_ptr);
+			work++;
 
-					/* ...and reset the array index in order to start
-					 * over. */
-					idx = 0;
-				}
+			/* Set agent action as performed. */
+			PPC_AG_ACTION(agents, ag_ptr) = 0;
 
-				/* Update the agent pointer. */
-				ag_ptr = agents[ag_ptr].next;
+			/* *** Agent actions. *** */
 
-			}
+			/* Is agent a sheep? */
+			if (type == SHEEP_ID) {
+
+				/* If there is grass... */
+				if (PP_GRASS_ALIVE(grass[cell_idx], iter)) {
+
+					/* ...eat grass... */
+					grass[cell_idx] = PP_GRASS_EATEN(iter, GRASS_RESTART);
+#ifdef PP_GRASS_STATS_INC
+					st->grass++;
 #endif
 
-			/* First and last newly born agent pointers. */
-			uint new_ag_ptr_first = END_OF_AG_LIST;
-			uint new_ag_ptr_last = END_OF_AG_LIST;
+					/* ...and gain energy! */
+					PPC_AG_ENERGY(agents, ag_ptr) += SHEEP_GAIN_FROM_FOOD;
+				}
+
+				/* Update sheep stats. */
+				st->sheep++;
+				st->sheep_en += PPC_AG_ENERGY(agents, ag_ptr);
 
-			/* For each agent in cell */
-			ag_ptr = cells[cell_idx].agent_pointer;
-			while (ag_ptr != END_OF_AG_LIST) {
+			/* Or is agent a wolf? */
+			} else {
 
+				/* Look for sheep, which is the first one in the sheep
+				 * list, if any. */
+				uint sheep_ptr = cells[cell_idx].agent_pointer[SHEEP_ID];
 
-				/* Set agent action as performed. */
-				agents[ag_ptr].in.sep.action = 0;
+				/* Is there a sheep? */
+				if (sheep_ptr != END_OF_AG_LIST) {
 
-				/* *** Agent actions. *** */
+					/* It is sheep, eat it! */
 
-				/* Is agent a sheep? */
-				if (agents[ag_ptr].in.sep.type == SHEEP_ID) {
+					/* Did sheep already act? */
+					if (sheep_ptr != ag_ptr_next[SHEEP_ID]) {
 
-					/* If there is grass... */
-					if (cells[cell_idx].grass == 0) {
+						/* Yes, update sheep stats. */
+						st->sheep--;
+						st->sheep_en -= PPC_AG_ENERGY(agents, sheep_ptr);
 
-						/* ...eat grass... */
-						cells[cell_idx].grass = GRASS_RESTART;
+					} else {
 
-						/* ...and gain energy! */
-						agents[ag_ptr].in.sep.energy += SHEEP_GAIN_FROM_FOOD;
+						/* No, so it will not act. */
+						ag_ptr_next[SHEEP_ID] =
+							PPC_AG_NEXT(agents, sheep_ptr);
+#if MAX_AGENT_SHUF > 1
+						num_ag_left[SHEEP_ID]--;
+#endif
 					}
 
-					/* Update sheep stats. */
-					sheep_count++;
-					tot_sheep_en += agents[ag_ptr].in.sep.energy;
+					/* Remove sheep from cell. */
+					rem_ag_from_cell(agents, cells,
+						cell_idx, SHEEP_ID, sheep_ptr, END_OF_AG_LIST);
 
-				/* Or is agent a wolf? */
-				} else {
+					/* Set sheep energy to zero, releasing its
+					 * place. */
+					free_ag_idx(agents, alloc, sheep_ptr);
 
-					/* Look for sheep... */
-					uint local_ag_ptr = cells[cell_idx].agent_pointer;
-					uint prev_ag_ptr = END_OF_AG_LIST;
+					/* Increment wolf energy. */
+					PPC_AG_ENERGY(agents, ag_ptr) +=
+						WOLVES_GAIN_FROM_FOOD;
 
-					/* ...while there are agents to look for. */
-					while (local_ag_ptr != END_OF_AG_LIST) {
+				}
+
+				/* Update wolves stats. */
+				st->wolves++;
+				st->wolves_en += PPC_AG_ENERGY(agents, ag_ptr);
 
-						/* Get next agent. */
-						uint next_ag_ptr = agents[local_ag_ptr].next;
+			}
 
-						/* Is current agent a sheep? */
-						if (agents[local_ag_ptr].in.sep.type == SHEEP_ID) {
+			/* Try to reproduce agent. */
 
-							/* It is sheep, eat it! */
+			uint reproduce_threshold = type == SHEEP_ID
+				? SHEEP_REPRODUCE_THRESHOLD
+				: WOLVES_REPRODUCE_THRESHOLD;
 
-							/* If sheep already acted, update sheep stats. */
-							if (agents[local_ag_ptr].in.sep.action == 0) {
+			/* Perhaps agent will reproduce if
+			 * energy > reproduce_threshold ? */
+			if (PPC_AG_ENERGY(agents, ag_ptr) > reproduce_threshold) {
 
-								sheep_count--;
-								tot_sheep_en -=
-									agents[local_ag_ptr].in.sep.energy;
+				uint reproduce_prob = type == SHEEP_ID
+					? SHEEP_REPRODUCE_PROB
+					: WOLVES_REPRODUCE_PROB;
 
-							}
+				/* Throw dice to see if agent reproduces */
+				if (clo_rng_next_int(seeds, 100) < reproduce_prob) {
 
-							/* Set sheep energy to zero. */
-							agents[local_ag_ptr].in.merg = 0;
+					/* Agent will reproduce!
+					 * Let's find some space for new agent... */
+					uint new_ag_idx =
+						alloc_ag_idx(agents, alloc, slabs);
 
-							/* Remove sheep from cell. */
-							rem_ag_from_cell(agents, cells,
-								cell_idx, local_ag_ptr, prev_ag_ptr);
+					if (new_ag_idx != END_OF_AG_LIST) {
 
-							/* Increment wolf energy. */
-							agents[ag_ptr].in.sep.energy +=
-								WOLVES_GAIN_FROM_FOOD;
+						/* Create agent with half the energy of parent and
+						 * pointing to first agent in this cell */
+						PPCAgentOcl new_ag;
+						new_ag.in.sep.action = 0;
+						new_ag.in.sep.type = type;
+						new_ag.in.sep.energy =
+							PPC_AG_ENERGY(agents, ag_ptr) / 2;
 
-							/* One sheep is enough... */
-							break;
+						/* Add new agent to newly born agents list. */
+						new_ag.next = new_ag_ptr_first[type];
+						new_ag_ptr_first[type] = new_ag_idx;
+						if (new_ag_ptr_last[type] == END_OF_AG_LIST) {
+							new_ag_ptr_last[type] = new_ag_idx;
 						}
 
-						/* Not a sheep, next agent please */
-						prev_ag_ptr = local_ag_ptr;
-						local_ag_ptr = next_ag_ptr;
+						/* Save new agent in agent array */
+						PPC_AG_STORE(agents, new_ag_idx, new_ag);
 
-					}
+						/* Parent's energy will be halved also */
+						PPC_AG_ENERGY(agents, ag_ptr) =
+							PPC_AG_ENERGY(agents, ag_ptr)
+							- new_ag.in.sep.energy;
 
-					/* Update wolves stats. */
-					wolves_count++;
-					tot_wolves_en += agents[ag_ptr].in.sep.energy;
+						/* Increment agent count */
+						if (type == SHEEP_ID)
+							st->sheep++;
+						else
+							st->wolves++;
 
+						/* I don't touch the energy stats because
+						 * the total energy will remain the same. */
+					} else {
+
+						st->errors++;
+
+					}
 				}
+			}
+
+		}
+
+		/* Add newly born agents to cell. */
+		for (uint type = 0; type < NUM_AG_TYPES; ++type) {
+			if (new_ag_ptr_last[type] != END_OF_AG_LIST) {
+				PPC_AG_NEXT(agents, new_ag_ptr_last[type]) =
+					cells[cell_idx].agent_pointer[type];
+				cells[cell_idx].agent_pointer[type] =
+					new_ag_ptr_first[type];
+			}
+		}
 
-				/* Try to reproduce agent. */
+#ifndef PP_GRASS_STATS_INC
 
-				uint reproduce_threshold =
-					agents[ag_ptr].in.sep.type == SHEEP_ID
-					? SHEEP_REPRODUCE_THRESHOLD
-					: WOLVES_REPRODUCE_THRESHOLD;
+		/* Update grass stats. */
+		if (PP_GRASS_ALIVE(grass[cell_idx], iter))
+			st->grass++;
+		st->grass_en += PP_GRASS_COUNTDOWN(grass[cell_idx], iter);
 
-				/* Perhaps agent will reproduce if
-				 * energy > reproduce_threshold ? */
-				if (agents[ag_ptr].in.sep.energy > reproduce_threshold) {
+#endif
 
-					uint reproduce_prob =
-						agents[ag_ptr].in.sep.type == SHEEP_ID
-						? SHEEP_REPRODUCE_PROB
-						: WOLVES_REPRODUCE_PROB;
+	}
 
-					/* Throw dice to see if agent reproduces */
-					if (clo_rng_next_int(seeds, 100) < reproduce_prob) {
+	/* Return work performed. */
+	return work;
+}
 
-						/* Agent will reproduce!
-						 * Let's find some space for new agent... */
-						uint new_ag_idx = alloc_ag_idx(agents, seeds);
+/**
+ * Add statistics to the partial statistics of the current work-item. Each
+ * work-item only updates its own partial statistics, so no atomics are
+ * required.
+ *
+ * @param parts Partial statistics of each work-item.
+ * @param st Statistics to add.
+ */
+void stats_part_add(__global PPStatisticsOcl * parts,
+		PPStatisticsOcl * st) {
 
-						if (new_ag_idx != END_OF_AG_LIST) {
+	uint gid = get_global_id(0);
 
-							/* Create agent with half the energy of parent and
-							 * pointing to first agent in this cell */
-							PPCAgentOcl new_ag;
-							new_ag.in.sep.action = 0;
-							new_ag.in.sep.type = agents[ag_ptr].in.sep.type;
-							new_ag.in.sep.energy =
-								agents[ag_ptr].in.sep.energy / 2;
+	parts[gid].sheep += st->sheep;
+	parts[gid].wolves += st->wolves;
+	parts[gid].grass += st->grass;
 
-							/* Add new agent to newly born agents list. */
-							new_ag.next = new_ag_ptr_first;
-							new_ag_ptr_first = new_ag_idx;
-							if (new_ag_ptr_last == END_OF_AG_LIST) {
-								new_ag_ptr_last = new_ag_idx;
-							}
+	parts[gid].sheep_en += st->sheep_en;
+	parts[gid].wolves_en += st->wolves_en;
+	parts[gid].grass_en += st->grass_en;
 
-							/* Save new agent in agent array */
-							agents[new_ag_idx] = new_ag;
+	parts[gid].errors += st->errors;
+}
 
-							/* Parent's energy will be halved also */
-							agents[ag_ptr].in.sep.energy =
-								agents[ag_ptr].in.sep.energy
-								- new_ag.in.sep.energy;
+/**
+ * Reset partial statistics.
+ *
+ * @param st Partial statistics.
+ */
+void stats_reset(PPStatisticsOcl * st) {
+
+	st->sheep = 0;
+	st->wolves = 0;
+	st->grass = 0;
+	st->sheep_en = 0;
+	st->wolves_en = 0;
+	st->grass_en = 0;
+	st->errors = 0;
+}
 
-							/* Increment agent count */
-							if (agents[ag_ptr].in.sep.type == SHEEP_ID)
-								sheep_count++;
-							else
-								wolves_count++;
+/**
+ * Statistics reduction kernel.
+ *
+ * Work-item `k` sums the `num_parts` partial statistics of iteration
+ * `iter + k` into the global statistics of that iteration, and resets the
+ * partial statistics so that they can be used again. This kernel is usually
+ * launched with a single work-item once per iteration, or, when the partial
+ * statistics of all iterations are kept, with one work-item per iteration at
+ * the end of the simulation.
+ *
+ * @param stats Array of simulation statistics.
+ * @param parts Partial statistics of each work-item, `num_parts` for each
+ * iteration.
+ * @param num_parts Number of partial statistics per iteration.
+ * @param iter First iteration to reduce.
+ */
+__kernel void stats_reduce(__global PPStatisticsOcl * stats,
+		__global PPStatisticsOcl * parts,
+		__private uint num_parts,
+		__private uint iter) {
 
-							/* I don't touch the energy stats because
-							 * the total energy will remain the same. */
-						} else {
+	/* Partial statistics of the iteration reduced by this work-item. */
+	__global PPStatisticsOcl * iter_parts =
+		parts + get_global_id(0) * num_parts;
 
-							tot_errors++;
+	/* Reduced statistics, and reset statistics. */
+	PPStatisticsOcl st, zero;
+	stats_reset(&st);
+	stats_reset(&zero);
 
-						}
-					}
-				}
+	/* Sum partial statistics, resetting them. */
+	for (uint i = 0; i < num_parts; ++i) {
 
+		st.sheep += iter_parts[i].sheep;
+		st.wolves += iter_parts[i].wolves;
+		st.grass += iter_parts[i].grass;
 
-				/* Get next agent. */
-				ag_ptr = agents[ag_ptr].next;
+		st.sheep_en += iter_parts[i].sheep_en;
+		st.wolves_en += iter_parts[i].wolves_en;
+		st.grass_en += iter_parts[i].grass_en;
 
-			}
+		st.errors += iter_parts[i].errors;
 
-			/* Add newly born agents to cell. */
-			if (new_ag_ptr_last != END_OF_AG_LIST) {
-				agents[new_ag_ptr_last].next = cells[cell_idx].agent_pointer;
-				cells[cell_idx].agent_pointer = new_ag_ptr_first;
-			}
+		iter_parts[i] = zero;
+	}
 
-			/* Update grass stats. */
-			if (cells[cell_idx].grass == 0)
-				grass_count++;
-			tot_grass_en += cells[cell_idx].grass;
+	/* Save global statistics of iteration. */
+	stats[iter + get_global_id(0)] = st;
+}
 
-		}
+/**
+ * Incremental grass statistics kernel.
+ *
+ * Derives the grass statistics of `num_iters` consecutive iterations,
+ * starting at `iter`, from the number of cells eaten in each of them, which
+ * the statistics reduction kernel leaves in the grass count. Iterations
+ * depend on the previous ones, so this kernel must be launched with a single
+ * work-item, after the statistics of these iterations have been reduced. The
+ * grass statistics of iteration zero are gathered from all cells by the
+ * initialization kernel, and are left untouched.
+ *
+ * @param stats Array of simulation statistics.
+ * @param regrow Regrowth histogram.
+ * @param iter First iteration.
+ * @param num_iters Number of iterations.
+ */
+__kernel void stats_grass(__global PPStatisticsOcl * stats,
+		__global uint * regrow,
+		__private uint iter,
+		__private uint num_iters) {
+
+	for (uint i = max(iter, (uint) 1); i < iter + num_iters; ++i) {
+
+		uint grass_alive = stats[i - 1].grass;
+		uint grass_en = stats[i - 1].grass_en;
+
+		pp_grass_stats_next(&grass_alive, &grass_en, stats[i].grass, regrow,
+			i, GRID_XY, GRASS_RESTART);
+
+		stats[i].grass = grass_alive;
+		stats[i].grass_en = grass_en;
+	}
+}
 
-		/* Update global stats */
-		atomic_add(&stats[iter].sheep, sheep_count);
-		atomic_add(&stats[iter].wolves, wolves_count);
-		atomic_add(&stats[iter].grass, grass_count);
+/**
+ * Grow grass in a span of cells.
+ *
+ * @param grass Grass countdown of each cell.
+ * @param idx_start Index of first cell to process.
+ * @param idx_stop Index after last cell to process.
+ */
+void grass_grow_span(__global uint * grass, uint idx_start, uint idx_stop) {
+
+	for (uint cell_idx = idx_start; cell_idx < idx_stop; cell_idx++)
+		if (grass[cell_idx] > 0)
+			grass[cell_idx]--;
+}
+
+/**
+ * Grass kernel.
+ *
+ * This kernel grows grass in all cells, and must be launched before agents
+ * act in each iteration. Grass is kept apart from the remaining cell state,
+ * so that it can be processed with vectors of `VW_GRASS` uints, each
+ * work-item processing a contiguous chunk of vectors. Padding cells in the
+ * last vector are zero and remain so.
+ *
+ * @param grass Grass countdown of each cell.
+ */
+__kernel void grass(__global grass_uintx * grass) {
 
-		atomic_add(&stats[iter].sheep_en, tot_sheep_en);
-		atomic_add(&stats[iter].wolves_en, tot_wolves_en);
-		atomic_add(&stats[iter].grass_en, tot_grass_en);
+	/* Determine how many vectors will be processed by each work-item. */
+	uint vecs_per_worker = PP_DIV_CEIL(GRASS_VECS, get_global_size(0));
 
-		atomic_add(&stats[iter].errors, tot_errors);
+	/* Get vectors to be processed by this work item. */
+	uint vec_idx_start =
+		min((uint) (get_global_id(0) * vecs_per_worker), (uint) GRASS_VECS);
+	uint vec_idx_end = min((uint) ((get_global_id(0) + 1) * vecs_per_worker),
+		(uint) GRASS_VECS);
 
+	/* Decrement countdown if grass is dead. */
+	for (uint i = vec_idx_start; i < vec_idx_end; ++i) {
+		grass_uintx grass_l = grass[i];
+		grass[i] = select((grass_uintx) 0, grass_l - 1, grass_l > 0);
 	}
 }
 
+/**
+ * The step 1 kernel.
+ *
+ * This kernel performs agent movement in cells.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param seeds Array of PRNG seeds.
+ * @param allocs Agent allocator state of each work-item.
+ * @param busy Work performed by each work-item.
+ * @param turn Number of times the kernel has been invoked in the current
+ * iteration.
+ */
+__kernel void step1(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		__global clo_statetype * seeds,
+		__global PPCAllocOcl * allocs,
+		__global ulong * busy,
+		__private uint turn) {
+
+	/* Determine row to process */
+	uint y = turn + get_global_id(0) * ROWS_PER_WORKITEM;
+
+	/* Check if this work-item has to process anything */
+	if (y < GRID_Y) {
+
+		/* Get allocator state for this work item. */
+		PPCAllocOcl alloc = allocs[get_global_id(0)];
+
+		/* Determine start of row. */
+		uint idx_start = y * GRID_X;
+
+		/* Determine end of row: if this is not the last work-item
+		 * (condition 1) OR if this is not the last row to process
+		 * (condition 2), then process current row until the end.
+		 * Otherwise, process all remaining cells until the end. */
+		uint idx_stop = (get_global_id(0) < get_global_size(0) - 1)
+						|| (turn < ROWS_PER_WORKITEM - 1)
+			? idx_start + GRID_X
+			: GRID_XY;
+
+		/* Move agents in row. */
+		BUSY_ADD(busy, move_agents_span(
+			agents, cells, seeds, &alloc, idx_start, idx_stop));
+
+		/* Save allocator state for this work item. */
+		allocs[get_global_id(0)] = alloc;
+	}
+}
+
+/**
+ * The step 2 kernel.
+ *
+ * This kernel performs agent actions and gathers simulation statistics at the
+ * end of the current iteration.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param grass Grass countdown of each cell.
+ * @param seeds Array of PRNG seeds.
+ * @param parts Partial statistics of each work-item.
+ * @param allocs Agent allocator state of each work-item.
+ * @param slabs Global counter of slabs already handed out, followed by the
+ * number of slabs available.
+ * @param busy Work performed by each work-item.
+ * @param turn Number of times the kernel has been invoked in the current
+ * iteration.
+ * @param iter Current iteration.
+ */
+__kernel void step2(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		__global uint * grass,
+		__global clo_statetype * seeds,
+		__global PPStatisticsOcl * parts,
+		__global PPCAllocOcl * allocs,
+		__global uint * slabs,
+		__global ulong * busy,
+		__private uint turn,
+		__private uint iter) {
+
+	/* Partial statistics. */
+	PPStatisticsOcl st;
+
+	/* Determine row to process. */
+	uint y = turn + get_global_id(0) * ROWS_PER_WORKITEM;
+
+	/* Check if this thread has to process anything */
+	if (y < GRID_Y) {
+
+		/* Get allocator state for this work item. */
+		PPCAllocOcl alloc = allocs[get_global_id(0)];
+
+		/* Determine start of row. */
+		uint idx_start = y * GRID_X;
+
+		/* Determine end of row: if this is not the last work-item
+		 * (condition 1) OR this is not the last row to process
+		 * (condition 2), then process current row until the end.
+		 * Otherwise, process all remaining cells until the end. */
+		uint idx_stop = (get_global_id(0) < get_global_size(0) - 1)
+						|| (turn < ROWS_PER_WORKITEM - 1)
+			? idx_start + GRID_X
+			: GRID_XY;
+
+		/* Perform agent actions in row. */
+		stats_reset(&st);
+		BUSY_ADD(busy, act_agents_span(agents, cells, grass, seeds, &alloc,
+			slabs, &st, idx_start, idx_stop, iter));
+
+		/* Save allocator state for this work item. */
+		allocs[get_global_id(0)] = alloc;
+
+		/* Update partial stats. */
+		stats_part_add(parts, &st);
+
+	}
+}
+
+/**
+ * Get the number of rows processed by a work-item in the wavefront schedule.
+ * Each work-item processes `ROWS_PER_WORKITEM` consecutive rows, except the
+ * last one, which processes the remaining rows.
+ *
+ * @param g Work-item global ID.
+ * @param gws Global work size.
+ * @return Number of rows processed by work-item.
+ */
+uint wavefront_rows(uint g, uint gws) {
+	return g < gws - 1
+		? ROWS_PER_WORKITEM
+		: GRID_Y - (gws - 1) * ROWS_PER_WORKITEM;
+}
+
+/**
+ * Wait until the progress of a work-item in the wavefront schedule reaches
+ * the given value.
+ *
+ * @param progress Progress of each work-item.
+ * @param g Global ID of work-item to wait for.
+ * @param value Progress value to wait for.
+ */
+void wavefront_wait(__global uint * progress, uint g, uint value) {
+
+	/* Spin until work-item g gets there. */
+	while (atomic_add(&progress[g], 0) < value);
+
+	/* Make sure the cells updated by work-item g are seen. */
+	mem_fence(CLK_GLOBAL_MEM_FENCE);
+}
+
+/**
+ * Publish the progress of the current work-item in the wavefront schedule.
+ *
+ * @param progress Progress of each work-item.
+ * @param value New progress value.
+ */
+void wavefront_post(__global uint * progress, uint value) {
+
+	/* Make sure the cells updated by this work-item are seen first. */
+	mem_fence(CLK_GLOBAL_MEM_FENCE);
+
+	atomic_xchg(&progress[get_global_id(0)], value);
+}
+
+/**
+ * The fused step kernel, which performs the complete simulation in a single
+ * launch, scheduling rows as a wavefront.
+ *
+ * Each work-item processes a band of consecutive rows, moving agents row
+ * by row, and publishes its progress in the `progress` array after each
+ * row. Progress values grow monotonically: during iteration `i`, a
+ * work-item which moved agents in `r` of its rows has progress
+ * `(i - 1) * PROGRESS_STRIDE + r`, and after performing agent actions it
+ * has progress `i * PROGRESS_STRIDE`. A work-item only waits for its two
+ * neighbours, and only when their rows could be less than `D_MIN` rows from
+ * its own:
+ *
+ * * Before moving agents in its first row, it waits for the left neighbour
+ *   to finish the agent actions of the previous iteration.
+ * * Before moving agents in row `r` of its `n` rows, with `r + D_MIN > n`,
+ *   it waits for the right neighbour to move agents in `r + D_MIN - n`
+ *   rows.
+ * * Before performing agent actions, it waits for both neighbours to move
+ *   agents in all their rows.
+ *
+ * All work-items must run concurrently, so this kernel must be launched with
+ * one work-item per work-group, and no more work-groups than device compute
+ * units.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param grass Grass countdown of each cell.
+ * @param seeds Array of PRNG seeds.
+ * @param parts Partial statistics of each work-item, one set of
+ * `get_global_size(0)` for each iteration, including iteration zero.
+ * @param allocs Agent allocator state of each work-item.
+ * @param slabs Global counter of slabs already handed out, followed by the
+ * number of slabs available.
+ * @param busy Work performed by each work-item.
+ * @param progress Progress of each work-item, initially zero.
+ */
+__kernel void step(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		__global uint * grass,
+		__global clo_statetype * seeds,
+		__global PPStatisticsOcl * parts,
+		__global PPCAllocOcl * allocs,
+		__global uint * slabs,
+		__global ulong * busy,
+		__global uint * progress) {
+
+	/* Partial statistics. */
+	PPStatisticsOcl st;
+
+	/* Get global ID and global work size. */
+	uint gid = get_global_id(0);
+	uint gws = get_global_size(0);
+
+	/* Get neighbour work-items, which process the rows above and below,
+	 * wrapping around the torus. */
+	uint left = (gid + gws - 1) % gws;
+	uint right = (gid + 1) % gws;
+
+	/* Get rows to process by this work-item and its neighbours. */
+	uint row_start = gid * ROWS_PER_WORKITEM;
+	uint num_rows = wavefront_rows(gid, gws);
+	uint num_rows_left = wavefront_rows(left, gws);
+	uint num_rows_right = wavefront_rows(right, gws);
+
+	/* Get allocator state for this work item. */
+	PPCAllocOcl alloc = allocs[gid];
+
+	/* Simulation loop. */
+	for (uint iter = 1; iter <= ITERS; ++iter) {
+
+		/* Progress at the start of this iteration. */
+		uint base = (iter - 1) * PROGRESS_STRIDE;
+
+#ifndef PP_GRASS_LAZY
+
+		/* Step 1:  Grow grass in all rows. Only this work-item touches the
+		 * grass of its rows. */
+		grass_grow_span(grass, row_start * GRID_X,
+			(row_start + num_rows) * GRID_X);
+
+#endif
+
+		/* Move agents, one row at a time. */
+		for (uint r = 0; r < num_rows; ++r) {
+
+			/* Agents in first row may move into the last row of the left
+			 * neighbour. */
+			if (r == 0)
+				wavefront_wait(progress, left, base);
+
+			/* Agents in last rows may move close to the first rows of the
+			 * right neighbour. */
+			if (r + D_MIN > num_rows)
+				wavefront_wait(
+					progress, right, base + r + D_MIN - num_rows);
+
+			/* Move agents in row. */
+			BUSY_ADD(busy, move_agents_span(agents, cells, seeds, &alloc,
+				(row_start + r) * GRID_X, (row_start + r + 1) * GRID_X));
+
+			/* Let neighbours know. */
+			wavefront_post(progress, base + r + 1);
+		}
+
+		/* Step 2:  Agent actions, get stats. Neighbours may have moved
+		 * agents into our rows. */
+		wavefront_wait(progress, left, base + num_rows_left);
+		wavefront_wait(progress, right, base + num_rows_right);
+
+		/* Perform agent actions in all rows. */
+		stats_reset(&st);
+		BUSY_ADD(busy, act_agents_span(agents, cells, grass, seeds, &alloc,
+			slabs, &st, row_start * GRID_X, (row_start + num_rows) * GRID_X,
+			iter));
+
+		/* Update partial stats of this iteration. */
+		stats_part_add(parts + iter * gws, &st);
+
+		/* Let neighbours know. */
+		wavefront_post(progress, base + PROGRESS_STRIDE);
+	}
+
+	/* Save allocator state for this work item. */
+	allocs[gid] = alloc;
+}
+
+/**
+ * Get the block dispensed with the given ticket in the on-demand schedule.
+ * Even blocks are dispensed before odd blocks, so that blocks dispensed
+ * close in time are usually not neighbours.
+ *
+ * @param ticket Ticket taken from the dispenser.
+ * @return Block index.
+ */
+uint ondemand_block(uint ticket) {
+	uint num_even = (NUM_BLOCKS + 1) / 2;
+	return ticket < num_even ? 2 * ticket : 2 * (ticket - num_even) + 1;
+}
+
+/**
+ * Get the span of cells in the given block of the on-demand schedule.
+ *
+ * @param block Block index.
+ * @param idx_start Index of first cell in block.
+ * @param idx_stop Index after last cell in block.
+ */
+void ondemand_block_cells(uint block, uint * idx_start, uint * idx_stop) {
+	*idx_start = block * BLOCK_ROWS * GRID_X;
+	*idx_stop = block < NUM_BLOCKS - 1
+		? *idx_start + BLOCK_ROWS * GRID_X
+		: GRID_XY;
+}
+
+/**
+ * Get the blocks to lock before moving agents in the given block of the
+ * on-demand schedule, namely the block itself and its two neighbours, in
+ * ascending order (so that lock acquisition never deadlocks) and without
+ * repetitions.
+ *
+ * @param block Block index.
+ * @param blocks Blocks to lock.
+ * @return Number of blocks to lock.
+ */
+uint ondemand_lock_set(uint block, uint * blocks) {
+
+	/* Block and its neighbours, wrapping around the torus. */
+	uint b0 = (block + NUM_BLOCKS - 1) % NUM_BLOCKS;
+	uint b1 = block;
+	uint b2 = (block + 1) % NUM_BLOCKS;
+	uint tmp;
+
+	/* Number of blocks to lock. */
+	uint n = 0;
+
+	/* Sort blocks. */
+	if (b0 > b1) { tmp = b0; b0 = b1; b1 = tmp; }
+	if (b1 > b2) { tmp = b1; b1 = b2; b2 = tmp; }
+	if (b0 > b1) { tmp = b0; b0 = b1; b1 = tmp; }
+
+	/* Keep blocks, skipping repetitions (with less than three blocks). */
+	blocks[n++] = b0;
+	if (b1 != b0) blocks[n++] = b1;
+	if (b2 != b1) blocks[n++] = b2;
+
+	return n;
+}
+
+/**
+ * Lock a block of the on-demand schedule for moving its agents. The block
+ * is locked exclusively, while its neighbours are locked in shared mode, so
+ * that no two neighbour blocks move agents at the same time, but blocks two
+ * blocks apart (at least `D_MIN` rows apart, since blocks have at least two
+ * rows) can.
+ *
+ * @param locks Block locks.
+ * @param block Block index.
+ */
+void ondemand_lock(__global uint * locks, uint block) {
+
+	/* Blocks to lock. */
+	uint blocks[3];
+	uint n = ondemand_lock_set(block, blocks);
+
+	/* Acquire locks in ascending order. */
+	for (uint i = 0; i < n; ++i) {
+
+		if (blocks[i] == block) {
+
+			/* Lock own block exclusively. */
+			while (atomic_cmpxchg(&locks[block], 0, BLOCK_LOCK_EXCL) != 0);
+
+		} else {
+
+			/* Lock neighbour block in shared mode. */
+			while (1) {
+				uint lock = atomic_or(&locks[blocks[i]], 0);
+				if (!(lock & BLOCK_LOCK_EXCL) && (atomic_cmpxchg(
+						&locks[blocks[i]], lock, lock + 1) == lock))
+					break;
+			}
+		}
+	}
+
+	/* Make sure the cells updated by the previous holders are seen. */
+	mem_fence(CLK_GLOBAL_MEM_FENCE);
+}
+
+/**
+ * Unlock a block of the on-demand schedule locked with ondemand_lock().
+ *
+ * @param locks Block locks.
+ * @param block Block index.
+ */
+void ondemand_unlock(__global uint * locks, uint block) {
+
+	/* Blocks to unlock. */
+	uint blocks[3];
+	uint n = ondemand_lock_set(block, blocks);
+
+	/* Make sure the cells updated by this work-item are seen first. */
+	mem_fence(CLK_GLOBAL_MEM_FENCE);
+
+	/* Release locks. */
+	for (uint i = 0; i < n; ++i) {
+		if (blocks[i] == block)
+			atomic_xchg(&locks[block], 0);
+		else
+			atomic_dec(&locks[blocks[i]]);
+	}
+}
+
+/**
+ * The step 1 kernel for the on-demand schedule.
+ *
+ * This kernel performs agent movement in cells. Instead of
+ * processing a fixed set of rows, work-items take blocks of `BLOCK_ROWS` rows
+ * from a dispenser until all blocks are processed, so that work-items which
+ * get sparse blocks process more of them. Each block is locked together with
+ * its neighbours while its agents move.
+ *
+ * Work-items may wait for locks held by other work-items, so all of them
+ * must run concurrently, i.e. this kernel must be launched with one work-item
+ * per work-group, and no more work-groups than device compute units.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param seeds Array of PRNG seeds.
+ * @param allocs Agent allocator state of each work-item.
+ * @param busy Work performed by each work-item.
+ * @param dispensers Block dispensers of step 1 (first) and step 2 (second).
+ * The step 1 dispenser must be zero, and the step 2 dispenser is reset.
+ * @param locks Block locks, initially zero.
+ */
+__kernel void ondemand_step1(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		__global clo_statetype * seeds,
+		__global PPCAllocOcl * allocs,
+		__global ulong * busy,
+		__global uint * dispensers,
+		__global uint * locks) {
+
+	/* Ticket taken from the dispenser. */
+	uint ticket;
+
+	/* Get allocator state for this work item. */
+	PPCAllocOcl alloc = allocs[get_global_id(0)];
+
+	/* The step 2 dispenser is not used here, reset it for step 2. */
+	if (get_global_id(0) == 0) dispensers[1] = 0;
+
+	/* Process blocks while there are blocks left. */
+	while ((ticket = atomic_inc(&dispensers[0])) < NUM_BLOCKS) {
+
+		/* Get block and its cells. */
+		uint block = ondemand_block(ticket);
+		uint idx_start, idx_stop;
+		ondemand_block_cells(block, &idx_start, &idx_stop);
+
+		/* Move agents in block. */
+		ondemand_lock(locks, block);
+		BUSY_ADD(busy, move_agents_span(
+			agents, cells, seeds, &alloc, idx_start, idx_stop));
+		ondemand_unlock(locks, block);
+	}
+
+	/* Save allocator state for this work item. */
+	allocs[get_global_id(0)] = alloc;
+}
+
+/**
+ * The step 2 kernel for the on-demand schedule.
+ *
+ * This kernel performs agent actions and gathers simulation statistics at the
+ * end of the current iteration. Work-items take blocks of `BLOCK_ROWS` rows
+ * from a dispenser until all blocks are processed. Agent actions only touch
+ * the agents' own cell, so no locking is required.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param grass Grass countdown of each cell.
+ * @param seeds Array of PRNG seeds.
+ * @param parts Partial statistics of each work-item.
+ * @param allocs Agent allocator state of each work-item.
+ * @param slabs Global counter of slabs already handed out, followed by the
+ * number of slabs available.
+ * @param busy Work performed by each work-item.
+ * @param dispensers Block dispensers of step 1 (first) and step 2 (second).
+ * The step 2 dispenser must be zero, and the step 1 dispenser is reset.
+ * @param iter Current iteration.
+ */
+__kernel void ondemand_step2(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		__global uint * grass,
+		__global clo_statetype * seeds,
+		__global PPStatisticsOcl * parts,
+		__global PPCAllocOcl * allocs,
+		__global uint * slabs,
+		__global ulong * busy,
+		__global uint * dispensers,
+		__private uint iter) {
+
+	/* Ticket taken from the dispenser. */
+	uint ticket;
+
+	/* Partial statistics. */
+	PPStatisticsOcl st;
+	stats_reset(&st);
+
+	/* Get allocator state for this work item. */
+	PPCAllocOcl alloc = allocs[get_global_id(0)];
+
+	/* The step 1 dispenser is not used here, reset it for the next
+	 * iteration. */
+	if (get_global_id(0) == 0) dispensers[0] = 0;
+
+	/* Process blocks while there are blocks left. */
+	while ((ticket = atomic_inc(&dispensers[1])) < NUM_BLOCKS) {
+
+		/* Get block and its cells. */
+		uint idx_start, idx_stop;
+		ondemand_block_cells(ondemand_block(ticket), &idx_start, &idx_stop);
+
+		/* Perform agent actions in block. */
+		BUSY_ADD(busy, act_agents_span(agents, cells, grass, seeds, &alloc,
+			slabs, &st, idx_start, idx_stop, iter));
+	}
+
+	/* Save allocator state for this work item. */
+	allocs[get_global_id(0)] = alloc;
+
+	/* Update partial stats. */
+	stats_part_add(parts, &st);
+}
+
+/**
+ * Get the cells of a tile of the tiled schedule.
+ *
+ * @param tile_x Horizontal tile index.
+ * @param tile_y Vertical tile index.
+ * @param x_start First column of tile.
+ * @param x_stop Column after the last column of tile.
+ * @param y_start First row of tile.
+ * @param y_stop Row after the last row of tile.
+ */
+void tile_cells(uint tile_x, uint tile_y, uint * x_start, uint * x_stop,
+		uint * y_start, uint * y_stop) {
+
+	*x_start = tile_x * TILE_X;
+	*x_stop = tile_x < NUM_TILES_X - 1 ? *x_start + TILE_X : GRID_X;
+	*y_start = tile_y * TILE_Y;
+	*y_stop = tile_y < NUM_TILES_Y - 1 ? *y_start + TILE_Y : GRID_Y;
+}
+
+/**
+ * The step 1 kernel for the tiled schedule.
+ *
+ * This kernel performs agent movement in the tiles of one
+ * colour. Tiles are coloured as a checkerboard with four colours, given by
+ * the parity of the horizontal and vertical tile indexes, such that tiles
+ * of the same colour are separated by at least one tile, i.e. by at least
+ * two cells. Since agents only move to neighbouring cells, tiles of the same
+ * colour can be processed at the same time. Each work-item processes
+ * every `get_global_size(0)`-th tile of the given colour.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param seeds Array of PRNG seeds.
+ * @param allocs Agent allocator state of each work-item.
+ * @param busy Work performed by each work-item.
+ * @param colour Colour of tiles to process, between 0 and 3.
+ */
+__kernel void tile_step1(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		__global clo_statetype * seeds,
+		__global PPCAllocOcl * allocs,
+		__global ulong * busy,
+		__private uint colour) {
+
+	/* Get allocator state for this work item. */
+	PPCAllocOcl alloc = allocs[get_global_id(0)];
+
+	/* Cycle through tiles of the given colour. */
+	for (uint t = get_global_id(0); t < NUM_TILES_COLOUR;
+			t += get_global_size(0)) {
+
+		/* Get tile cells. */
+		uint x_start, x_stop, y_start, y_stop;
+		tile_cells((t % (NUM_TILES_X / 2)) * 2 + colour % 2,
+			(t / (NUM_TILES_X / 2)) * 2 + colour / 2,
+			&x_start, &x_stop, &y_start, &y_stop);
+
+		/* Move agents in each row of tile. */
+		for (uint y = y_start; y < y_stop; ++y) {
+			BUSY_ADD(busy, move_agents_span(agents, cells, seeds, &alloc,
+				y * GRID_X + x_start, y * GRID_X + x_stop));
+		}
+	}
+
+	/* Save allocator state for this work item. */
+	allocs[get_global_id(0)] = alloc;
+}
+
+/**
+ * The step 2 kernel for the tiled schedule.
+ *
+ * This kernel performs agent actions and gathers simulation statistics at the
+ * end of the current iteration. Agent actions only touch the agents' own cell,
+ * so tiles of all colours are processed at the same time.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param grass Grass countdown of each cell.
+ * @param seeds Array of PRNG seeds.
+ * @param parts Partial statistics of each work-item.
+ * @param allocs Agent allocator state of each work-item.
+ * @param slabs Global counter of slabs already handed out, followed by the
+ * number of slabs available.
+ * @param busy Work performed by each work-item.
+ * @param iter Current iteration.
+ */
+__kernel void tile_step2(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		__global uint * grass,
+		__global clo_statetype * seeds,
+		__global PPStatisticsOcl * parts,
+		__global PPCAllocOcl * allocs,
+		__global uint * slabs,
+		__global ulong * busy,
+		__private uint iter) {
+
+	/* Partial statistics. */
+	PPStatisticsOcl st;
+	stats_reset(&st);
+
+	/* Get allocator state for this work item. */
+	PPCAllocOcl alloc = allocs[get_global_id(0)];
+
+	/* Cycle through tiles. */
+	for (uint t = get_global_id(0); t < NUM_TILES_X * NUM_TILES_Y;
+			t += get_global_size(0)) {
+
+		/* Get tile cells. */
+		uint x_start, x_stop, y_start, y_stop;
+		tile_cells(t % NUM_TILES_X, t / NUM_TILES_X,
+			&x_start, &x_stop, &y_start, &y_stop);
+
+		/* Perform agent actions in each row of tile. */
+		for (uint y = y_start; y < y_stop; ++y) {
+			BUSY_ADD(busy, act_agents_span(agents, cells, grass, seeds, &alloc,
+				slabs, &st, y * GRID_X + x_start, y * GRID_X + x_stop, iter));
+		}
+	}
+
+	/* Save allocator state for this work item. */
+	allocs[get_global_id(0)] = alloc;
+
+	/* Update partial stats. */
+	stats_part_add(parts, &st);
+}
+
+/**
+ * Get the range of cells processed by the current work-item when each
+ * work-item processes a contiguous chunk of cells, as in the cell-ordered
+ * (CSR) engine and in the atomic schedule.
+ *
+ * @param cell_idx_start Index of first cell to process.
+ * @param cell_idx_end Index after last cell to process.
+ */
+void cells_span_get(uint * cell_idx_start, uint * cell_idx_end) {
+
+	/* Determine how many cells will be processed by each work-item. */
+	uint cells_per_worker = PP_DIV_CEIL(GRID_XY, get_global_size(0));
+
+	/* Get cells to be processed by this work item. */
+	*cell_idx_start =
+		min((uint) (get_global_id(0) * cells_per_worker), (uint) GRID_XY);
+	*cell_idx_end = min((uint) ((get_global_id(0) + 1) * cells_per_worker),
+		(uint) GRID_XY);
+}
+
+/**
+ * Atomically push an agent into the agent list of the given type in a
+ * cell, in the atomic schedule.
+ *
+ * The agent is swapped in as the new head of the list, and only then linked
+ * to the previous head. In between, its `next` field holds
+ * `AG_LIST_PENDING`, so that a work-item which detaches the list in the
+ * meantime waits for the link instead of following a stale one.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param type Type of agent to add to cell.
+ * @param ag_idx Index of agent (with respect to the global agents array) to
+ * add to cell.
+ * @param cell_idx Index of cell to which the agent will be added.
+ */
+void atomic_add_ag_to_cell(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		uint type,
+		uint ag_idx,
+		uint cell_idx) {
+
+	/* Mark link as pending and make agent state visible before publishing
+	 * the agent. */
+	PPC_AG_NEXT(agents, ag_idx) = AG_LIST_PENDING;
+	mem_fence(CLK_GLOBAL_MEM_FENCE);
+
+	/* Swap agent in as list head and link it to the previous head. */
+	uint head = atomic_xchg(&cells[cell_idx].agent_pointer[type], ag_idx);
+	atomic_xchg(&PPC_AG_NEXT(agents, ag_idx), head);
+}
+
+/**
+ * Get the agent after the given one in a list detached by
+ * atomic_move_agents_span(), waiting for the link if it is still being set
+ * by atomic_add_ag_to_cell().
+ *
+ * @param agents Global agent array.
+ * @param ag_idx Index of agent (with respect to the global agents array).
+ * @return Index of next agent in list.
+ */
+uint atomic_ag_next(__global PPCAgentStoreOcl * agents, uint ag_idx) {
+
+	uint next_ag_idx;
+	while ((next_ag_idx = atomic_or(&PPC_AG_NEXT(agents, ag_idx), 0))
+		== AG_LIST_PENDING);
+	mem_fence(CLK_GLOBAL_MEM_FENCE);
+	return next_ag_idx;
+}
+
+/**
+ * Move agents in a span of cells, in the atomic schedule.
+ *
+ * Unlike move_agents_span(), this function does not require neighbouring
+ * cells to be left alone by other work-items. The agent list of each type
+ * is detached from the cell with a single atomic swap, and each agent is
+ * then pushed, with atomic_add_ag_to_cell(), either into its destination
+ * cell or back into the current cell. Agents pushed into the cell by other
+ * work-items before the list is detached have already moved, and are simply
+ * pushed back. List order is not preserved, which is fine since agent lists
+ * are shuffled before agents act.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param seeds Array of PRNG seeds.
+ * @param alloc Allocator state of the current work-item.
+ * @param idx_start Index of first cell to process.
+ * @param idx_stop Index after last cell to process.
+ * @return Work performed, i.e. number of cells plus number of agents
+ * visited.
+ */
+uint atomic_move_agents_span(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		__global clo_statetype * seeds,
+		PPCAllocOcl * alloc,
+		uint idx_start,
+		uint idx_stop) {
+
+	/* Work performed, starting with the cells. */
+	uint work = idx_stop - idx_start;
+
+	/* Cycle through cells in span. */
+	for (uint cell_idx = idx_start; cell_idx < idx_stop; cell_idx++) {
+
+		/* *** Move agents, one agent list at a time. *** */
+		for (uint type = 0; type < NUM_AG_TYPES; ++type) {
+
+			/* Detach agent list of this type from cell. */
+			uint ag_idx = atomic_xchg(
+				&cells[cell_idx].agent_pointer[type], END_OF_AG_LIST);
+
+			/* Cycle through agents in detached list. */
+			while (ag_idx != END_OF_AG_LIST) {
+
+				/* Get index of next agent. */
+				uint next_ag_idx = atomic_ag_next(agents, ag_idx);
+				work++;
+
+				/* Agent already moved, put it back in cell. */
+				if (PPC_AG_ACTION(agents, ag_idx)) {
+
+					atomic_add_ag_to_cell(
+						agents, cells, type, ag_idx, cell_idx);
+
+				/* Agent doesn't have enough energy to stay alive, so
+				 * kill him, releasing his place. */
+				} else if (PPC_AG_ENERGY(agents, ag_idx) <= 1) {
+
+					free_ag_idx(agents, alloc, ag_idx);
+
+				/* Otherwise move agent, possibly to the same cell. */
+				} else {
+
+					PPC_AG_ACTION(agents, ag_idx) = 1;
+					PPC_AG_ENERGY(agents, ag_idx)--;
+					atomic_add_ag_to_cell(agents, cells, type, ag_idx,
+						random_walk(seeds, cell_idx));
+
+				}
+
+				/* Get next agent, if any */
+				ag_idx = next_ag_idx;
+			}
+		}
+	}
+
+	/* Return work performed. */
+	return work;
+}
+
+/**
+ * The step 1 kernel for the atomic schedule.
+ *
+ * This kernel performs agent movement in cells. Since agents
+ * are added to their destination cells with atomic operations, there is no
+ * need to keep work-items processing neighbouring cells apart, and the whole
+ * environment is processed in a single launch, each work-item processing a
+ * contiguous chunk of cells.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param seeds Array of PRNG seeds.
+ * @param allocs Agent allocator state of each work-item.
+ * @param busy Work performed by each work-item.
+ */
+__kernel void atomic_step1(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		__global clo_statetype * seeds,
+		__global PPCAllocOcl * allocs,
+		__global ulong * busy) {
+
+	/* Cells processed by this work-item. */
+	uint cell_idx_start, cell_idx_end;
+	cells_span_get(&cell_idx_start, &cell_idx_end);
+
+	/* Get allocator state for this work item. */
+	PPCAllocOcl alloc = allocs[get_global_id(0)];
+
+	/* Move agents in cells. */
+	BUSY_ADD(busy, atomic_move_agents_span(
+		agents, cells, seeds, &alloc, cell_idx_start, cell_idx_end));
+
+	/* Save allocator state for this work item. */
+	allocs[get_global_id(0)] = alloc;
+}
+
+/**
+ * The step 2 kernel for the atomic schedule.
+ *
+ * This kernel performs agent actions and gathers simulation statistics at the
+ * end of the current iteration. Agent actions only touch the agents' own cell,
+ * so the whole environment is processed in a single launch, each work-item
+ * processing a contiguous chunk of cells.
+ *
+ * @param agents Global agent array.
+ * @param cells Array of cells.
+ * @param grass Grass countdown of each cell.
+ * @param seeds Array of PRNG seeds.
+ * @param parts Partial statistics of each work-item.
+ * @param allocs Agent allocator state of each work-item.
+ * @param slabs Global counter of slabs already handed out, followed by the
+ * number of slabs available.
+ * @param busy Work performed by each work-item.
+ * @param iter Current iteration.
+ */
+__kernel void atomic_step2(__global PPCAgentStoreOcl * agents,
+		__global PPCCellOcl * cells,
+		__global uint * grass,
+		__global clo_statetype * seeds,
+		__global PPStatisticsOcl * parts,
+		__global PPCAllocOcl * allocs,
+		__global uint * slabs,
+		__global ulong * busy,
+		__private uint iter) {
+
+	/* Partial statistics. */
+	PPStatisticsOcl st;
+	stats_reset(&st);
+
+	/* Cells processed by this work-item. */
+	uint cell_idx_start, cell_idx_end;
+	cells_span_get(&cell_idx_start, &cell_idx_end);
+
+	/* Get allocator state for this work item. */
+	PPCAllocOcl alloc = allocs[get_global_id(0)];
+
+	/* Perform agent actions in cells. */
+	BUSY_ADD(busy, act_agents_span(agents, cells, grass, seeds, &alloc, slabs,
+		&st, cell_idx_start, cell_idx_end, iter));
+
+	/* Save allocator state for this work item. */
+	allocs[get_global_id(0)] = alloc;
+
+	/* Update partial stats. */
+	stats_part_add(parts, &st);
+}
+
+/**
+ * Initialization kernel for the cell-ordered (CSR) engine.
+ *
+ * In this engine the agents of each cell are stored contiguously in the
+ * agents array, and the `next` field of each agent holds the index of the
+ * cell where the agent is. Initial agents are placed in one block per
+ * work-item, which is recorded as the range of the first cell processed by
+ * that work-item. Since agents are redistributed to their cells when the
+ * agents array is rebuilt, this is enough for the first iteration.
+ *
+ * @param agents Agents array.
+ * @param grass Grass countdown of each cell.
+ * @param ranges Agent ranges of each cell.
+ * @param parts Partial statistics of each work-item.
+ * @param seeds Array of PRNG seeds.
+ * @param regrow Regrowth histogram, initially zero.
+ * */
+__kernel void csr_init(__global PPCAgentStoreOcl * agents,
+		__global uint * grass,
+		__global PPCRangeOcl * ranges,
+		__global PPStatisticsOcl * parts,
+		__global clo_statetype * seeds,
+		__global uint * regrow) {
+
+	/* Get global ID. */
+	uint gid = get_global_id(0);
+
+	/* Get global work size. */
+	uint gws = get_global_size(0);
+
+	/* Cells to be initialized by this work item. */
+	uint cell_idx_start, cell_idx_end;
+	cells_span_get(&cell_idx_start, &cell_idx_end);
+
+	/* Number of cells to be initialized by this work item. */
+	uint num_cells = cell_idx_end - cell_idx_start;
+
+	/* Determine number of agents to be initialized by this work item. */
+	uint num_sheep = INIT_SHEEP / gws;
+	uint num_wolves = INIT_WOLVES / gws;
+
+	/* Determine base index for placing new agents in the agents array. */
+	uint new_ag_idx_base = (num_sheep + num_wolves) * gid;
+
+	/* If this is the last work item, adjust the number of agents to be
+	 * initialized accordingly. */
+	if (gid == gws - 1) {
+		num_sheep = INIT_SHEEP - num_sheep * (gws - 1);
+		num_wolves = INIT_WOLVES - num_wolves * (gws - 1);
+	}
+
+	/* Total number of agents. */
+	uint num_agents = num_sheep + num_wolves;
+
+	/* Initialize stats. */
+	uint tot_sheep_en = 0;
+	uint tot_wolves_en = 0;
+	uint tot_grass_en = 0;
+	uint grass_alive = 0;
+
+	/* Initialize cells. */
+	for (uint i = cell_idx_start; i < cell_idx_end; ++i) {
+
+		/* Is grass alive? */
+		uint alive = clo_rng_next_int(seeds, 2);
+
+		/* If grass is alive, countdown will be zero. Otherwise,
+		 * randomly determine a countdown value. */
+		if (alive) {
+
+			/* Alive. */
+			grass[i] = 0;
+			grass_alive++;
+
+		} else {
+
+			/* Dead. Set coundown. */
+			uint countdown = clo_rng_next_int(seeds, GRASS_RESTART) + 1;
+			grass[i] = countdown;
+			tot_grass_en += countdown;
+
+#ifdef PP_GRASS_STATS_INC
+			/* Grass regrows when the countdown reaches zero. */
+			atomic_inc(&regrow[PP_GRASS_REGROW_IDX(countdown, GRASS_RESTART)]);
+#endif
+
+		}
+
+		/* Initialize agent range. */
+		ranges[i].start = new_ag_idx_base;
+		ranges[i].end = new_ag_idx_base;
+	}
+
+	/* All agents initialized by this work item belong to the range of the
+	 * first cell. */
+	if (num_cells > 0)
+		ranges[cell_idx_start].end = new_ag_idx_base + num_agents;
+
+	/* Initialize agents. */
+	for (uint i = 0; i < num_agents; ++i) {
+
+		/* Create agent. */
+		PPCAgentOcl agent;
+		agent.in.sep.action = 0;
+
+		/* Should I initialize a sheep or a wolf? */
+		if (i < num_sheep) {
+
+			/* Initialize a sheep. */
+			agent.in.sep.energy =
+				clo_rng_next_int(seeds, SHEEP_GAIN_FROM_FOOD * 2) + 1;
+			agent.in.sep.type = SHEEP_ID;
+			tot_sheep_en += agent.in.sep.energy;
+
+		} else {
+
+			/* Initialize a wolf. */
+			agent.in.sep.energy =
+				clo_rng_next_int(seeds, WOLVES_GAIN_FROM_FOOD * 2) + 1;
+			agent.in.sep.type = WOLF_ID;
+			tot_wolves_en += agent.in.sep.energy;
+
+		}
+
+		/* Get a cell where to put agent. */
+		agent.next = cell_idx_start + clo_rng_next_int(seeds, num_cells);
+
+		/* Save new agent in agent array */
+		PPC_AG_STORE(agents, new_ag_idx_base + i, agent);
+
+	}
+
+	/* Save partial stats for this work item. */
+	parts[gid].sheep = num_sheep;
+	parts[gid].wolves = num_wolves;
+	parts[gid].grass = grass_alive;
+
+	parts[gid].sheep_en = tot_sheep_en;
+	parts[gid].wolves_en = tot_wolves_en;
+	parts[gid].grass_en = tot_grass_en;
+
+	parts[gid].errors = 0;
+}
+
+/**
+ * Movement kernel for the cell-ordered (CSR) engine.
+ *
+ * This kernel kills agents without energy and determines the destination
+ * cell of the remaining agents, counting how many agents will be in each
+ * cell. Since agents are not actually moved, cells can be processed in any
+ * order, and there is no need for turns.
+ *
+ * @param agents Agents array.
+ * @param ranges Agent ranges of each cell.
+ * @param ranges_next Agent ranges of each cell in the rebuilt agents array.
+ * The `end` field must be zero, and is used to count agents per cell.
+ * @param seeds Array of PRNG seeds.
+ * */
+__kernel void csr_move(__global PPCAgentStoreOcl * agents,
+		__global PPCRangeOcl * ranges,
+		__global PPCRangeOcl * ranges_next,
+		__global clo_statetype * seeds) {
+
+	/* Cells to be processed by this work item. */
+	uint cell_idx_start, cell_idx_end;
+	cells_span_get(&cell_idx_start, &cell_idx_end);
+
+	/* Cycle through cells. */
+	for (uint cell_idx = cell_idx_start; cell_idx < cell_idx_end;
+			++cell_idx) {
+
+		/* *** Move agents. *** */
+		for (uint ag_idx = ranges[cell_idx].start;
+				ag_idx < ranges[cell_idx].end; ++ag_idx) {
+
+			/* Skip agents eaten in the previous iteration. */
+			if (PPC_AG_ENERGY(agents, ag_idx) == 0) continue;
+
+			/* Does agent have enough energy to stay alive? */
+			if (PPC_AG_ENERGY(agents, ag_idx) <= 1) {
+
+				/* No, kill him. */
+				PPC_AG_ENERGY(agents, ag_idx) = 0;
+
+			} else {
+
+				/* Yes, decrement energy... */
+				PPC_AG_ENERGY(agents, ag_idx)--;
+
+				/* ...get a destination... */
+				uint neigh_idx =
+					random_walk(seeds, PPC_AG_NEXT(agents, ag_idx));
+				PPC_AG_NEXT(agents, ag_idx) = neigh_idx;
+
+				/* ...and count agent in destination. */
+				atomic_inc(&ranges_next[neigh_idx].end);
+			}
+		}
+	}
+}
+
+/**
+ * First prefix sum kernel for the cell-ordered (CSR) engine.
+ *
+ * This kernel sums the space required by the cells processed by each
+ * work-item. Each cell requires space for twice the number of agents moving
+ * into it, since each of these agents can have a newborn.
+ *
+ * @param ranges_next Agent ranges of each cell in the rebuilt agents array,
+ * with the `end` field holding the number of agents in each cell.
+ * @param sums Space required by the cells of each work-item.
+ * */
+__kernel void csr_scan1(__global PPCRangeOcl * ranges_next,
+		__global uint * sums) {
+
+	/* Cells to be processed by this work item. */
+	uint cell_idx_start, cell_idx_end;
+	cells_span_get(&cell_idx_start, &cell_idx_end);
+
+	/* Space required by cells. */
+	uint sum = 0;
+
+	/* Cycle through cells. */
+	for (uint cell_idx = cell_idx_start; cell_idx < cell_idx_end;
+			++cell_idx) {
+		sum += 2 * ranges_next[cell_idx].end;
+	}
+
+	/* Keep space required by this work-item. */
+	sums[get_global_id(0)] = sum;
+}
+
+/**
+ * Second prefix sum kernel for the cell-ordered (CSR) engine.
+ *
+ * This kernel determines where the agents of each cell will be placed in the
+ * rebuilt agents array.
+ *
+ * @param ranges_next Agent ranges of each cell in the rebuilt agents array,
+ * with the `end` field holding the number of agents in each cell. On exit,
+ * both the `start` and `end` fields hold the start of the cell's range.
+ * @param sums Space required by the cells of each work-item.
+ * */
+__kernel void csr_scan2(__global PPCRangeOcl * ranges_next,
+		__global uint * sums) {
+
+	/* Cells to be processed by this work item. */
+	uint cell_idx_start, cell_idx_end;
+	cells_span_get(&cell_idx_start, &cell_idx_end);
+
+	/* Space required by previous work-items. */
+	uint offset = 0;
+	for (uint i = 0; i < get_global_id(0); ++i)
+		offset += sums[i];
+
+	/* Cycle through cells. */
+	for (uint cell_idx = cell_idx_start; cell_idx < cell_idx_end;
+			++cell_idx) {
+
+		/* Number of agents in cell. */
+		uint num_agents = ranges_next[cell_idx].end;
+
+		/* Set range start and cursor. */
+		ranges_next[cell_idx].start = offset;
+		ranges_next[cell_idx].end = offset;
+
+		/* Reserve space for agents and their possible newborns. */
+		offset += 2 * num_agents;
+	}
+}
+
+/**
+ * Scatter kernel for the cell-ordered (CSR) engine.
+ *
+ * This kernel places the live agents in the range of their cell in the
+ * rebuilt agents array.
+ *
+ * @param agents Agents array.
+ * @param agents_next Rebuilt agents array.
+ * @param ranges Agent ranges of each cell.
+ * @param ranges_next Agent ranges of each cell in the rebuilt agents array.
+ * @param parts Partial statistics of each work-item.
+ * */
+__kernel void csr_scatter(__global PPCAgentStoreOcl * agents,
+		__global PPCAgentStoreOcl * agents_next,
+		__global PPCRangeOcl * ranges,
+		__global PPCRangeOcl * ranges_next,
+		__global PPStatisticsOcl * parts) {
+
+	/* Cells to be processed by this work item. */
+	uint cell_idx_start, cell_idx_end;
+	cells_span_get(&cell_idx_start, &cell_idx_end);
+
+	/* Agents which didn't fit in the agents array. */
+	uint tot_errors = 0;
+
+	/* Cycle through cells. */
+	for (uint cell_idx = cell_idx_start; cell_idx < cell_idx_end;
+			++cell_idx) {
+
+		/* Cycle through agents in cell. */
+		for (uint ag_idx = ranges[cell_idx].start;
+				ag_idx < ranges[cell_idx].end; ++ag_idx) {
+
+			/* Skip dead agents. */
+			if (PPC_AG_ENERGY(agents, ag_idx) == 0) continue;
+
+			/* Get place for agent in the range of its cell. */
+			uint neigh_idx = PPC_AG_NEXT(agents, ag_idx);
+			uint new_ag_idx = atomic_inc(&ranges_next[neigh_idx].end);
+
+			/* Is there space for the agent? */
+			if (new_ag_idx < AG_CAPACITY) {
+
+				/* Copy agent, which didn't act yet. */
+				PPC_AG_NEXT(agents_next, new_ag_idx) = neigh_idx;
+				PPC_AG_ENERGY(agents_next, new_ag_idx) =
+					PPC_AG_ENERGY(agents, ag_idx);
+				PPC_AG_TYPE(agents_next, new_ag_idx) =
+					PPC_AG_TYPE(agents, ag_idx);
+				PPC_AG_ACTION(agents_next, new_ag_idx) = 0;
+
+			} else {
+
+				/* No space, agent is lost. */
+				tot_errors++;
+			}
+		}
+	}
+
+	/* Update partial stats. */
+	parts[get_global_id(0)].errors += tot_errors;
+}
+
+/**
+ * Step 2 kernel for the cell-ordered (CSR) engine.
+ *
+ * This kernel performs agent actions and gathers simulation statistics at
+ * the end of the current iteration. The agents of each cell are contiguous,
+ * so they are shuffled in place and streamed sequentially. Newborns are
+ * placed after the agents of their cell. Since agents only interact with
+ * agents in the same cell, cells can be processed in any order, and there
+ * is no need for turns.
+ *
+ * @param agents Agents array.
+ * @param grass Grass countdown of each cell.
+ * @param ranges Agent ranges of each cell.
+ * @param ranges_prev Agent ranges of each cell before the agents array was
+ * rebuilt. The `end` field is reset, so that these ranges can be used for
+ * counting agents in the next iteration.
+ * @param seeds Array of PRNG seeds.
+ * @param parts Partial statistics of each work-item.
+ * @param iter Current iteration.
+ * */
+__kernel void csr_step2(__global PPCAgentStoreOcl * agents,
+		__global uint * grass,
+		__global PPCRangeOcl * ranges,
+		__global PPCRangeOcl * ranges_prev,
+		__global clo_statetype * seeds,
+		__global PPStatisticsOcl * parts,
+		__private uint iter) {
+
+	/* Reset partial statistics */
+	uint sheep_count = 0;
+	uint wolves_count = 0;
+	uint grass_count = 0;
+	uint tot_sheep_en = 0;
+	uint tot_wolves_en = 0;
+	uint tot_grass_en = 0;
+	uint tot_errors = 0;
+
+	/* Cells to be processed by this work item. */
+	uint cell_idx_start, cell_idx_end;
+	cells_span_get(&cell_idx_start, &cell_idx_end);
+
+	/* Cycle through cells. */
+	for (uint cell_idx = cell_idx_start; cell_idx < cell_idx_end;
+			++cell_idx) {
+
+		/* Reset agent counter for next iteration. */
+		ranges_prev[cell_idx].end = 0;
+
+		/* Get range of agents in cell. */
+		uint ag_idx_start = ranges[cell_idx].start;
+		uint ag_idx_end = max(min(ranges[cell_idx].end, (uint) AG_CAPACITY),
+			ag_idx_start);
+
+		/* Newborns are placed after the existing agents. */
+		uint new_ag_idx = ag_idx_end;
+
+#if MAX_AGENT_SHUF > 1
+
+		/* *** Shuffle agents in cell. *** */
+		for (uint i = ag_idx_end - ag_idx_start; i > 1; --i) {
+
+			/* Get a random index for the agents array. */
+			uint j = clo_rng_next_int(seeds, i);
+
+			/* Swap internal agent state with random agent. */
+			swap_agents_state(agents,
+				ag_idx_start + i - 1, ag_idx_start + j);
+
+		}
+#endif
+
+		/* For each agent in cell */
+		for (uint ag_idx = ag_idx_start; ag_idx < ag_idx_end; ++ag_idx) {
+
+			/* Skip agents which were eaten. */
+			if (PPC_AG_ENERGY(agents, ag_idx) == 0) continue;
+
+			/* Set agent action as performed. */
+			PPC_AG_ACTION(agents, ag_idx) = 1;
+
+			/* *** Agent actions. *** */
+
+			/* Is agent a sheep? */
+			if (PPC_AG_TYPE(agents, ag_idx) == SHEEP_ID) {
+
+				/* If there is grass... */
+				if (PP_GRASS_ALIVE(grass[cell_idx], iter)) {
+
+					/* ...eat grass... */
+					grass[cell_idx] = PP_GRASS_EATEN(iter, GRASS_RESTART);
+#ifdef PP_GRASS_STATS_INC
+					grass_count++;
+#endif
+
+					/* ...and gain energy! */
+					PPC_AG_ENERGY(agents, ag_idx) += SHEEP_GAIN_FROM_FOOD;
+				}
+
+				/* Update sheep stats. */
+				sheep_count++;
+				tot_sheep_en += PPC_AG_ENERGY(agents, ag_idx);
+
+			/* Or is agent a wolf? */
+			} else {
+
+				/* Look for a live sheep in the cell. */
+				for (uint local_ag_idx = ag_idx_start;
+						local_ag_idx < ag_idx_end; ++local_ag_idx) {
+
+					/* Is current agent a live sheep? */
+					if ((PPC_AG_TYPE(agents, local_ag_idx) == SHEEP_ID)
+						&& (PPC_AG_ENERGY(agents, local_ag_idx) > 0)) {
+
+						/* It is sheep, eat it! */
+
+						/* If sheep already acted, update sheep stats. */
+						if (PPC_AG_ACTION(agents, local_ag_idx)) {
+
+							sheep_count--;
+							tot_sheep_en -=
+								PPC_AG_ENERGY(agents, local_ag_idx);
+
+						}
+
+						/* Set sheep energy to zero. */
+						PPC_AG_ENERGY(agents, local_ag_idx) = 0;
+
+						/* Increment wolf energy. */
+						PPC_AG_ENERGY(agents, ag_idx) +=
+							WOLVES_GAIN_FROM_FOOD;
+
+						/* One sheep is enough... */
+						break;
+					}
+				}
+
+				/* Update wolves stats. */
+				wolves_count++;
+				tot_wolves_en += PPC_AG_ENERGY(agents, ag_idx);
+
+			}
+
+			/* Try to reproduce agent. */
+
+			uint reproduce_threshold =
+				PPC_AG_TYPE(agents, ag_idx) == SHEEP_ID
+				? SHEEP_REPRODUCE_THRESHOLD
+				: WOLVES_REPRODUCE_THRESHOLD;
+
+			/* Perhaps agent will reproduce if
+			 * energy > reproduce_threshold ? */
+			if (PPC_AG_ENERGY(agents, ag_idx) > reproduce_threshold) {
+
+				uint reproduce_prob =
+					PPC_AG_TYPE(agents, ag_idx) == SHEEP_ID
+					? SHEEP_REPRODUCE_PROB
+					: WOLVES_REPRODUCE_PROB;
+
+				/* Throw dice to see if agent reproduces */
+				if (clo_rng_next_int(seeds, 100) < reproduce_prob) {
+
+					/* Agent will reproduce! Is there space for the
+					 * newborn? */
+					if (new_ag_idx < AG_CAPACITY) {
+
+						/* Create agent with half the energy of parent in
+						 * this cell. */
+						PPCAgentOcl new_ag;
+						new_ag.in.sep.action = 0;
+						new_ag.in.sep.type = PPC_AG_TYPE(agents, ag_idx);
+						new_ag.in.sep.energy =
+							PPC_AG_ENERGY(agents, ag_idx) / 2;
+						new_ag.next = cell_idx;
+
+						/* Save new agent in agent array */
+						PPC_AG_STORE(agents, new_ag_idx, new_ag);
+						new_ag_idx++;
+
+						/* Parent's energy will be halved also */
+						PPC_AG_ENERGY(agents, ag_idx) =
+							PPC_AG_ENERGY(agents, ag_idx)
+							- new_ag.in.sep.energy;
+
+						/* Increment agent count */
+						if (PPC_AG_TYPE(agents, ag_idx) == SHEEP_ID)
+							sheep_count++;
+						else
+							wolves_count++;
+
+						/* I don't touch the energy stats because
+						 * the total energy will remain the same. */
+					} else {
+
+						tot_errors++;
+
+					}
+				}
+			}
+		}
+
+		/* Newborns are now part of the cell. */
+		ranges[cell_idx].end = new_ag_idx;
+
+#ifndef PP_GRASS_STATS_INC
+
+		/* Update grass stats. */
+		if (PP_GRASS_ALIVE(grass[cell_idx], iter))
+			grass_count++;
+		tot_grass_en += PP_GRASS_COUNTDOWN(grass[cell_idx], iter);
+
+#endif
+
+	}
+
+	/* Update partial stats. */
+	uint gid = get_global_id(0);
+	parts[gid].sheep += sheep_count;
+	parts[gid].wolves += wolves_count;
+	parts[gid].grass += grass_count;
+
+	parts[gid].sheep_en += tot_sheep_en;
+	parts[gid].wolves_en += tot_wolves_en;
+	parts[gid].grass_en += tot_grass_en;
+
+	parts[gid].errors += tot_errors;
+}
 
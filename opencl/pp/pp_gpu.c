@@ -47,20 +47,98 @@
 //~ #define PPG_DUMP 0x01
 
 /**
- * The default maximum number of agents: 16777216. Each agent requires
- * 12 bytes, thus by default 192Mb of memory will be allocated for the
- * agents buffer.
- *
- * The agent state is composed of x,y coordinates (2 + 2 bytes), alive
- * flag (1 byte), energy (2 bytes), type (1 byte) and hash (4 bytes).
+ * Byte value with which to fill the agents buffer in order to mark agents
+ * as dead, since dead agents have all bits set.
  * */
-#define PPG_DEFAULT_MAX_AGENTS 16777216
+#define PPG_AGENT_DEAD 0xff
 
 /** Default agent size in bits. */
 #define PPG_DEFAULT_AGENT_SIZE 64
 
+/** Default grass representation. */
+#define PPG_DEFAULT_GRASS "countdown"
+
+/** Default grass statistics mode. */
+#define PPG_DEFAULT_GRASS_STATS "inc"
+
+/** Per-cell counting sort, an agent sort algorithm implemented here
+ * instead of in CL_Ops. */
+#define PPG_SORT_COUNT "count"
+
+/** Incremental per-cell counting sort, which keeps agents which stayed in
+ * their cell in place. */
+#define PPG_SORT_INC "inc"
+
 /** Default agent sort algorithm. */
-#define PPG_SORT_DEFAULT "sbitonic"
+#define PPG_SORT_DEFAULT PPG_SORT_COUNT
+
+/** Reproduction strategy where the newborn of the agent at index `i` is
+ * placed at index `gws_action_agent + i`. */
+#define PPG_REPRO_FIXED "fixed"
+
+/** Reproduction strategy where the newborns of each workgroup are appended
+ * contiguously after the existing agents. */
+#define PPG_REPRO_APPEND "append"
+
+/** Default reproduction strategy. */
+#define PPG_REPRO_DEFAULT PPG_REPRO_FIXED
+
+/** Order of agents within each cell where agents are shuffled
+ * regardless of their type. */
+#define PPG_ORDER_RANDOM "random"
+
+/** Order of agents within each cell where sheep come before wolves, each
+ * type shuffled. */
+#define PPG_ORDER_TYPED "typed"
+
+/** Default order of agents within each cell. */
+#define PPG_ORDER_DEFAULT PPG_ORDER_RANDOM
+
+/** Pipeline where each step of an iteration is performed by its own
+ * kernels. */
+#define PPG_PIPELINE_SPLIT "split"
+
+/** Pipeline where grass regrowth is fused with the grass statistics, agent
+ * counting per cell with agent movement, and the reset of the agent index
+ * in cells with finding it. */
+#define PPG_PIPELINE_FUSED "fused"
+
+/** Default pipeline. */
+#define PPG_PIPELINE_DEFAULT PPG_PIPELINE_FUSED
+
+/** Resolution of grazing and predation conflicts where sheep race for
+ * grass and wolves race for sheep with atomic operations. */
+#define PPG_RESOLVE_ATOMIC "atomic"
+
+/** Resolution of grazing and predation conflicts by rank within each cell,
+ * where the first sheep eats the grass and the k-th wolf eats the k-th
+ * sheep. */
+#define PPG_RESOLVE_RANKED "ranked"
+
+/** Default resolution of grazing and predation conflicts. */
+#define PPG_RESOLVE_DEFAULT PPG_RESOLVE_ATOMIC
+
+/** Layout where cells are stored row after row. */
+#define PPG_CELLS_ROW "row"
+
+/** Layout where cells are stored in Morton (Z) order, so that nearby cells
+ * are stored near each other, with grid sides padded to powers of two. */
+#define PPG_CELLS_MORTON "morton"
+
+/** Default layout of cells in memory. */
+#define PPG_CELLS_DEFAULT PPG_CELLS_ROW
+
+/** Default number of iterations by which the host may run ahead of the
+ * last known number of alive agents. */
+#define PPG_DEFAULT_RUN_AHEAD 1
+
+/** Maximum number of iterations by which the host may run ahead of the
+ * last known number of alive agents. */
+#define PPG_MAX_RUN_AHEAD 16
+
+/** Default number of iterations kept in the device statistics ring, i.e.
+ * of iterations whose statistics are read back at once. */
+#define PPG_DEFAULT_STATS_RING 64
 
 /**
  * A minimal number of possibly existing agents is required in
@@ -102,6 +180,19 @@ typedef struct pp_g_args {
 	/** Maximum number of agents. */
 	cl_uint max_agents;
 
+	/** Grass representation. */
+	gchar * grass;
+
+	/** Grass statistics mode. */
+	gchar * grass_stats;
+
+	/** Iterations by which the host may run ahead of the last known
+	 * number of alive agents. */
+	cl_uint run_ahead;
+
+	/** Iterations kept in the device statistics ring. */
+	cl_uint stats_ring;
+
 } PPGArgs;
 
 /**
@@ -115,6 +206,16 @@ typedef struct pp_g_args_alg {
 	gchar* sort;
 	/** Sort algorithm options. */
 	gchar* sort_opts;
+	/** Agent reproduction strategy. */
+	gchar* repro;
+	/** Simulation pipeline. */
+	gchar* pipeline;
+	/** Order of agents within each cell. */
+	gchar* order;
+	/** Resolution of grazing and predation conflicts. */
+	gchar* resolve;
+	/** Layout of cells in memory. */
+	gchar* cells;
 
 } PPGArgsAlg;
 
@@ -132,8 +233,6 @@ typedef struct pp_g_args_lws {
 	size_t grass;
 	/** Reduce grass 1 kernel. */
 	size_t reduce_grass;
-	/** Reduce agent 1 kernel. */
-	size_t reduce_agent;
 	/** Move agent kernel. */
 	size_t move_agent;
 	/** Sort agent kernel local worksize. */
@@ -159,10 +258,6 @@ typedef struct pp_g_kernels {
 	CCLKernel* reduce_grass1;
 	/** Reduce grass 2 kernel. */
 	CCLKernel* reduce_grass2;
-	/** Reduce agent 1 kernel. */
-	CCLKernel* reduce_agent1;
-	/** Reduce agent 2 kernel. */
-	CCLKernel* reduce_agent2;
 	/** Move agent kernel. */
 	CCLKernel* move_agent;
 	/** Sort agent kernels. */
@@ -171,6 +266,26 @@ typedef struct pp_g_kernels {
 	CCLKernel* find_cell_idx;
 	/** Agent actions kernel. */
 	CCLKernel* action_agent;
+	/** Incremental grass statistics kernel. */
+	CCLKernel* grass_stats;
+	/** Counting sort: count agents per cell kernel. */
+	CCLKernel* sort_count;
+	/** Counting sort: scan cell counts kernel. */
+	CCLKernel* sort_scan;
+	/** Counting sort and agent compaction: scan workgroup totals
+	 * kernel. */
+	CCLKernel* scan_blocks;
+	/** Counting sort: scatter agents kernel. */
+	CCLKernel* sort_scatter;
+	/** Counting sort: canonical order of agents within each cell
+	 * kernel. */
+	CCLKernel* sort_order;
+	/** Agent compaction: scan alive agents kernel. */
+	CCLKernel* compact_scan;
+	/** Agent compaction: update cell layout of previous sort kernel. */
+	CCLKernel* compact_layout;
+	/** Agent compaction: scatter alive agents kernel. */
+	CCLKernel* compact_scatter;
 
 } PPGKernels;
 
@@ -183,8 +298,6 @@ typedef struct pp_g_args_vw {
 	cl_uint grass;
 	/** Width of reduce grass kernels vector operations. */
 	cl_uint reduce_grass;
-	/** Width of reduce agents kernels vector operations. */
-	cl_uint reduce_agent;
 
 } PPGArgsVW;
 
@@ -195,7 +308,8 @@ typedef struct pp_g_global_work_sizes {
 
 	/** Init cells kernel global worksize. */
 	size_t init_cell;
-	/** Init agents kernel global worksize. */
+	/** Init agents kernel global worksize, which is also the initial
+	 * capacity of the agents buffer. */
 	size_t init_agent;
 	/** Grass kernel global worksize. */
 	size_t grass;
@@ -203,6 +317,8 @@ typedef struct pp_g_global_work_sizes {
 	size_t reduce_grass1;
 	/** Reduce grass 2 kernel global worksize. */
 	size_t reduce_grass2;
+	/** Counting sort scan kernel global worksize. */
+	size_t sort_scan;
 
 } PPGGlobalWorkSizes;
 
@@ -226,8 +342,6 @@ typedef struct pp_g_local_work_sizes {
 	size_t reduce_grass1;
 	/** Reduce grass 2 kernel local worksize. */
 	size_t reduce_grass2;
-	/** Reduce agent 1 kernel local worksize. */
-	size_t reduce_agent1;
 	/** Move agent kernel local worksize. */
 	size_t move_agent;
 	/** Sort agent kernel local worksize. */
@@ -246,10 +360,14 @@ typedef struct pp_g_data_sizes {
 
 	/** Simulation statistics. */
 	size_t stats;
+	/** Device statistics ring. */
+	size_t stats_ring;
 	/** Grass regrowth timer array. */
 	size_t cells_grass;
 	/** Agent index in cell array. */
 	size_t cells_agents_index;
+	/** Iteration tag of agent index in cell array. */
+	size_t cells_agents_epoch;
 	/** Agents type and energy. */
 	size_t agents_data;
 	/** Local grass reduction array 1. */
@@ -258,12 +376,26 @@ typedef struct pp_g_data_sizes {
 	size_t reduce_grass_local2;
 	/** Global grass reduction array. */
 	size_t reduce_grass_global;
-	/** Local agent reduction array 1. */
-	size_t reduce_agent_local1;
-	/** Local agent reduction array 2. */
-	size_t reduce_agent_local2;
-	/** Global agent reduction array. */
-	size_t reduce_agent_global;
+	/** Local agent statistics array (move agent kernel). */
+	size_t move_agent_local;
+	/** Local newborns array (agent actions kernel). */
+	size_t action_agent_local;
+	/** Grass regrowth histogram. */
+	size_t grass_regrow;
+	/** Counting sort: number of agents per cell. */
+	size_t sort_cell_count;
+	/** Counting sort: start and number of agents per cell. */
+	size_t sort_cells;
+	/** Counting sort: workgroup totals. */
+	size_t sort_blocks;
+	/** Counting sort: local scan array. */
+	size_t sort_scan_local;
+	/** Incremental counting sort: stayers per cell. */
+	size_t sort_stay;
+	/** Per agent slot scan, relative to the slot's workgroup. */
+	size_t slots_scan;
+	/** Per agent slot scan, workgroup totals. */
+	size_t slots_scan_sums;
 	/** RNG seeds/state array. */
 	size_t rng_seeds;
 
@@ -273,38 +405,82 @@ typedef struct pp_g_data_sizes {
  * Device buffers.
  * */
 typedef struct pp_g_buffers_device {
-	/** Simulation statistics. */
+	/** Simulation statistics ring. */
 	CCLBuffer* stats;
+	/** Pinned staging buffer where the statistics ring is read into. */
+	CCLBuffer* stats_staging;
 	/** Grass regrowth timer array. */
 	CCLBuffer* cells_grass;
 	/** Agent index in cells array. */
 	CCLBuffer* cells_agents_index;
+	/** Iteration in which the agent index of each cell was found. */
+	CCLBuffer* cells_agents_epoch;
 	/** Agents type and energy. */
 	CCLBuffer* agents_data;
 	/** Global grass reduction array. */
 	CCLBuffer* reduce_grass_global;
-	/** Global agent reduction array. */
-	CCLBuffer* reduce_agent_global;
+	/** Grass regrowth histogram. */
+	CCLBuffer* grass_regrow;
+	/** Number of cells whose grass was eaten in current iteration. */
+	CCLBuffer* grass_eaten;
+	/** Number of newborns appended in current iteration. */
+	CCLBuffer* births;
+	/** Number of agent slots, past which agents are dead. */
+	CCLBuffer* agents_num;
+	/** Spare agents array, where the counting sort places the sorted
+	 * agents, then swapped with the agents array. */
+	CCLBuffer* agents_data_swap;
+	/** Counting sort: number of agents per cell. */
+	CCLBuffer* sort_cell_count;
+	/** Counting sort: start and number of agents per cell. */
+	CCLBuffer* sort_cells;
+	/** Counting sort: workgroup totals. */
+	CCLBuffer* sort_blocks;
+	/** Incremental counting sort: stayers per cell. */
+	CCLBuffer* sort_stay;
+	/** Per agent slot scan (of stayers in the incremental counting sort,
+	 * and of alive agents in the agent compaction), relative to the
+	 * slot's workgroup. */
+	CCLBuffer* slots_scan;
+	/** Per agent slot scan, workgroup totals. */
+	CCLBuffer* slots_scan_sums;
 	/** RNG seeds/state array. */
 	CCLBuffer* rng_seeds;
 } PPGBuffersDevice;
 
+/**
+ * Batch of iterations whose statistics are read back from the device
+ * statistics ring into one half of the pinned staging buffer.
+ * */
+typedef struct pp_g_stats_batch {
+	/** Half of the pinned staging buffer. */
+	PPStatistics* staging;
+	/** First iteration in batch. */
+	cl_uint first;
+	/** Number of iterations in batch. */
+	cl_uint count;
+	/** Event of the read, NULL if no read is pending. */
+	CCLEvent* evt;
+} PPGStatsBatch;
+
 /** Main command line arguments and respective default values. */
 static PPGArgs args = {NULL, NULL,
 #ifdef PP_PROFILE_OPT
 	NULL,
 #endif
 	NULL, -1, PP_DEFAULT_SEED,
-	PPG_DEFAULT_AGENT_SIZE, PPG_DEFAULT_MAX_AGENTS};
+	PPG_DEFAULT_AGENT_SIZE, 0, NULL, NULL, PPG_DEFAULT_RUN_AHEAD,
+	PPG_DEFAULT_STATS_RING};
 
 /** Algorithm selection arguments. */
-static PPGArgsAlg args_alg = {NULL, NULL, NULL};
+static PPGArgsAlg args_alg =
+	{NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
 
 /** Local work sizes command-line arguments*/
-static PPGArgsLWS args_lws = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static PPGArgsLWS args_lws = {0, 0, 0, 0, 0, 0, 0, 0, 0};
 
 /** Vector widths command line arguments. */
-static PPGArgsVW args_vw = {0, 0, 0};
+static PPGArgsVW args_vw = {0, 0};
 
 /** Main command line options. */
 static GOptionEntry entries[] = {
@@ -336,9 +512,30 @@ static GOptionEntry entries[] = {
 		G_STRINGIFY(PPG_DEFAULT_AGENT_SIZE) ")",
 		"BITS"},
 	{"max-agents",      'm', 0, G_OPTION_ARG_INT,      &args.max_agents,
-		"Maximum number of agents (default is "
-		G_STRINGIFY(PPG_DEFAULT_MAX_AGENTS) ")",
+		"Maximum number of agents (default is only limited by the device, "
+		"as the agents buffer is grown on demand)",
 		"SIZE"},
+	{"grass",             0, 0, G_OPTION_ARG_STRING,   &args.grass,
+		"Grass representation: countdown (each cell keeps the iterations "
+		"until its grass regrows, decremented every iteration) or lazy "
+		"(each cell keeps the iteration at which its grass regrows, only "
+		"written when grass is eaten) (default is " PPG_DEFAULT_GRASS ")",
+		"GRASS"},
+	{"grass-stats",       0, 0, G_OPTION_ARG_STRING,   &args.grass_stats,
+		"Grass statistics: inc (derived from the cells eaten and regrown "
+		"in each iteration) or full (reduced from all cells, for "
+		"validation) (default is " PPG_DEFAULT_GRASS_STATS ")",
+		"MODE"},
+	{"run-ahead",         0, 0, G_OPTION_ARG_INT,      &args.run_ahead,
+		"With the counting sorts, iterations by which the host may enqueue "
+		"work ahead of the last known number of alive agents, assuming it "
+		"at most doubles in each iteration (default is "
+		G_STRINGIFY(PPG_DEFAULT_RUN_AHEAD) ")",
+		"ITERS"},
+	{"stats-ring",        0, 0, G_OPTION_ARG_INT,      &args.stats_ring,
+		"Iterations whose statistics are kept on the device and read back "
+		"at once (default is " G_STRINGIFY(PPG_DEFAULT_STATS_RING) ")",
+		"ITERS"},
 	{G_OPTION_REMAINING, 0,  0, G_OPTION_ARG_CALLBACK, pp_args_fail, NULL,
 		NULL},
 	{ NULL, 0, 0, 0, NULL, NULL, NULL }
@@ -350,11 +547,42 @@ static GOptionEntry entries_alg[] = {
 		"Random number generator: " CLO_RNG_IMPLS,
 		"ALGORITHM"},
 	{"a-sort", 0, 0, G_OPTION_ARG_STRING, &args_alg.sort,
-		"Sorting: " CLO_SORT_IMPLS,
+		"Sorting: " PPG_SORT_COUNT " (per-cell counting sort), "
+		PPG_SORT_INC " (incremental counting sort), "
+		CLO_SORT_IMPLS " (default is " PPG_SORT_DEFAULT ")",
 		"ALGORITHM"},
 	{"a-sort-opts", 0, 0, G_OPTION_ARG_STRING, &args_alg.sort_opts,
 		"Sort algorithm options",
 		"OPTIONS"},
+	{"a-repro", 0, 0, G_OPTION_ARG_STRING, &args_alg.repro,
+		"Reproduction: " PPG_REPRO_FIXED " (newborn of agent i placed at "
+		"a fixed index after all agents) or " PPG_REPRO_APPEND " (newborns "
+		"of each workgroup appended contiguously) (default is "
+		PPG_REPRO_DEFAULT ")",
+		"STRATEGY"},
+	{"a-pipeline", 0, 0, G_OPTION_ARG_STRING, &args_alg.pipeline,
+		"Pipeline: " PPG_PIPELINE_SPLIT " (one pass per step) or "
+		PPG_PIPELINE_FUSED " (grass regrowth, agent counting per cell and "
+		"agent index reset fused with other passes) (default is "
+		PPG_PIPELINE_DEFAULT ")",
+		"PIPELINE"},
+	{"a-order", 0, 0, G_OPTION_ARG_STRING, &args_alg.order,
+		"Order of agents in each cell: " PPG_ORDER_RANDOM " (shuffled) or "
+		PPG_ORDER_TYPED " (sheep before wolves, each shuffled, so wolves "
+		"pick sheep by rank) (default is " PPG_ORDER_DEFAULT ")",
+		"ORDER"},
+	{"a-resolve", 0, 0, G_OPTION_ARG_STRING, &args_alg.resolve,
+		"Grazing and predation conflicts: " PPG_RESOLVE_ATOMIC " (agents "
+		"race with atomics) or " PPG_RESOLVE_RANKED " (decided by rank in "
+		"cell, reproducible, requires the " PPG_ORDER_TYPED " order, "
+		PPG_REPRO_FIXED " reproduction and a counting sort) (default is "
+		PPG_RESOLVE_DEFAULT ")",
+		"RESOLUTION"},
+	{"a-cells", 0, 0, G_OPTION_ARG_STRING, &args_alg.cells,
+		"Cell layout in memory: " PPG_CELLS_ROW " (row-major) or "
+		PPG_CELLS_MORTON " (Morton order, requires a counting sort) "
+		"(default is " PPG_CELLS_DEFAULT ")",
+		"LAYOUT"},
 	{ NULL, 0, 0, 0, NULL, NULL, NULL }
 };
 
@@ -375,14 +603,11 @@ static GOptionEntry entries_lws[] = {
 	{"l-reduce-grass", 0, 0, G_OPTION_ARG_INT, &args_lws.reduce_grass,
 		"Reduce grass kernel",
 		"LWS"},
-	{"l-reduce-agent", 0, 0, G_OPTION_ARG_INT, &args_lws.reduce_agent,
-		"Reduce agent kernel",
-		"LWS"},
 	{"l-move-agent",   0, 0, G_OPTION_ARG_INT, &args_lws.move_agent,
-		"Move agent kernel",
+		"Move agent kernel (also gathers agent statistics)",
 		"LWS"},
 	{"l-sort-agent",   0, 0, G_OPTION_ARG_INT, &args_lws.sort_agent,
-		"Sort agent kernel",
+		"Sort agent kernel (also agent compaction kernels)",
 		"LWS"},
 	{"l-find-index",   0, 0, G_OPTION_ARG_INT, &args_lws.find_cell_idx,
 		"Find cell agent index kernel",
@@ -402,18 +627,224 @@ static GOptionEntry entries_vw[] = {
 		"Vector (of uints) width for grass reduce kernel, default is 0 "
 		"(auto-detect)",
 		"WIDTH"},
-	{"vw-reduce-agent", 0, 0, G_OPTION_ARG_INT, &args_vw.reduce_agent,
-		"Vector (of uint/ulongs, depends on --agent-size) width for agent "
-		"reduce kernel, default is 0 (auto-detect)",
-		"WIDTH"},
 	{ NULL, 0, 0, 0, NULL, NULL, NULL }
 };
 
 /** Agent size in bytes. */
 static size_t agent_size_bytes;
 
+/** Largest capacity of the agents buffer, in agents, for which it and the
+ * other per-slot buffers fit in a device memory allocation. */
+static size_t agents_capacity_max = G_MAXSIZE;
+
+/**
+ * Is the lazy grass representation selected? In this case the grass kernel
+ * does not decrement grass counters, and the kernels which read them compare
+ * the iteration at which grass regrows with the current iteration.
+ *
+ * @return `TRUE` if the lazy grass representation is selected, `FALSE`
+ * otherwise.
+ * */
+static gboolean ppg_grass_is_lazy() {
+	return g_strcmp0(args.grass, "lazy") == 0;
+}
+
+/**
+ * Are grass statistics derived incrementally? In this case the grass
+ * reduction kernels only run in the first iteration, and the grass
+ * statistics of the following iterations are derived from the cells eaten
+ * and regrown in each of them.
+ *
+ * @return `TRUE` if grass statistics are derived incrementally, `FALSE`
+ * if they are reduced from all cells in every iteration.
+ * */
+static gboolean ppg_grass_stats_is_inc() {
+	return g_strcmp0(args.grass_stats, "inc") == 0;
+}
+
+/**
+ * Is the per-cell counting sort selected, either full or incremental? In
+ * this case agents are sorted by the counting sort kernels into a spare
+ * agents buffer, instead of by a CL_Ops sorter.
+ *
+ * @return `TRUE` if the counting sort is selected, `FALSE` otherwise.
+ * */
+static gboolean ppg_sort_is_count() {
+	return (g_strcmp0(args_alg.sort, PPG_SORT_COUNT) == 0)
+		|| (g_strcmp0(args_alg.sort, PPG_SORT_INC) == 0);
+}
+
+/**
+ * Is the incremental counting sort selected? In this case agents which
+ * remain in the slots of their cell since the previous sort keep their
+ * place and order, and only the remaining agents are scattered.
+ *
+ * @return `TRUE` if the incremental counting sort is selected, `FALSE`
+ * otherwise.
+ * */
+static gboolean ppg_sort_is_inc() {
+	return g_strcmp0(args_alg.sort, PPG_SORT_INC) == 0;
+}
+
+/**
+ * Is the append reproduction strategy selected? In this case the agent
+ * actions kernel stages the newborns of each workgroup in local memory and
+ * appends them contiguously, reserving room with one global atomic per
+ * workgroup.
+ *
+ * @return `TRUE` if the append reproduction strategy is selected, `FALSE`
+ * otherwise.
+ * */
+static gboolean ppg_repro_is_append() {
+	return g_strcmp0(args_alg.repro, PPG_REPRO_APPEND) == 0;
+}
+
+/**
+ * Is the typed order of agents within each cell selected? In this case
+ * agents are sorted by cell and type, sheep first, only sheep are indexed
+ * in cells, and each wolf first tries to eat the sheep given by its rank
+ * among the wolves in its cell.
+ *
+ * @return `TRUE` if the typed order is selected, `FALSE` otherwise.
+ * */
+static gboolean ppg_order_is_typed() {
+	return g_strcmp0(args_alg.order, PPG_ORDER_TYPED) == 0;
+}
+
+/**
+ * Is the ranked resolution of grazing and predation conflicts selected? In
+ * this case only the first sheep in each cell may eat its grass, the k-th
+ * wolf eats the k-th sheep, and the counting sort puts the agents of each
+ * cell in a canonical order, so that agent actions need no atomics and
+ * runs are reproducible.
+ *
+ * @return `TRUE` if the ranked resolution is selected, `FALSE` otherwise.
+ * */
+static gboolean ppg_resolve_is_ranked() {
+	return g_strcmp0(args_alg.resolve, PPG_RESOLVE_RANKED) == 0;
+}
+
+/**
+ * Is the Morton cell layout selected? In this case cells are indexed by
+ * interleaving the bits of their coordinates, for grass, the agent index
+ * in cells and the counting sort keys alike, so that agents in nearby
+ * cells are also stored near each other.
+ *
+ * @return `TRUE` if the Morton cell layout is selected, `FALSE`
+ * otherwise.
+ * */
+static gboolean ppg_cells_is_morton() {
+	return g_strcmp0(args_alg.cells, PPG_CELLS_MORTON) == 0;
+}
+
+/**
+ * Determine the number of bits required to represent the values from zero
+ * to `n - 1`.
+ *
+ * @param[in] n Number of values, larger than zero.
+ * @return Number of bits, i.e. the base 2 logarithm of `n` rounded up.
+ * */
+static cl_uint ppg_bits(cl_uint n) {
+	cl_uint bits = 0;
+	while (bits < 32 && (1u << bits) < n) bits++;
+	return bits;
+}
+
+/**
+ * Determine the number of low bits of each coordinate which the Morton
+ * cell layout interleaves. The remaining bits of the longer grid side
+ * follow them.
+ *
+ * @param[in] params Simulation parameters.
+ * @return Number of interleaved bits of each coordinate.
+ * */
+static cl_uint ppg_morton_bits(PPParameters params) {
+	return ppg_bits(MIN(params.grid_x, params.grid_y));
+}
+
+/**
+ * Determine the number of slots in cell buffers, i.e. the number of cells
+ * or, with the Morton layout, the cells of the grid padded to power of two
+ * sides. Padding cells never hold grass or agents.
+ *
+ * @param[in] params Simulation parameters.
+ * @return Number of cell slots.
+ * */
+static size_t ppg_cell_slots(PPParameters params) {
+	return ppg_cells_is_morton()
+		? (size_t) 1 << (ppg_bits(params.grid_x) + ppg_bits(params.grid_y))
+		: params.grid_xy;
+}
+
+/**
+ * Determine the number of keys by which the counting sort sorts agents,
+ * i.e. the number of cell slots or, with the typed order, twice as many.
+ *
+ * @param[in] params Simulation parameters.
+ * @return Number of counting sort keys.
+ * */
+static size_t ppg_sort_keys(PPParameters params) {
+	return ppg_order_is_typed()
+		? 2 * ppg_cell_slots(params) : ppg_cell_slots(params);
+}
+
+/**
+ * Is the fused pipeline selected? In this case grass is regrown by the
+ * grass statistics kernels, and the agent index in cells is not reset, but
+ * tagged with the iteration in which it is found.
+ *
+ * @return `TRUE` if the fused pipeline is selected, `FALSE` otherwise.
+ * */
+static gboolean ppg_pipeline_is_fused() {
+	return g_strcmp0(args_alg.pipeline, PPG_PIPELINE_FUSED) == 0;
+}
+
+/**
+ * Are agents counted per cell by the agent movement kernel? This is the
+ * case with the fused pipeline and the (full) counting sort, which then
+ * skips its counting step. The incremental counting sort still counts
+ * agents itself, as it must also scan the agents which stay in place.
+ *
+ * @return `TRUE` if agents are counted per cell when they move, `FALSE`
+ * otherwise.
+ * */
+static gboolean ppg_sort_count_in_move() {
+	return ppg_pipeline_is_fused() && ppg_sort_is_count()
+		&& !ppg_sort_is_inc();
+}
+
 #ifdef PPG_DUMP
 
+/**
+ * Determine the Morton index of a cell. Must match `ppg_morton()` in the
+ * kernels.
+ *
+ * @param[in] params Simulation parameters.
+ * @param[in] x Cell column.
+ * @param[in] y Cell row.
+ * @return Morton index of cell.
+ * */
+static cl_uint ppg_morton(PPParameters params, cl_uint x, cl_uint y) {
+	cl_uint bits = ppg_morton_bits(params);
+	cl_uint idx = 0;
+	for (cl_uint b = 0; b < bits; b++)
+		idx |= (((x >> b) & 1) << (2 * b)) | (((y >> b) & 1) << (2 * b + 1));
+	return idx | (((x | y) >> bits) << (2 * bits));
+}
+
+/**
+ * Determine where a cell is stored.
+ *
+ * @param[in] params Simulation parameters.
+ * @param[in] x Cell column.
+ * @param[in] y Cell row.
+ * @return Index of cell in cell buffers.
+ * */
+static cl_uint ppg_cell_slot(PPParameters params, cl_uint x, cl_uint y) {
+	return ppg_cells_is_morton()
+		? ppg_morton(params, x, y) : y * params.grid_x + x;
+}
+
 /**
  * Dump simulation data for current iteration.
  *
@@ -437,14 +868,19 @@ static size_t agent_size_bytes;
  * */
 static void ppg_dump(int iter, int dump_type, CCLQueue* cq,
 	FILE* fp_agent_dump, FILE* fp_cell_dump, cl_uint max_agents_iter,
-	size_t gws_reduce_agent1, size_t gws_action_agent,
-	size_t gws_move_agent, PPParameters params, PPGDataSizes dataSizes,
-	PPGBuffersDevice buffersDevice, void *agents_data,
+	size_t gws_action_agent, size_t gws_move_agent, PPParameters params,
+	PPGDataSizes dataSizes, PPGBuffersDevice buffersDevice, void *agents_data,
 	cl_uint2 *cells_agents_index, cl_uint *cells_grass, GError** err) {
 
 	/* Aux. status vars. */
 	int blank_line;
 
+	/* Iteration in which the agent index of each cell was found. */
+	cl_uint * cells_epoch = NULL;
+
+	/* Number of agents in the agents buffer. */
+	size_t num_agents = dataSizes.agents_data / agent_size_bytes;
+
 	/* Internal error handling object. */
 	GError* err_internal = NULL;
 
@@ -458,20 +894,35 @@ static void ppg_dump(int iter, int dump_type, CCLQueue* cq,
 		NULL, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
+	/* With the fused pipeline, cells which were not tagged with the
+	 * iteration in which agents act have no agents. */
+	if (ppg_pipeline_is_fused() && (iter != -1)) {
+		cells_epoch = g_new(cl_uint, ppg_cell_slots(params));
+		ccl_buffer_enqueue_read(buffersDevice.cells_agents_epoch, cq,
+			CL_TRUE, 0, dataSizes.cells_agents_epoch, cells_epoch, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		for (cl_uint k = 0; k < ppg_cell_slots(params); k++) {
+			if (cells_epoch[k] != (cl_uint) iter + 1) {
+				cells_agents_index[k].s[0] = args.max_agents;
+				cells_agents_index[k].s[1] = args.max_agents;
+			}
+		}
+	}
+
 	ccl_buffer_enqueue_read(buffersDevice.cells_grass, cq, CL_TRUE, 0,
 		dataSizes.cells_grass, cells_grass, NULL, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
 	/* Export agent info. */
 	fprintf(fp_agent_dump, "\nIter %d, max_agents_iter=%d, " \
-		"gws_reduce_agent1=%zu, gws_action_ag=%zu, gws_mov_ag=%zu\n",
-		iter, max_agents_iter, gws_reduce_agent1, gws_action_agent,
-		gws_move_agent);
+		"gws_action_ag=%zu, gws_mov_ag=%zu\n",
+		iter, max_agents_iter, gws_action_agent, gws_move_agent);
 	blank_line = FALSE;
 
 	if (agent_size_bytes == 8) {
 
-		for (cl_uint k = 0; k < args.max_agents; k++) {
+		for (cl_uint k = 0; k < num_agents; k++) {
 			cl_ulong curr_ag = ((cl_ulong*) agents_data)[k];
 			if (!(dump_type & 0x01) ||
 				((curr_ag & 0xFFFFFFFF00000000)!= 0xFFFFFFFF00000000)) {
@@ -493,7 +944,7 @@ static void ppg_dump(int iter, int dump_type, CCLQueue* cq,
 
 	} else if (agent_size_bytes == 4) {
 
-		for (cl_uint k = 0; k < args.max_agents; k++) {
+		for (cl_uint k = 0; k < num_agents; k++) {
 			cl_uint curr_ag = ((cl_uint*) agents_data)[k];
 			if (!(dump_type & 0x01) || ((curr_ag & 0xFFFF0000)!= 0xFFFF0000)) {
 				if (blank_line) fprintf(fp_agent_dump, "\n");
@@ -515,22 +966,27 @@ static void ppg_dump(int iter, int dump_type, CCLQueue* cq,
 	fprintf(fp_cell_dump, "\nIteration %d\n", iter);
 	blank_line = FALSE;
 	for (cl_uint k = 0; k < params.grid_xy; k++) {
+
+		/* Cells are dumped in row-major order, whatever their layout. */
+		cl_uint c = ppg_cell_slot(params, k % params.grid_x,
+			k / params.grid_x);
+
 		if (!(dump_type & 0x10) || ((iter != -1)
-				& (cells_agents_index[k].s[0] != args.max_agents))) {
+				& (cells_agents_index[c].s[0] != args.max_agents))) {
 
 			if (blank_line) fprintf(fp_cell_dump, "\n");
 			blank_line = FALSE;
 			if (iter != -1) {
 				fprintf(fp_cell_dump, "(%d, %d) -> (%d, %d) %s [Grass: %d]\n",
 					k % params.grid_x, k / params.grid_y,
-					cells_agents_index[k].s[0], cells_agents_index[k].s[1],
-					cells_agents_index[k].s[0] != cells_agents_index[k].s[1] ?
+					cells_agents_index[c].s[0], cells_agents_index[c].s[1],
+					cells_agents_index[c].s[0] != cells_agents_index[c].s[1] ?
 						"More than 1 agent present" : "",
-					cells_grass[k]);
+					cells_grass[c]);
 			} else {
 				fprintf(fp_cell_dump, "(%d, %d) -> (-, -) [Grass: %d]\n",
 					k % params.grid_x, k / params.grid_y,
-					cells_grass[k]);
+					cells_grass[c]);
 			}
 		} else {
 			blank_line = TRUE;
@@ -547,6 +1003,9 @@ error_handler:
 
 finish:
 
+	/* Free tags of cells. */
+	g_free(cells_epoch);
+
 	/* Return. */
 	return;
 
@@ -554,10 +1013,705 @@ finish:
 
 #endif
 
+/**
+ * Determine the number of agent slots required by the current iteration,
+ * i.e. the agents which may be alive at its start plus their possible
+ * newborns. With `n` agent slots, the newborn of the agent at index `i` is
+ * placed at index `n + i`, or, with the append reproduction strategy,
+ * newborns are packed from index `n`, which requires no more slots.
+ *
+ * @param[in] max_agents_iter The maximum agents there can be in the
+ * current iteration.
+ * @return Number of agent slots required by the current iteration.
+ * */
+static size_t ppg_agents_required(cl_uint max_agents_iter) {
+
+	return 2 * (size_t) max_agents_iter;
+
+}
+
+/**
+ * Determine the size of the per agent slot scan buffers for the given
+ * capacity of the agents buffer. Scans are launched for one slot past the
+ * last agent, and the workgroup totals are followed by the overall total.
+ *
+ * @param[in] capacity Capacity of the agents buffer, in agents.
+ * @param[in] lws Kernel local work sizes.
+ * @param[out] dataSizes Size of data buffers.
+ * */
+static void ppg_slots_scan_datasizes(size_t capacity,
+	PPGLocalWorkSizes lws, PPGDataSizes * dataSizes) {
+
+	size_t slots = CLO_GWS_MULT(capacity + 1, lws.sort_agent);
+
+	dataSizes->slots_scan = slots * sizeof(cl_uint);
+	dataSizes->slots_scan_sums =
+		(slots / lws.sort_agent + 1) * sizeof(cl_uint);
+
+}
+
+/**
+ * Update arguments of the simulation loop kernels which refer to the
+ * agents buffer or to the RNG seeds, after these have been replaced.
+ *
+ * @param[in] krnls OpenCL kernels.
+ * @param[in] buffersDevice Device data buffers.
+ * */
+static void ppg_agents_kernelargs_update(PPGKernels krnls,
+	PPGBuffersDevice * buffersDevice) {
+
+	ccl_kernel_set_arg(krnls.move_agent, 0, buffersDevice->agents_data);
+	ccl_kernel_set_arg(krnls.move_agent, 1, buffersDevice->rng_seeds);
+	ccl_kernel_set_arg(krnls.find_cell_idx, 0, buffersDevice->agents_data);
+	ccl_kernel_set_arg(krnls.action_agent, 2, buffersDevice->agents_data);
+	ccl_kernel_set_arg(krnls.action_agent, 3, buffersDevice->agents_data);
+	ccl_kernel_set_arg(krnls.action_agent, 4, buffersDevice->rng_seeds);
+
+	/* Per agent slot scan buffers. */
+	if (buffersDevice->slots_scan) {
+		ccl_kernel_set_args(krnls.compact_scan, ccl_arg_skip,
+			buffersDevice->slots_scan, buffersDevice->slots_scan_sums,
+			NULL);
+		ccl_kernel_set_args(krnls.compact_scatter, ccl_arg_skip,
+			ccl_arg_skip, buffersDevice->slots_scan,
+			buffersDevice->slots_scan_sums, NULL);
+	}
+	if (buffersDevice->slots_scan && buffersDevice->sort_stay) {
+		ccl_kernel_set_args(krnls.compact_layout, ccl_arg_skip,
+			ccl_arg_skip, buffersDevice->slots_scan,
+			buffersDevice->slots_scan_sums, NULL);
+		ccl_kernel_set_args(krnls.sort_count, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_skip, ccl_arg_skip, ccl_arg_skip,
+			buffersDevice->slots_scan, buffersDevice->slots_scan_sums,
+			NULL);
+		ccl_kernel_set_args(krnls.sort_scan, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_skip, ccl_arg_skip, ccl_arg_skip,
+			buffersDevice->slots_scan, buffersDevice->slots_scan_sums,
+			NULL);
+		ccl_kernel_set_args(krnls.sort_scatter, ccl_arg_skip,
+			ccl_arg_skip, ccl_arg_skip, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_skip, ccl_arg_skip, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_skip, ccl_arg_skip, buffersDevice->slots_scan,
+			buffersDevice->slots_scan_sums, NULL);
+	}
+
+}
+
+/**
+ * Sort agents by cell with the per-cell counting sort. Alive agents are
+ * counted per cell (with the fused pipeline, already when they move),
+ * counts are scanned in order to find where each cell starts, and agents
+ * are scattered into the spare agents buffer, which then becomes the
+ * agents buffer. Agents within a cell are shuffled with
+ * a permutation which depends on the cell and on the current iteration.
+ * With the ranked conflict resolution, they are then put in a canonical
+ * order, which does not depend on how the scatter step ranked them.
+ * With the incremental counting sort, agents which stayed in the slots of
+ * their cell are found and scanned while counting, and only the remaining
+ * agents are ranked and shuffled.
+ *
+ * @param[in] cq Command queue where agents are handled.
+ * @param[in] krnls OpenCL kernels.
+ * @param[in] gws Global work sizes.
+ * @param[in] lws Local work sizes.
+ * @param[in] num_agents Number of agent slots to sort.
+ * @param[in,out] num_stale Number of slots of the spare agents buffer
+ * which may hold stale agents, which the scatter step marks as dead.
+ * @param[in] iter Current iteration.
+ * @param[in,out] buffersDevice Device data buffers.
+ * @param[out] err Return location for a GError.
+ * @return Event associated with the last counting sort kernel.
+ * */
+static CCLEvent * ppg_sort_count(CCLQueue * cq, PPGKernels krnls,
+	PPGGlobalWorkSizes gws, PPGLocalWorkSizes lws, size_t num_agents,
+	size_t * num_stale, cl_uint iter, PPGBuffersDevice * buffersDevice,
+	GError ** err) {
+
+	/* Event wrapper. */
+	CCLEvent * evt = NULL;
+
+	/* Spare agents buffer. */
+	CCLBuffer * agents_data_swap;
+
+	/* Number of agent slots to be written by the scatter step. */
+	cl_uint num_slots = MAX(num_agents, *num_stale);
+
+	/* Kernel global worksizes. The incremental counting sort counts one
+	 * slot past the last agent, so that stayers before it are scanned. */
+	size_t gws_count = CLO_GWS_MULT(
+		ppg_sort_is_inc() ? num_agents + 1 : num_agents, lws.sort_agent);
+	size_t gws_scatter = CLO_GWS_MULT(num_slots, lws.sort_agent);
+
+	/* Number of workgroups in count and scan steps. */
+	cl_uint num_slot_blocks = gws_count / lws.sort_agent;
+	cl_uint num_blocks = gws.sort_scan / lws.sort_agent;
+
+	/* Internal error handling object. */
+	GError * err_internal = NULL;
+
+	/* Count agents in each cell, unless they were counted when they
+	 * moved. */
+	if (!ppg_sort_count_in_move()) {
+		ccl_kernel_set_arg(krnls.sort_count, 0,
+			buffersDevice->agents_data);
+		evt = ccl_kernel_enqueue_ndrange(krnls.sort_count, cq, 1, NULL,
+			&gws_count, &(lws.sort_agent), NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: sort count");
+	}
+
+	/* Scan workgroup totals of stayers with a single workgroup. */
+	if (ppg_sort_is_inc()) {
+		ccl_kernel_set_args(krnls.scan_blocks,
+			buffersDevice->slots_scan_sums, ccl_arg_skip,
+			ccl_arg_priv(num_slot_blocks, cl_uint), NULL);
+		evt = ccl_kernel_enqueue_ndrange(krnls.scan_blocks, cq, 1,
+			NULL, &(lws.sort_agent), &(lws.sort_agent), NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: sort scan slot blocks");
+	}
+
+	/* Scan cell counts. */
+	evt = ccl_kernel_enqueue_ndrange(krnls.sort_scan, cq, 1, NULL,
+		&(gws.sort_scan), &(lws.sort_agent), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "K: sort scan");
+
+	/* Scan workgroup totals with a single workgroup. */
+	ccl_kernel_set_args(krnls.scan_blocks, buffersDevice->sort_blocks,
+		ccl_arg_skip, ccl_arg_priv(num_blocks, cl_uint), NULL);
+	evt = ccl_kernel_enqueue_ndrange(krnls.scan_blocks, cq, 1, NULL,
+		&(lws.sort_agent), &(lws.sort_agent), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "K: sort scan blocks");
+
+	/* Scatter agents into the spare agents buffer. */
+	ccl_kernel_set_args(krnls.sort_scatter, buffersDevice->agents_data,
+		buffersDevice->agents_data_swap, ccl_arg_skip, ccl_arg_skip,
+		ccl_arg_skip, ccl_arg_skip, ccl_arg_skip,
+		ccl_arg_priv(num_slots, cl_uint), ccl_arg_priv(iter, cl_uint),
+		NULL);
+	evt = ccl_kernel_enqueue_ndrange(krnls.sort_scatter, cq, 1, NULL,
+		&gws_scatter, &(lws.sort_agent), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "K: sort scatter");
+
+	/* Put the agents of each cell in a canonical order, so that the
+	 * outcome of their actions does not depend on how they were ranked. */
+	if (ppg_resolve_is_ranked()) {
+		ccl_kernel_set_args(krnls.sort_order,
+			buffersDevice->agents_data_swap, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_priv(iter, cl_uint), NULL);
+		evt = ccl_kernel_enqueue_ndrange(krnls.sort_order, cq, 1, NULL,
+			&(gws.sort_scan), &(lws.sort_agent), NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: sort order");
+	}
+
+	/* Swap agent buffers. Stale agents in the new spare buffer are the
+	 * ones sorted now. */
+	agents_data_swap = buffersDevice->agents_data_swap;
+	buffersDevice->agents_data_swap = buffersDevice->agents_data;
+	buffersDevice->agents_data = agents_data_swap;
+	*num_stale = num_agents;
+	ppg_agents_kernelargs_update(krnls, buffersDevice);
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+	evt = NULL;
+
+finish:
+
+	/* Return last event. */
+	return evt;
+
+}
+
+/**
+ * Compact agents after agent actions, so that alive agents, including
+ * newborns, are packed in order at the start of the agents buffer. Alive
+ * agents are scanned, and scattered into the spare agents buffer, which
+ * then becomes the agents buffer. With the incremental counting sort, the
+ * cell layout of the previous sort is updated accordingly. The number of
+ * alive agents becomes the number of agent slots on the device, and is
+ * read back to the host.
+ *
+ * @param[in] cq Command queue where agents are handled.
+ * @param[in] krnls OpenCL kernels.
+ * @param[in] gws Global work sizes.
+ * @param[in] lws Local work sizes.
+ * @param[in] num_agents Number of agent slots to compact.
+ * @param[in,out] num_stale Number of slots of the spare agents buffer
+ * which may hold stale agents, which the scatter step marks as dead.
+ * @param[out] num_alive Location where to read the number of alive agents
+ * into. Only valid after the returned event completes.
+ * @param[in,out] buffersDevice Device data buffers.
+ * @param[out] err Return location for a GError.
+ * @return Event associated with reading the number of alive agents.
+ * */
+static CCLEvent * ppg_agents_compact(CCLQueue * cq, PPGKernels krnls,
+	PPGGlobalWorkSizes gws, PPGLocalWorkSizes lws, size_t num_agents,
+	size_t * num_stale, cl_uint * num_alive,
+	PPGBuffersDevice * buffersDevice, GError ** err) {
+
+	/* Event wrapper. */
+	CCLEvent * evt = NULL;
+
+	/* Spare agents buffer. */
+	CCLBuffer * agents_data_swap;
+
+	/* Number of agent slots to be written by the scatter step. */
+	cl_uint num_slots = MAX(num_agents, *num_stale);
+
+	/* Kernel global worksizes. Alive agents are scanned up to one slot
+	 * past the last agent, so that the cell layout can be updated. */
+	size_t gws_scan = CLO_GWS_MULT(num_agents + 1, lws.sort_agent);
+	size_t gws_scatter = CLO_GWS_MULT(num_slots, lws.sort_agent);
+
+	/* Number of workgroups in scan step. */
+	cl_uint num_blocks = gws_scan / lws.sort_agent;
+
+	/* Internal error handling object. */
+	GError * err_internal = NULL;
+
+	/* Scan alive agents. */
+	ccl_kernel_set_arg(krnls.compact_scan, 0, buffersDevice->agents_data);
+	evt = ccl_kernel_enqueue_ndrange(krnls.compact_scan, cq, 1, NULL,
+		&gws_scan, &(lws.sort_agent), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "K: compact scan");
+
+	/* Scan workgroup totals with a single workgroup. */
+	ccl_kernel_set_args(krnls.scan_blocks, buffersDevice->slots_scan_sums,
+		ccl_arg_skip, ccl_arg_priv(num_blocks, cl_uint), NULL);
+	evt = ccl_kernel_enqueue_ndrange(krnls.scan_blocks, cq, 1, NULL,
+		&(lws.sort_agent), &(lws.sort_agent), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "K: compact scan blocks");
+
+	/* Update cell layout of the previous sort. */
+	if (ppg_sort_is_inc()) {
+		evt = ccl_kernel_enqueue_ndrange(krnls.compact_layout, cq, 1,
+			NULL, &(gws.sort_scan), &(lws.sort_agent), NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "K: compact layout");
+	}
+
+	/* Scatter alive agents into the spare agents buffer. */
+	ccl_kernel_set_args(krnls.compact_scatter, buffersDevice->agents_data,
+		buffersDevice->agents_data_swap, ccl_arg_skip, ccl_arg_skip,
+		ccl_arg_priv(num_blocks, cl_uint),
+		ccl_arg_priv(num_slots, cl_uint), NULL);
+	evt = ccl_kernel_enqueue_ndrange(krnls.compact_scatter, cq, 1, NULL,
+		&gws_scatter, &(lws.sort_agent), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "K: compact scatter");
+
+	/* Alive agents, placed after the workgroup totals, are the agent
+	 * slots from now on. Read them back to the host. */
+	evt = ccl_buffer_enqueue_copy(buffersDevice->slots_scan_sums,
+		buffersDevice->agents_num, cq, num_blocks * sizeof(cl_uint), 0,
+		sizeof(cl_uint), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Copy: alive agents");
+
+	evt = ccl_buffer_enqueue_read(buffersDevice->agents_num, cq,
+		CL_FALSE, 0, sizeof(cl_uint), num_alive, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Read: alive agents");
+
+	/* Swap agent buffers. Stale agents in the new spare buffer are the
+	 * ones compacted now. */
+	agents_data_swap = buffersDevice->agents_data_swap;
+	buffersDevice->agents_data_swap = buffersDevice->agents_data;
+	buffersDevice->agents_data = agents_data_swap;
+	*num_stale = num_agents;
+	ppg_agents_kernelargs_update(krnls, buffersDevice);
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+	evt = NULL;
+
+finish:
+
+	/* Return read event. */
+	return evt;
+
+}
+
+/**
+ * Determine the capacity of the agents buffer for the given number of
+ * required agent slots. Room for twice the required slots is reserved, so
+ * that the buffer is not resized again while the population varies by
+ * less than a factor of two, plus a maximum local work size, since the
+ * global work sizes of kernels are rounded up past the last agent. The
+ * capacity never exceeds what device memory allocations can hold.
+ *
+ * @param[in] required Number of required agent slots.
+ * @param[in] lws Kernel local work sizes.
+ * @return Capacity of the agents buffer, in agents.
+ * */
+static size_t ppg_agents_capacity(size_t required, PPGLocalWorkSizes lws) {
+
+	size_t capacity = 2 * required;
+
+	/* The limit is zero while it is yet to be determined. */
+	if (args.max_agents > 0)
+		capacity = MIN(capacity, (size_t) args.max_agents);
+
+	return MIN(CLO_GWS_MULT(capacity + lws.max_lws, lws.init_agent),
+		agents_capacity_max);
+
+}
+
+/**
+ * Determine the largest capacity of the agents buffer for which it, its
+ * spare buffer, the RNG seeds and the per-slot scan buffers fit in a
+ * device memory allocation, and bound the agents limit by it, leaving
+ * room for the local work size slack added to the capacity.
+ *
+ * @param[in] max_alloc Maximum size of device memory allocations.
+ * @param[in] rng_clo CL_Ops RNG object.
+ * @param[in] params Simulation parameters.
+ * @param[in] gws Kernel global work sizes.
+ * @param[in] lws Kernel local work sizes.
+ * @param[out] err Return location for a GError.
+ * */
+static void ppg_agents_limit_set(cl_ulong max_alloc, CloRng * rng_clo,
+	PPParameters params, PPGGlobalWorkSizes gws, PPGLocalWorkSizes lws,
+	GError ** err) {
+
+	/* Bytes per agent slot in the largest per-slot buffer. Scan buffers
+	 * hold a cl_uint per slot, which is never larger than an agent. */
+	size_t seed_bytes = clo_rng_get_size(rng_clo)
+		/ MAX(gws.init_agent, ppg_cell_slots(params));
+	size_t slot_bytes = MAX(agent_size_bytes, seed_bytes);
+	size_t slots = (size_t) MIN(max_alloc / slot_bytes, G_MAXSIZE);
+
+	/* Leave room for scan buffers being rounded up to the sort local work
+	 * size, and keep the capacity a multiple of the init local work
+	 * size. */
+	slots = slots > lws.sort_agent + 1 ? slots - lws.sort_agent - 1 : 0;
+	agents_capacity_max = (slots / lws.init_agent) * lws.init_agent;
+
+	g_if_err_create_goto(*err, PP_ERROR,
+		(agents_capacity_max <= lws.max_lws)
+		|| (gws.init_agent > agents_capacity_max),
+		PP_OUT_OF_RESOURCES, error_handler,
+		"Initial agents do not fit in a device memory allocation.");
+
+	/* Agents required beyond the limit must not need a larger buffer. */
+	if ((args.max_agents == 0)
+			|| ((size_t) args.max_agents + lws.max_lws
+				> agents_capacity_max))
+		args.max_agents = (cl_uint) MIN(agents_capacity_max - lws.max_lws,
+			(size_t) G_MAXINT);
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+
+finish:
+
+	/* Return. */
+	return;
+
+}
+
+/**
+ * Resize the agents buffer and the RNG seeds, if the required agent slots
+ * are about to exceed its capacity, or if they take less than a quarter
+ * of it. The alive agents and their seeds are copied to the new buffers,
+ * and slots added to the agents buffer are marked as dead. The spare
+ * agents buffer of the counting sort, if any, is replaced by an all dead
+ * buffer of the same capacity, and so are the per-slot buffers of the
+ * incremental counting sort.
+ *
+ * @param[in] ctx Context wrapper.
+ * @param[in] cq Command queue where agents are handled.
+ * @param[in] krnls OpenCL kernels.
+ * @param[in] params Simulation parameters.
+ * @param[in] lws Kernel local work sizes.
+ * @param[in] required Number of agent slots required by the current
+ * iteration.
+ * @param[in,out] capacity Capacity of the agents buffer, in agents.
+ * @param[in,out] num_stale Number of slots of the spare agents buffer
+ * which may hold stale agents, reset if the buffer is replaced.
+ * @param[in,out] rng_clo CL_Ops RNG object.
+ * @param[in,out] buffersDevice Device data buffers.
+ * @param[in,out] dataSizes Size of data buffers.
+ * @param[out] err Return location for a GError.
+ * */
+static void ppg_agents_resize(CCLContext * ctx, CCLQueue * cq,
+	PPGKernels krnls, PPParameters params, PPGLocalWorkSizes lws,
+	size_t required, size_t * capacity, size_t * num_stale,
+	CloRng ** rng_clo, PPGBuffersDevice * buffersDevice,
+	PPGDataSizes * dataSizes, GError ** err) {
+
+	/* New agents buffers and RNG object. */
+	CCLBuffer * agents_data = NULL;
+	CCLBuffer * agents_data_swap = NULL;
+	CCLBuffer * slots_scan = NULL;
+	CCLBuffer * slots_scan_sums = NULL;
+
+	/* Sizes of new per-slot buffers of the incremental counting sort. */
+	PPGDataSizes slots_sizes;
+	CloRng * rng_clo_new = NULL;
+
+	/* New capacity and sizes. */
+	size_t capacity_new, agents_data_size, rng_seeds_size;
+
+	/* Pattern with which to mark added agent slots as dead. */
+	cl_uchar dead = PPG_AGENT_DEAD;
+
+	/* Event wrapper. */
+	CCLEvent * evt = NULL;
+
+	/* Internal error handling object. */
+	GError * err_internal = NULL;
+
+	/* Leave buffers as they are while the required slots fit in them and
+	 * take at least a quarter of them. */
+	if ((required + lws.max_lws <= *capacity)
+			&& (4 * (required + lws.max_lws) >= *capacity))
+		goto finish;
+
+	capacity_new = ppg_agents_capacity(required, lws);
+	if (capacity_new == *capacity) goto finish;
+	agents_data_size = capacity_new * agent_size_bytes;
+
+	/* Create new agents buffer and copy agents into it. Agents beyond
+	 * the required slots are dead. */
+	agents_data = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+		agents_data_size, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	evt = ccl_buffer_enqueue_copy(buffersDevice->agents_data, agents_data,
+		cq, 0, 0, MIN(dataSizes->agents_data, agents_data_size), NULL,
+		&err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Copy: agents");
+
+	/* Mark added slots as dead. */
+	if (agents_data_size > dataSizes->agents_data) {
+		evt = ccl_buffer_enqueue_fill(agents_data, cq, &dead,
+			sizeof(cl_uchar), dataSizes->agents_data,
+			agents_data_size - dataSizes->agents_data, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Fill: dead agents");
+	}
+
+	/* Create new, all dead, spare agents buffer for the counting sort. */
+	if (buffersDevice->agents_data_swap) {
+
+		agents_data_swap = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+			agents_data_size, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		evt = ccl_buffer_enqueue_fill(agents_data_swap, cq, &dead,
+			sizeof(cl_uchar), 0, agents_data_size, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Fill: dead agents");
+	}
+
+	/* Create new per-slot buffers for the incremental counting sort,
+	 * whose contents only last during each sort. */
+	if (buffersDevice->slots_scan) {
+
+		ppg_slots_scan_datasizes(capacity_new, lws, &slots_sizes);
+
+		slots_scan = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+			slots_sizes.slots_scan, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		slots_scan_sums = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+			slots_sizes.slots_scan_sums, NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
+
+	/* Create new RNG object with one seed per agent slot, and copy the
+	 * current state of existing seeds into it. Added seeds are the ones
+	 * the RNG would have initially produced for their slots. */
+	rng_clo_new = clo_rng_new(args_alg.rng, CLO_RNG_SEED_HOST_MT, NULL,
+		MAX(capacity_new, ppg_cell_slots(params)), args.rng_seed, NULL,
+		ctx, cq, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	rng_seeds_size = clo_rng_get_size(rng_clo_new);
+
+	evt = ccl_buffer_enqueue_copy(buffersDevice->rng_seeds,
+		clo_rng_get_device_seeds(rng_clo_new), cq, 0, 0,
+		MIN(dataSizes->rng_seeds, rng_seeds_size), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Copy: rng seeds");
+
+	/* Replace old buffers. Pending commands keep them alive until they
+	 * complete. */
+	ccl_buffer_destroy(buffersDevice->agents_data);
+	clo_rng_destroy(*rng_clo);
+	buffersDevice->agents_data = agents_data;
+	buffersDevice->rng_seeds = clo_rng_get_device_seeds(rng_clo_new);
+	*rng_clo = rng_clo_new;
+	dataSizes->agents_data = agents_data_size;
+	dataSizes->rng_seeds = rng_seeds_size;
+	*capacity = capacity_new;
+	agents_data = NULL;
+	rng_clo_new = NULL;
+	if (agents_data_swap) {
+		ccl_buffer_destroy(buffersDevice->agents_data_swap);
+		buffersDevice->agents_data_swap = agents_data_swap;
+		agents_data_swap = NULL;
+		*num_stale = 0;
+	}
+	if (slots_scan) {
+		ccl_buffer_destroy(buffersDevice->slots_scan);
+		ccl_buffer_destroy(buffersDevice->slots_scan_sums);
+		buffersDevice->slots_scan = slots_scan;
+		buffersDevice->slots_scan_sums = slots_scan_sums;
+		dataSizes->slots_scan = slots_sizes.slots_scan;
+		dataSizes->slots_scan_sums = slots_sizes.slots_scan_sums;
+		slots_scan = NULL;
+		slots_scan_sums = NULL;
+	}
+
+	/* Update arguments of the simulation loop kernels which refer to the
+	 * replaced buffers. */
+	ppg_agents_kernelargs_update(krnls, buffersDevice);
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+	if (agents_data) ccl_buffer_destroy(agents_data);
+	if (agents_data_swap) ccl_buffer_destroy(agents_data_swap);
+	if (slots_scan) ccl_buffer_destroy(slots_scan);
+	if (slots_scan_sums) ccl_buffer_destroy(slots_scan_sums);
+	if (rng_clo_new) clo_rng_destroy(rng_clo_new);
+
+finish:
+
+	/* Return. */
+	return;
+
+}
+
+/**
+ * Wait for the pending read of a batch of statistics, if any, and copy the
+ * statistics from the staging buffer into the host statistics array.
+ *
+ * @param[in,out] batch Batch of statistics, left with no pending read.
+ * @param[out] stats_host Host statistics array.
+ * @param[out] err Return location for a GError.
+ * */
+static void ppg_stats_collect(PPGStatsBatch * batch,
+	PPStatistics * stats_host, GError ** err) {
+
+	/* Event wait list. */
+	CCLEventWaitList ewl = NULL;
+
+	/* Internal error handling object. */
+	GError * err_internal = NULL;
+
+	if (batch->evt == NULL) goto finish;
+
+	ccl_event_wait(ccl_ewl(&ewl, batch->evt, NULL), &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	memcpy(&stats_host[batch->first], batch->staging,
+		batch->count * sizeof(PPStatistics));
+	batch->evt = NULL;
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+
+finish:
+
+	/* Return. */
+	return;
+
+}
+
+/**
+ * Read the statistics of a batch of iterations from the device statistics
+ * ring into the given half of the pinned staging buffer, after collecting
+ * the batch previously read into it. The batch must not wrap around the
+ * ring.
+ *
+ * @param[in] cq Command queue where statistics are read.
+ * @param[in] stats_ring Device statistics ring.
+ * @param[in,out] batch Batch of statistics, i.e. half of the staging
+ * buffer, to read into.
+ * @param[in] first First iteration to read.
+ * @param[in] last Last iteration to read.
+ * @param[in] ewl Commands to wait on before reading.
+ * @param[out] stats_host Host statistics array.
+ * @param[out] err Return location for a GError.
+ * @return Event associated with the read.
+ * */
+static CCLEvent * ppg_stats_read(CCLQueue * cq, CCLBuffer * stats_ring,
+	PPGStatsBatch * batch, cl_uint first, cl_uint last,
+	CCLEventWaitList * ewl, PPStatistics * stats_host, GError ** err) {
+
+	/* Internal error handling object. */
+	GError * err_internal = NULL;
+
+	/* The batch previously read into this half is no longer required. */
+	ppg_stats_collect(batch, stats_host, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	batch->first = first;
+	batch->count = last - first + 1;
+	batch->evt = ccl_buffer_enqueue_read(stats_ring, cq, CL_FALSE,
+		(first % args.stats_ring) * sizeof(PPStatistics),
+		batch->count * sizeof(PPStatistics), batch->staging, ewl,
+		&err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(batch->evt, "Read: stats");
+
+	/* If we got here, everything is OK. */
+	g_assert(*err == NULL);
+	goto finish;
+
+error_handler:
+	/* If we got here there was an error, verify that it is so. */
+	g_assert(*err != NULL);
+
+finish:
+
+	/* Return read event. */
+	return batch->evt;
+
+}
+
 /**
  * Perform Predator-Prey simulation.
  *
  * @param params Simulation parameters.
+ * @param ctx Context wrapper.
  * @param zone OpenCL zone.
  * @param gws Kernels global work sizes.
  * @param lws Kernels local work sizes.
@@ -565,26 +1719,50 @@ finish:
  * @param evts OpenCL events.
  * @param dataSizes Size of data buffers.
  * @param buffersHost Host data buffers.
- * @param buffersDevice Device data buffers.
+ * @param rng_clo CL_Ops RNG object, replaced if the agents buffer is
+ * resized.
+ * @param buffersDevice Device data buffers, the agents buffer and RNG
+ * seeds are replaced if the agents buffer is resized.
  * @param err GLib error object for error reporting.
  * @return @link pp_error_codes::PP_SUCCESS @endlink if function
  * terminates successfully, or an error code otherwise.
  * */
-static void ppg_simulate(PPGKernels krnls, CCLQueue * cq1, CCLQueue * cq2,
-	CloSort * sorter, PPParameters params, PPGGlobalWorkSizes gws,
-	PPGLocalWorkSizes lws, PPGDataSizes dataSizes,
-	PPStatistics * stats_host, PPGBuffersDevice buffersDevice,
-	GError ** err) {
-
-	/* Stats. */
-	PPStatistics * stats_pinned = NULL;
+static void ppg_simulate(PPGKernels krnls, CCLContext * ctx,
+	CCLQueue * cq1, CCLQueue * cq2, CloSort * sorter,
+	PPParameters params, PPGGlobalWorkSizes gws, PPGLocalWorkSizes lws,
+	PPGDataSizes dataSizes, PPStatistics * stats_host, CloRng ** rng_clo,
+	PPGBuffersDevice * buffersDevice, GError ** err) {
 
 	/* Event wrappers. */
 	CCLEvent * evt = NULL;
 	CCLEvent * evt_action_agent = NULL;
 	CCLEvent * evt_read_stats = NULL;
 	CCLEvent * evt_reduce_grass2 = NULL;
-	CCLEvent * evt_sort = NULL;
+	CCLEvent * evt_grass = NULL;
+
+	/* Number of alive agents after compaction in the last iterations,
+	 * and events of their reads, in a ring of run_ahead + 1 entries. */
+	cl_uint ring_size = args.run_ahead + 1, ring_idx;
+	cl_uint * agents_alive = g_new0(cl_uint, ring_size);
+	CCLEvent ** evts_agents_alive = g_new0(CCLEvent *, ring_size);
+
+	/* Pinned staging buffer of statistics, and batches of iterations read
+	 * into each of its halves. */
+	PPStatistics * stats_staging = NULL;
+	PPGStatsBatch stats_batches[2] =
+		{{NULL, 0, 0, NULL}, {NULL, 0, 0, NULL}};
+
+	/* Number of batches of statistics read so far, and first iteration of
+	 * the next batch. */
+	cl_uint stats_num_batches = 0, stats_first = 0;
+
+	/* Are statistics read back in every iteration? Without agent
+	 * compaction, the host requires them to bound the agents. */
+#ifdef PPG_DEBUG
+	gboolean stats_on_demand = TRUE;
+#else
+	gboolean stats_on_demand = (sorter != NULL);
+#endif
 
 	/* Event wait list. */
 	CCLEventWaitList ewl = NULL;
@@ -596,25 +1774,104 @@ static void ppg_simulate(PPGKernels krnls, CCLQueue * cq1, CCLQueue * cq2,
 	cl_uint max_agents_iter =
 		MAX(params.init_sheep + params.init_wolves, PPG_MIN_AGENTS);
 
+	/* Agent slots required by the current iteration, and capacity of the
+	 * agents buffer. */
+	size_t agents_required, agents_capacity = gws.init_agent;
+
+	/* Slots of the spare agents buffer of the counting sort which may hold
+	 * stale agents. */
+	size_t agents_stale = 0;
+
 	/* Dynamic worksizes. */
-	size_t gws_reduce_agent1, ws_reduce_agent2, wg_reduce_agent1,
-		gws_move_agent, gws_find_cell_idx, gws_action_agent;
+	size_t gws_move_agent, gws_find_cell_idx, gws_action_agent;
+
+	/* Work size of the incremental grass statistics kernel. */
+	size_t ws_grass_stats = 1;
+
+	/* Are grass statistics derived incrementally in current iteration? */
+	gboolean grass_stats_inc;
+
+	/* Value with which to initialize incremental grass statistics. */
+	cl_uint zero = 0;
 
-	/* Current iteration. */
-	cl_uint iter = 0;
+	/* Pattern with which to mark agent slots as dead. */
+	cl_uchar dead = PPG_AGENT_DEAD;
 
-	/* Map stats to host. */
+	/* Current iteration, and the iteration in which agents act. */
+	cl_uint iter = 0, iter_action;
+
+	/* Map pinned staging buffer of statistics to host. */
 	g_debug("Mapping stats to host...");
-	stats_pinned = ccl_buffer_enqueue_map(buffersDevice.stats, cq2,
-		CL_FALSE, CL_MAP_READ, 0, sizeof(PPStatistics), NULL, &evt,
-		&err_internal);
+	stats_staging = ccl_buffer_enqueue_map(buffersDevice->stats_staging,
+		cq2, CL_FALSE, CL_MAP_READ, 0, 2 * dataSizes.stats_ring, NULL,
+		&evt, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 	ccl_event_set_name(evt, "Map: stats to host");
+	stats_batches[0].staging = stats_staging;
+	stats_batches[1].staging = stats_staging + args.stats_ring;
 
-#ifdef PPG_DEBUG
-	ccl_queue_finish(cq2, &err_internal);
+	/* Agents are initially the only agent slots. */
+	evt = ccl_buffer_enqueue_fill(buffersDevice->agents_num, cq2,
+		&max_agents_iter, sizeof(cl_uint), 0, sizeof(cl_uint), NULL,
+		&err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
-#endif
+	ccl_event_set_name(evt, "Fill: agent slots");
+
+	/* Clear grass regrowth histogram, filled by cell initialization, and
+	 * eaten grass counter. */
+	evt = ccl_buffer_enqueue_fill(buffersDevice->grass_regrow, cq1, &zero,
+		sizeof(cl_uint), 0, dataSizes.grass_regrow, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Fill: grass regrow");
+
+	evt = ccl_buffer_enqueue_fill(buffersDevice->grass_eaten, cq1, &zero,
+		sizeof(cl_uint), 0, sizeof(cl_uint), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	ccl_event_set_name(evt, "Fill: grass eaten");
+
+	/* With the fused pipeline, no cell has been tagged with an agent index
+	 * (agent actions take place from iteration 1 onwards). */
+	if (ppg_pipeline_is_fused()) {
+		evt = ccl_buffer_enqueue_fill(buffersDevice->cells_agents_epoch,
+			cq2, &zero, sizeof(cl_uint), 0, dataSizes.cells_agents_epoch,
+			NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Fill: cells epoch");
+	}
+
+	/* Counting sort starts with no agents in cells and an all dead spare
+	 * agents buffer. */
+	if (sorter == NULL) {
+
+		evt = ccl_buffer_enqueue_fill(buffersDevice->sort_cell_count, cq2,
+			&zero, sizeof(cl_uint), 0, dataSizes.sort_cell_count, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Fill: sort cell count");
+
+		/* No cell layout of a previous sort, so no agent stays in
+		 * place in the first incremental sort. */
+		if (ppg_sort_is_inc()) {
+
+			evt = ccl_buffer_enqueue_fill(buffersDevice->sort_cells,
+				cq2, &zero, sizeof(cl_uint), 0, dataSizes.sort_cells,
+				NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "Fill: sort cells");
+
+			evt = ccl_buffer_enqueue_fill(buffersDevice->sort_blocks,
+				cq2, &zero, sizeof(cl_uint), 0, dataSizes.sort_blocks,
+				NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "Fill: sort blocks");
+		}
+
+		evt = ccl_buffer_enqueue_fill(buffersDevice->agents_data_swap,
+			cq2, &dead, sizeof(cl_uchar), 0, dataSizes.agents_data, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		ccl_event_set_name(evt, "Fill: dead agents");
+	}
 
 	/* Init. cells */
 	g_debug("Initializing cells...");
@@ -652,16 +1909,11 @@ static void ppg_simulate(PPGKernels krnls, CCLQueue * cq1, CCLQueue * cq2,
 	cl_uint *cells_grass =
 		(cl_uint*) malloc(dataSizes.cells_grass);
 
-	ppg_dump(-1, PPG_DUMP, cq1, fp_agent_dump, fp_cell_dump, 0, 0, 0, 0,
-		params, dataSizes, buffersDevice, agents_data,
+	ppg_dump(-1, PPG_DUMP, cq1, fp_agent_dump, fp_cell_dump, 0, 0, 0,
+		params, dataSizes, *buffersDevice, agents_data,
 		cells_agents_index, cells_grass, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
-#else
-
-	/* Ignore compiler warnings. */
-	(void)dataSizes;
-
 #endif
 
 
@@ -674,100 +1926,148 @@ static void ppg_simulate(PPGKernels krnls, CCLQueue * cq1, CCLQueue * cq2,
 		/* ********* Step 4: Gather stats ********** */
 		/* ***************************************** */
 
-		/* Step 4.1: Perform grass reduction, part I. Wait on agent
-		 * actions from previous iteration. */
-		g_debug("Iter %d: Performing grass reduction, part I...", iter);
-		if (evt_action_agent != NULL)
-			ccl_event_wait_list_add(&ewl, evt_action_agent, NULL);
-		evt = ccl_kernel_enqueue_ndrange(krnls.reduce_grass1, cq1, 1,
-			NULL, &(gws.reduce_grass1), &(lws.reduce_grass1), &ewl,
-			&err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
-		ccl_event_set_name(evt, "K: reduce grass 1");
+		/* Grass statistics are reduced from all cells in the first
+		 * iteration, and derived incrementally afterwards if so
+		 * specified. */
+		grass_stats_inc = (iter > 0) && ppg_grass_stats_is_inc();
+
+		/* Step 4.1: Perform grass reduction, part I. Wait on agent
+		 * actions from previous iteration. */
+		if (!grass_stats_inc) {
+			g_debug("Iter %d: Performing grass reduction, part I...",
+				iter);
+			if (evt_action_agent != NULL)
+				ccl_event_wait_list_add(&ewl, evt_action_agent, NULL);
+			ccl_kernel_set_arg(krnls.reduce_grass1, 3,
+				ccl_arg_priv(iter, cl_uint));
+			evt = ccl_kernel_enqueue_ndrange(krnls.reduce_grass1, cq1, 1,
+				NULL, &(gws.reduce_grass1), &(lws.reduce_grass1), &ewl,
+				&err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "K: reduce grass 1");
 
 #ifdef PPG_DEBUG
-		ccl_queue_finish(cq1, &err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_queue_finish(cq1, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
 #endif
+		}
 
-		/* Step 4.2: Perform agents reduction, part I. */
-
-		/* Determine worksizes. */
-		/* See comment for grass reduction gws for an explanation the
-		 * formulas bellow. */
-		gws_reduce_agent1 = MIN(
-			lws.reduce_agent1 * lws.reduce_agent1, /* lws * number_of_workgroups */
-			CLO_GWS_MULT(
-				CLO_DIV_CEIL(max_agents_iter, args_vw.reduce_agent),
-				lws.reduce_agent1
-			)
-		);
-
-		/* The local/global worksize of reduce_agent2 must be a power of
-		 * 2 for the same reason of reduce_grass2. */
-		wg_reduce_agent1 = gws_reduce_agent1 / lws.reduce_agent1;
-		ws_reduce_agent2 = clo_nlpo2(wg_reduce_agent1);
-
-		/* Set variable kernel arguments in agent reduction kernels. */
-		ccl_kernel_set_arg(krnls.reduce_agent1, 3,
-			ccl_arg_priv(max_agents_iter, cl_uint));
+		/* Step 4.2: Move agents, which also gathers agent statistics
+		 * before movement, i.e. after agent actions of previous
+		 * iteration. Agent statistics are reset by the agent
+		 * initialization and actions kernels, after stats from the
+		 * previous iteration are read, as all of them run in the same
+		 * queue. In the last iteration, agents are only moved in order
+		 * to gather their statistics. */
+
+		/* If agents are compacted after agent actions, the agents there
+		 * can be in the current iteration are also bounded by the alive
+		 * agents read run_ahead iterations ago, which at most double in
+		 * each iteration. The host only waits on that read, so it keeps
+		 * run_ahead iterations enqueued ahead of the device. Kernels
+		 * read the exact number of agent slots on the device. */
+		if ((sorter == NULL) && (iter > args.run_ahead)) {
+			ring_idx = (iter - 1 - args.run_ahead) % ring_size;
+			ccl_event_wait(ccl_ewl(&ewl, evts_agents_alive[ring_idx],
+				NULL), &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			max_agents_iter = MIN(max_agents_iter, MAX(PPG_MIN_AGENTS,
+				(size_t) agents_alive[ring_idx] << args.run_ahead));
+		}
 
-		ccl_kernel_set_arg(krnls.reduce_agent2, 3,
-			ccl_arg_priv(wg_reduce_agent1, cl_uint));
+		/* Determine agent movement global worksize. */
+		gws_move_agent = CLO_GWS_MULT(
+			max_agents_iter,
+			lws.move_agent
+		);
 
-		/* Run agent reduction kernel 1. */
-		g_debug("Iter %d: Performing agent reduction, part I...", iter);
-		evt = ccl_kernel_enqueue_ndrange(krnls.reduce_agent1, cq2, 1,
-			NULL, &(gws_reduce_agent1), &(lws.reduce_agent1), NULL,
+		g_debug("Iter %d: Move agents...", iter);
+		ccl_kernel_set_arg(krnls.move_agent, 5,
+			ccl_arg_priv(iter, cl_uint));
+		evt = ccl_kernel_enqueue_ndrange(krnls.move_agent, cq2, 1,
+			NULL, &(gws_move_agent), &(lws.move_agent), NULL,
 			&err_internal);
 		g_if_err_propagate_goto(err, err_internal, error_handler);
-		ccl_event_set_name(evt, "K: reduce agent 1");
+		ccl_event_set_name(evt, "K: move agent");
 
 #ifdef PPG_DEBUG
 		ccl_queue_finish(cq2, &err_internal);
 		g_if_err_propagate_goto(err, err_internal, error_handler);
 #endif
 
-		/* Step 4.3: Perform grass reduction, part II. Wait on read
-		 * stats from previous iteration. */
-		g_debug("Iter %d: Performing grass reduction part II...", iter);
+		/* Step 4.3: Perform grass reduction, part II, or derive grass
+		 * statistics incrementally, in which case agent actions from
+		 * previous iteration must also be waited on. Wait on read
+		 * stats from previous iteration. With the fused pipeline and
+		 * grass countdowns, the grass kernel derives grass statistics
+		 * while regrowing grass. */
 		if (evt_read_stats != NULL)
 			ccl_event_wait_list_add(&ewl, evt_read_stats, NULL);
-		evt_reduce_grass2 = ccl_kernel_enqueue_ndrange(
-			krnls.reduce_grass2, cq1, 1, NULL, &(gws.reduce_grass2),
-			&(lws.reduce_grass2), &ewl, &err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
-		ccl_event_set_name(evt_reduce_grass2, "K: reduce grass 2");
+		if (grass_stats_inc && ppg_pipeline_is_fused()
+			&& !ppg_grass_is_lazy())
+		{
+			g_debug("Iter %d: Running grass kernel...", iter);
+			ccl_event_wait_list_add(&ewl, evt_action_agent, NULL);
+			ccl_kernel_set_arg(krnls.grass, 4,
+				ccl_arg_priv(iter, cl_uint));
+			evt_reduce_grass2 = ccl_kernel_enqueue_ndrange(krnls.grass,
+				cq1, 1, NULL, &(gws.grass), &(lws.grass), &ewl,
+				&err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt_reduce_grass2, "K: grass");
+		} else if (grass_stats_inc) {
+			g_debug("Iter %d: Deriving grass statistics...", iter);
+			ccl_event_wait_list_add(&ewl, evt_action_agent, NULL);
+			ccl_kernel_set_arg(krnls.grass_stats, 3,
+				ccl_arg_priv(iter, cl_uint));
+			evt_reduce_grass2 = ccl_kernel_enqueue_ndrange(
+				krnls.grass_stats, cq1, 1, NULL, &ws_grass_stats,
+				&ws_grass_stats, &ewl, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt_reduce_grass2, "K: grass stats");
+		} else {
+			g_debug("Iter %d: Performing grass reduction part II...",
+				iter);
+			ccl_kernel_set_arg(krnls.reduce_grass2, 3,
+				ccl_arg_priv(iter, cl_uint));
+			evt_reduce_grass2 = ccl_kernel_enqueue_ndrange(
+				krnls.reduce_grass2, cq1, 1, NULL, &(gws.reduce_grass2),
+				&(lws.reduce_grass2), &ewl, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt_reduce_grass2, "K: reduce grass 2");
+		}
+		evt_grass = evt_reduce_grass2;
 
 #ifdef PPG_DEBUG
 		ccl_queue_finish(cq1, &err_internal);
 		g_if_err_propagate_goto(err, err_internal, error_handler);
 #endif
 
-		/* Step 4.4: Perform agents reduction, part II. Wait on read
-		 * stats from previous iteration. */
-		g_debug("Iter %d: Performing agent reduction part II...", iter);
-		if (evt_read_stats != NULL)
-			ccl_event_wait_list_add(&ewl, evt_read_stats, NULL);
-		evt = ccl_kernel_enqueue_ndrange(krnls.reduce_agent2, cq2, 1,
-			NULL, &(ws_reduce_agent2), &(ws_reduce_agent2), &ewl,
-			&err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
-		ccl_event_set_name(evt, "K: reduce agent 2");
-
-#ifdef PPG_DEBUG
-		ccl_queue_finish(cq2, &err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
-#endif
+		/* Step 4.4: Get statistics, in batches of iterations read back
+		 * before the statistics ring wraps around, in the last
+		 * iteration, or on demand. Batches are read alternately into
+		 * each half of the staging buffer, and the host only waits on a
+		 * read when its half is reused. Wait on reduce_grass2 (agent
+		 * movement is in the same queue). */
+		if (stats_on_demand || (iter == params.iters)
+			|| (iter % args.stats_ring == args.stats_ring - 1))
+		{
+			g_debug("Iter %d: Getting statistics...", iter);
+			ccl_event_wait_list_add(&ewl, evt_reduce_grass2, NULL);
+			evt_read_stats = ppg_stats_read(cq2, buffersDevice->stats,
+				&stats_batches[stats_num_batches % 2], stats_first, iter,
+				&ewl, stats_host, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+			if (stats_on_demand) {
+				ppg_stats_collect(&stats_batches[stats_num_batches % 2],
+					stats_host, &err_internal);
+				g_if_err_propagate_goto(err, err_internal, error_handler);
+			}
 
-		/* Step 4.5: Get statistics. Wait on reduce_grass2. */
-		g_debug("Iter %d: Getting statistics...", iter);
-		ccl_event_wait_list_add(&ewl, evt_reduce_grass2, NULL);
-		evt_read_stats = ccl_buffer_enqueue_read(buffersDevice.stats,
-			cq2, CL_FALSE, 0, sizeof(PPStatistics), stats_pinned, &ewl,
-			&err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
-		ccl_event_set_name(evt_read_stats, "Read: stats");
+			stats_num_batches++;
+			stats_first = iter + 1;
+		}
 
 #ifdef PPG_DEBUG
 		ccl_queue_finish(cq2, &err_internal);
@@ -781,75 +2081,111 @@ static void ppg_simulate(PPGKernels krnls, CCLQueue * cq1, CCLQueue * cq2,
 		/* ********* Step 1: Grass growth ********** */
 		/* ***************************************** */
 
-		/* Grass kernel: grow grass, set number of prey to zero */
-		g_debug("Iter %d: Running grass kernel...", iter);
-		evt = ccl_kernel_enqueue_ndrange(krnls.grass, cq1, 1,
-			NULL, &(gws.grass), &(lws.grass), NULL, &err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
-		ccl_event_set_name(evt, "K: grass");
+		/* Grass kernel: grow grass, set number of prey to zero. With
+		 * the fused pipeline, grass is regrown by the grass statistics
+		 * kernels, and cells are not reset, but tagged when their agent
+		 * index is found. */
+		if (!ppg_pipeline_is_fused()) {
+			g_debug("Iter %d: Running grass kernel...", iter);
+			evt_grass = ccl_kernel_enqueue_ndrange(krnls.grass, cq1, 1,
+				NULL, &(gws.grass), &(lws.grass), NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt_grass, "K: grass");
+		}
 
 #ifdef PPG_DEBUG
 		ccl_queue_finish(cq1, &err_internal);
 		g_if_err_propagate_goto(err, err_internal, error_handler);
 #endif
 
-		/* ***************************************** */
-		/* ******** Step 2: Agent movement ********* */
-		/* ***************************************** */
-
-		/* Determine agent movement global worksize. */
-		gws_move_agent = CLO_GWS_MULT(
-			max_agents_iter,
-			lws.move_agent
-		);
-
-		g_debug("Iter %d: Move agents...", iter);
-		evt = ccl_kernel_enqueue_ndrange(krnls.move_agent, cq2, 1,
-			NULL, &(gws_move_agent), &(lws.move_agent), NULL,
-			&err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
-		ccl_event_set_name(evt, "K: move agent");
-
-#ifdef PPG_DEBUG
-		ccl_queue_finish(cq2, &err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
-#endif
-
 		/* ***************************************** */
 		/* ********* Step 3.1: Agent sort ********** */
 		/* ***************************************** */
 
 		g_debug("Iter %d: Sorting agents...", iter);
-		/// @todo We should use a data_out buffer if sorting algorithm
-		/// is not in-place. Also, should we keep this lws.sort_agent,
-		/// or let the sorting algorithm figure it out
-		evt_sort = clo_sort_with_device_data(sorter, cq2, cq2,
-			buffersDevice.agents_data, NULL, max_agents_iter,
-			lws.sort_agent, &err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
+		if (sorter != NULL) {
+			/// @todo CL_Ops sorters still sort in place; only the
+			/// counting sort below uses the spare agents buffer. Should
+			/// we pass a data_out buffer to CL_Ops sorters which are not
+			/// in-place? Also, should we keep this lws.sort_agent, or
+			/// let the sorting algorithm figure it out
+			clo_sort_with_device_data(sorter, cq2, cq2,
+				buffersDevice->agents_data, NULL, max_agents_iter,
+				lws.sort_agent, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+		} else {
+			/* Counting sort, out-of-place into the spare agents
+			 * buffer. */
+			ppg_sort_count(cq2, krnls, gws, lws,
+				max_agents_iter, &agents_stale, iter, buffersDevice,
+				&err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+		}
 
 #ifdef PPG_DEBUG
 		ccl_queue_finish(cq2, &err_internal);
 		g_if_err_propagate_goto(err, err_internal, error_handler);
 #endif
 
-		/* Determine the maximum number of agents there can be in the
-		 * next iteration. Make sure stats are already transfered back
-		 * to host. */
+		/* Without agent compaction, determine the maximum number of
+		 * agents there can be in the current iteration from the
+		 * statistics, read back on demand, and make it the number of
+		 * agent slots on the device, as the sort packs alive agents at
+		 * the start of the agents buffer. */
+		if (sorter != NULL) {
+
+			max_agents_iter = MAX(PPG_MIN_AGENTS,
+				stats_host[iter].wolves + stats_host[iter].sheep);
+
+			evt = ccl_buffer_enqueue_fill(buffersDevice->agents_num,
+				cq2, &max_agents_iter, sizeof(cl_uint), 0,
+				sizeof(cl_uint), NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "Fill: agent slots");
+		}
 
-		ccl_event_wait(ccl_ewl(&ewl, evt_sort, NULL), &err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
+		/* Determine the agent slots required by all existing and
+		 * possible new agents. If the host runs ahead and they do not
+		 * fit in the agents buffer or in the limit, wait on the alive
+		 * agents read in the previous iteration, which are exact. */
+		agents_required = ppg_agents_required(max_agents_iter);
+		if ((sorter == NULL) && (args.run_ahead > 0) && (iter > 0)
+			&& ((agents_required + lws.max_lws > agents_capacity)
+				|| (agents_required > args.max_agents)))
+		{
+			ring_idx = (iter - 1) % ring_size;
+			ccl_event_wait(ccl_ewl(&ewl, evts_agents_alive[ring_idx],
+				NULL), &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			max_agents_iter = MAX(PPG_MIN_AGENTS, agents_alive[ring_idx]);
+			agents_required = ppg_agents_required(max_agents_iter);
+		}
 
-		memcpy(&stats_host[iter], stats_pinned, sizeof(PPStatistics));
-		max_agents_iter = MAX(PPG_MIN_AGENTS,
-			stats_host[iter].wolves + stats_host[iter].sheep);
+		/* Determine agent actions kernel global worksize. */
+		gws_action_agent = CLO_GWS_MULT(
+			max_agents_iter,
+			lws.action_agent
+		);
 
+		/* Check if the limit allows for all existing and possible new
+		 * agents. */
 		g_if_err_create_goto(*err, PP_ERROR,
-			max_agents_iter > args.max_agents, PP_OUT_OF_RESOURCES,
+			agents_required > args.max_agents, PP_OUT_OF_RESOURCES,
 			error_handler,
 			"Agents required for next iteration above defined limit. " \
 			"Current iter.: %d. Required agents: %d. Agents limit: %d",
-			iter, max_agents_iter, args.max_agents);
+			iter, (int) agents_required, (int) args.max_agents);
+
+		/* Resize agents buffer if required. */
+		ppg_agents_resize(ctx, cq2, krnls, params, lws, agents_required,
+			&agents_capacity, &agents_stale, rng_clo, buffersDevice,
+			&dataSizes, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+#ifdef PPG_DUMP
+		agents_data = (cl_ulong*) realloc(agents_data,
+			dataSizes.agents_data);
+#endif
 
 #ifdef PPG_DEBUG
 		ccl_queue_finish(cq1, &err_internal);
@@ -868,10 +2204,17 @@ static void ppg_simulate(PPGKernels krnls, CCLQueue * cq1, CCLQueue * cq2,
 			lws.find_cell_idx
 		);
 
+		/* With the fused pipeline, cells are tagged with the iteration
+		 * in which agents act, i.e. the next one. Wait on the last grass
+		 * kernel, which regrows grass or resets cells. */
+		iter_action = iter + 1;
 		g_debug("Iter %d: Find cell agent indexes...", iter);
+		if (ppg_pipeline_is_fused())
+			ccl_kernel_set_arg(krnls.find_cell_idx, 4,
+				ccl_arg_priv(iter_action, cl_uint));
 		evt = ccl_kernel_enqueue_ndrange(krnls.find_cell_idx, cq2, 1,
-			NULL, &(gws_find_cell_idx), &(lws.find_cell_idx), NULL,
-			&err_internal);
+			NULL, &(gws_find_cell_idx), &(lws.find_cell_idx),
+			ccl_ewl(&ewl, evt_grass, NULL), &err_internal);
 		g_if_err_propagate_goto(err, err_internal, error_handler);
 		ccl_event_set_name(evt, "K: find cell idx");
 
@@ -884,23 +2227,19 @@ static void ppg_simulate(PPGKernels krnls, CCLQueue * cq1, CCLQueue * cq2,
 		/* ******* Step 3.3: Agent actions ********* */
 		/* ***************************************** */
 
-		/* Determine agent actions kernel global worksize. */
-		gws_action_agent = CLO_GWS_MULT(
-			max_agents_iter,
-			lws.action_agent
-		);
-
-		/* Check if there is enough memory for all possible new
-		 * agents. */
-		g_if_err_create_goto(*err, PP_ERROR,
-			gws_action_agent * 2 > args.max_agents, PP_OUT_OF_RESOURCES,
-			error_handler,
-			"Not enough memory for existing and possible new agents. " \
-			"Current iter.: %d. Total possible agents: %d. Agents limit: %d",
-			iter, (int) gws_action_agent * 2, (int) args.max_agents);
-
-		/* Perform agent actions. */
+		/* Perform agent actions, which take place in the next
+		 * iteration, after grass is regrown, as find_cell_idx waits on
+		 * it. */
 		g_debug("Iter %d: Performing agent actions...", iter);
+		if (ppg_repro_is_append()) {
+			evt = ccl_buffer_enqueue_fill(buffersDevice->births, cq2,
+				&zero, sizeof(cl_uint), 0, sizeof(cl_uint), NULL,
+				&err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "Fill: births");
+		}
+		ccl_kernel_set_arg(krnls.action_agent, 5,
+			ccl_arg_priv(iter_action, cl_uint));
 		evt_action_agent = ccl_kernel_enqueue_ndrange(
 			krnls.action_agent, cq2, 1, NULL, &(gws_action_agent),
 			&(lws.action_agent), NULL, &err_internal);
@@ -917,17 +2256,44 @@ static void ppg_simulate(PPGKernels krnls, CCLQueue * cq1, CCLQueue * cq2,
 				stats_host[iter].wolves);
 #endif
 
-		/* Agent actions may, in the worst case, double the number of
-		 * agents. */
-		max_agents_iter = MAX(max_agents_iter, lws.action_agent) * 2;
+		/* Agent actions may, in the worst case, place a newborn after
+		 * the agent slots for each agent. Without agent compaction, these
+		 * are the agent slots on the device from now on. */
+		max_agents_iter = agents_required;
+		if (sorter != NULL) {
+			evt = ccl_buffer_enqueue_fill(buffersDevice->agents_num, cq2,
+				&max_agents_iter, sizeof(cl_uint), 0, sizeof(cl_uint),
+				NULL, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+			ccl_event_set_name(evt, "Fill: agent slots");
+		}
+
+		/* ***************************************** */
+		/* ****** Step 3.4: Agent compaction ******* */
+		/* ***************************************** */
+
+		/* With the counting sorts, pack alive agents and newborns at
+		 * the start of the agents buffer. */
+		if (sorter == NULL) {
+			g_debug("Iter %d: Compacting agents...", iter);
+			ring_idx = iter % ring_size;
+			evts_agents_alive[ring_idx] = ppg_agents_compact(cq2, krnls,
+				gws, lws, max_agents_iter, &agents_stale,
+				&agents_alive[ring_idx], buffersDevice, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+
+#ifdef PPG_DEBUG
+			ccl_queue_finish(cq2, &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+#endif
+		}
 
 #ifdef PPG_DUMP
 
 		ppg_dump(iter, PPG_DUMP, cq1, fp_agent_dump, fp_cell_dump,
-			max_agents_iter, gws_reduce_agent1, gws_action_agent,
-			gws_move_agent, params, dataSizes, buffersDevice,
-			agents_data, cells_agents_index, cells_grass,
-			&err_internal);
+			max_agents_iter, gws_action_agent, gws_move_agent, params,
+			dataSizes, *buffersDevice, agents_data, cells_agents_index,
+			cells_grass, &err_internal);
 		g_if_err_propagate_goto(err, err_internal, error_handler);
 
 #endif
@@ -947,24 +2313,18 @@ static void ppg_simulate(PPGKernels krnls, CCLQueue * cq1, CCLQueue * cq2,
 
 	/* Post-simulation ops. */
 
-	/* Get last iteration stats. */
-	ccl_event_wait_list_add(&ewl, evt_read_stats, NULL);
-	ccl_event_wait(&ewl, &err_internal);
-	g_if_err_propagate_goto(err, err_internal, error_handler);
-	memcpy(&stats_host[iter], stats_pinned,
-		sizeof(PPStatistics));
+	/* Collect the last batches of stats. */
+	for (cl_uint i = 0; i < 2; i++) {
+		ppg_stats_collect(&stats_batches[i], stats_host, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
 
 	/* Unmap stats. */
-	evt = ccl_buffer_enqueue_unmap(buffersDevice.stats, cq2,
-		stats_pinned, NULL, &err_internal);
+	evt = ccl_buffer_enqueue_unmap(buffersDevice->stats_staging, cq2,
+		stats_staging, NULL, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 	ccl_event_set_name(evt, "Unmap: stats");
 
-#ifdef PPG_DEBUG
-		ccl_queue_finish(cq2, &err_internal);
-		g_if_err_propagate_goto(err, err_internal, error_handler);
-#endif
-
 	/* Guarantee all activity has terminated... */
 	ccl_queue_finish(cq1, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
@@ -979,8 +2339,15 @@ error_handler:
 	/* If we got here there was an error, verify that it is so. */
 	g_assert(*err != NULL);
 
+	/* Reads into the ring of alive agents may still be pending. */
+	ccl_queue_finish(cq2, NULL);
+
 finish:
 
+	/* Release ring of alive agents. */
+	g_free(agents_alive);
+	g_free(evts_agents_alive);
+
 	/* Return. */
 	return;
 
@@ -990,31 +2357,24 @@ finish:
  * Compute worksizes depending on the device type and number of
  * available compute units.
  *
+ * @param dev Device where to perform simulation.
  * @param paramsSim Simulation parameters.
- * @param device Device where to perform simulation.
  * @param gws Kernel global worksizes (to be modified by function).
  * @param lws Kernel local worksizes (to be modified by function).
  * @param err GLib error object for error reporting.
  * @return @link pp_error_codes::PP_SUCCESS @endlink if function
  * terminates successfully, or an error code otherwise.
  * */
-static void ppg_worksizes_compute(CCLProgram* prg,
+static void ppg_worksizes_compute(CCLDevice* dev,
 	PPParameters paramsSim, PPGGlobalWorkSizes *gws,
 	PPGLocalWorkSizes *lws, GError** err) {
 
-	/* Device preferred int and long vector widths. */
-	cl_uint int_vw, long_vw;
-
-	/* Device where the simulation will take place. */
-	CCLDevice* dev = NULL;
+	/* Device preferred int vector width. */
+	cl_uint int_vw;
 
 	/* Internal error handling object. */
 	GError* err_internal = NULL;
 
-	/* Get device where the simulation will take place. */
-	dev = ccl_program_get_device(prg, 0, &err_internal);
-	g_if_err_propagate_goto(err, err_internal, error_handler);
-
 	/* Get the maximum workgroup size for the device. */
 	lws->max_lws = ccl_device_get_info_scalar(
 		dev, CL_DEVICE_MAX_WORK_GROUP_SIZE, size_t, &err_internal);
@@ -1040,11 +2400,6 @@ static void ppg_worksizes_compute(CCLProgram* prg,
 		CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT, cl_uint, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
-	/* Get the device preferred long vector width. */
-	long_vw = ccl_device_get_info_scalar(dev,
-		CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG, cl_uint, &err_internal);
-	g_if_err_propagate_goto(err, err_internal, error_handler);
-
 	/* Determine effective grass kernel vector width. */
 	if (args_vw.grass == 0)
 		args_vw.grass = int_vw;
@@ -1053,27 +2408,19 @@ static void ppg_worksizes_compute(CCLProgram* prg,
 	if (args_vw.reduce_grass == 0)
 		args_vw.reduce_grass = int_vw;
 
-	/* Determine effective reduce agents kernel vector width. */
-	if (args_vw.reduce_agent == 0) {
-		if (args.agent_size == 32)
-			args_vw.reduce_agent = int_vw;
-		else if (args.agent_size == 64)
-			args_vw.reduce_agent = long_vw;
-		else
-			g_assert_not_reached();
-	}
-
 	/* Init cell worksizes. */
 	lws->init_cell = args_lws.init_cell ? args_lws.init_cell : lws->deflt;
-	gws->init_cell = CLO_GWS_MULT(paramsSim.grid_xy, lws->init_cell);
+	gws->init_cell = CLO_GWS_MULT(ppg_cell_slots(paramsSim),
+		lws->init_cell);
 
-	/* Init agent worksizes. */
+	/* Init agent local worksize. Global worksize depends on the initial
+	 * capacity of the agents buffer, determined bellow. */
 	lws->init_agent = args_lws.init_agent ? args_lws.init_agent : lws->deflt;
-	gws->init_agent = CLO_GWS_MULT(args.max_agents, lws->init_agent);
 
 	/* Grass growth worksizes. */
 	lws->grass = args_lws.grass ? args_lws.grass : lws->deflt;
-	gws->grass = CLO_GWS_MULT(paramsSim.grid_xy / args_vw.grass, lws->grass);
+	gws->grass = CLO_GWS_MULT(ppg_cell_slots(paramsSim) / args_vw.grass,
+		lws->grass);
 
 	/* Grass reduce worksizes, must be power of 2 for reduction to work. */
 	lws->reduce_grass1 =
@@ -1098,7 +2445,7 @@ static void ppg_worksizes_compute(CCLProgram* prg,
 	gws->reduce_grass1 = MIN(
 		lws->reduce_grass1 * lws->reduce_grass1, /* lws * number_of_workgroups */
 		CLO_GWS_MULT(
-			CLO_DIV_CEIL(paramsSim.grid_xy, args_vw.reduce_grass),
+			CLO_DIV_CEIL(ppg_cell_slots(paramsSim), args_vw.reduce_grass),
 			lws->reduce_grass1
 		)
 	);
@@ -1109,30 +2456,26 @@ static void ppg_worksizes_compute(CCLProgram* prg,
 	lws->reduce_grass2 = clo_nlpo2(gws->reduce_grass1 / lws->reduce_grass1);
 	gws->reduce_grass2 = lws->reduce_grass2;
 
-	/* Agent reduce worksizes, must be power of 2 for reduction to
-	 * work. */
-	lws->reduce_agent1 =
-		args_lws.reduce_agent ?  args_lws.reduce_agent : lws->deflt;
-	if (!CLO_IS_PO2(lws->reduce_agent1)) {
-		lws->reduce_agent1 =
-			MIN(lws->max_lws, clo_nlpo2(lws->reduce_agent1));
-		fprintf(stderr, "The workgroup size of the agent reduction " \
-			"kernel must be a power of 2. Assuming a workgroup size " \
-			"of %d.\n", (int) lws->reduce_agent1);
-	}
-
-	/* The remaining agent reduction worksizes are determined on the fly
-	 * because the number of agents varies during the simulation. */
-
-	/* Agent movement local worksize. Global worksize depends on the
+	/* Agent movement local worksize, must be power of 2 for the agent
+	 * statistics reduction to work. Global worksize depends on the
 	 * number of existing agents. */
 	lws->move_agent = args_lws.move_agent ? args_lws.move_agent : lws->deflt;
+	if (!CLO_IS_PO2(lws->move_agent)) {
+		lws->move_agent = MIN(lws->max_lws, clo_nlpo2(lws->move_agent));
+		fprintf(stderr, "The workgroup size of the agent movement " \
+			"kernel must be a power of 2. Assuming a workgroup size " \
+			"of %d.\n", (int) lws->move_agent);
+	}
 
 	/* Agent sort local worksize. Global worksize depends on the
 	 * number of existing agents. */
 	lws->sort_agent =
 		args_lws.sort_agent ? args_lws.sort_agent : lws->deflt;
 
+	/* Counting sort scan global worksize, one work-item per cell. */
+	gws->sort_scan = CLO_GWS_MULT(ppg_sort_keys(paramsSim),
+		lws->sort_agent);
+
 	/* Find cell agent index local worksize. Global worksize depends on the
 	 * number of existing agents. */
 	lws->find_cell_idx =
@@ -1143,6 +2486,13 @@ static void ppg_worksizes_compute(CCLProgram* prg,
 	lws->action_agent =
 		args_lws.action_agent ? args_lws.action_agent : lws->deflt;
 
+	/* Init agent global worksize, i.e. the initial capacity of the agents
+	 * buffer, which must hold the agents required by the first
+	 * iteration. */
+	gws->init_agent = ppg_agents_capacity(ppg_agents_required(
+		MAX(paramsSim.init_sheep + paramsSim.init_wolves, PPG_MIN_AGENTS)),
+		*lws);
+
 	/* If we got here, everything is OK. */
 	g_assert(*err == NULL);
 	goto finish;
@@ -1173,20 +2523,50 @@ static void ppg_info_print(PPGGlobalWorkSizes gws,
 	GError* err_internal = NULL;
 
 	/* Determine total global memory. */
-	size_t dev_mem = sizeof(PPStatistics) +
+	size_t dev_mem = dataSizes.stats_ring +
 		dataSizes.cells_grass +
 		dataSizes.cells_agents_index +
+		dataSizes.cells_agents_epoch +
 		dataSizes.agents_data +
 		dataSizes.reduce_grass_global +
-		dataSizes.reduce_agent_global +
+		dataSizes.grass_regrow + sizeof(cl_uint) +
 		dataSizes.rng_seeds;
 
+	/* Newborns counter. */
+	if (ppg_repro_is_append())
+		dev_mem += sizeof(cl_uint);
+
+	/* Number of agent slots. */
+	dev_mem += sizeof(cl_uint);
+
+	/* Counting sort buffers. */
+	if (sorter == NULL)
+		dev_mem += dataSizes.agents_data + dataSizes.sort_cell_count +
+			dataSizes.sort_cells + dataSizes.sort_blocks;
+	if (sorter == NULL)
+		dev_mem += dataSizes.slots_scan + dataSizes.slots_scan_sums;
+	if (ppg_sort_is_inc())
+		dev_mem += dataSizes.sort_stay;
+
 	/* Print info. */
 	/// @todo Make ints unsigned or change %d to something nice for size_t
 	printf("\n   =========================== Simulation Info =============================\n\n");
 	printf("     Required global memory    : %d bytes (%d Kb = %d Mb)\n",
 		(int) dev_mem, (int) dev_mem / 1024, (int) dev_mem / 1024 / 1024);
 	printf("     Compiler options          : %s\n", compilerOpts);
+	printf("     Grass representation      : %s\n", args.grass);
+	printf("     Grass statistics          : %s\n", args.grass_stats);
+	printf("     Reproduction              : %s\n", args_alg.repro);
+	printf("     Pipeline                  : %s\n", args_alg.pipeline);
+	printf("     Order in cells            : %s\n", args_alg.order);
+	printf("     Conflict resolution       : %s\n", args_alg.resolve);
+	printf("     Cell layout               : %s (%zu slots)\n",
+		args_alg.cells, dataSizes.cells_agents_index / sizeof(cl_uint2));
+	if (sorter == NULL)
+		printf("     Run ahead                 : %u iterations\n",
+			args.run_ahead);
+	printf("     Statistics ring           : %u iterations\n",
+		args.stats_ring);
 	printf("     Kernel work sizes and local memory requirements:\n");
 	printf("       -------------------------------------------------------------------\n");
 	printf("       | Kernel             | GWS      | LWS   | Local mem. | VW x bytes |\n");
@@ -1204,16 +2584,30 @@ static void ppg_info_print(PPGGlobalWorkSizes gws,
 	printf("       | reduce_grass2      | %8zu | %5zu | %10zu |     %2d x %zu |\n",
 		gws.reduce_grass2, lws.reduce_grass2, dataSizes.reduce_grass_local2,
 		args_vw.reduce_grass, sizeof(cl_uint));
-	printf("       | reduce_agent1      |     Var. | %5zu | %10zu |     %2d x %zu |\n",
-		lws.reduce_agent1, dataSizes.reduce_agent_local1, args_vw.reduce_agent,
-		agent_size_bytes);
-	printf("       | reduce_agent2      |     Var. |  Var. | %10zu |     %2d x %zu |\n",
-		dataSizes.reduce_agent_local2, args_vw.reduce_agent, agent_size_bytes);
-	printf("       | move_agent         |     Var. | %5zu |          0 |          0 |\n",
-		lws.move_agent);
+	printf("       | move_agent         |     Var. | %5zu | %10zu |          0 |\n",
+		lws.move_agent, dataSizes.move_agent_local);
+
+	/* Show information for counting sort kernels. */
+	if (sorter == NULL) {
+		printf("       | sort_count         |     Var. | %5zu |          0 |          0 |\n",
+			lws.sort_agent);
+		printf("       | sort_scan          | %8zu | %5zu | %10zu |          0 |\n",
+			gws.sort_scan, lws.sort_agent, dataSizes.sort_scan_local);
+		printf("       | scan_blocks        | %8zu | %5zu | %10zu |          0 |\n",
+			lws.sort_agent, lws.sort_agent, dataSizes.sort_scan_local);
+		printf("       | sort_scatter       |     Var. | %5zu |          0 |          0 |\n",
+			lws.sort_agent);
+		if (ppg_resolve_is_ranked())
+			printf("       | sort_order         | %8zu | %5zu |          0 |          0 |\n",
+				gws.sort_scan, lws.sort_agent);
+		printf("       | compact_scan       |     Var. | %5zu | %10zu |          0 |\n",
+			lws.sort_agent, dataSizes.sort_scan_local);
+		printf("       | compact_scatter    |     Var. | %5zu |          0 |          0 |\n",
+			lws.sort_agent);
+	}
 
 	/* Get number of sort kernels. */
-	cl_uint num_sort_kernels =
+	cl_uint num_sort_kernels = (sorter == NULL) ? 0 :
 		clo_sort_get_num_kernels(sorter, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
@@ -1231,8 +2625,8 @@ static void ppg_info_print(PPGGlobalWorkSizes gws,
 
 	printf("       | find_cell_idx      |     Var. | %5zu |          0 |          0 |\n",
 		lws.find_cell_idx);
-	printf("       | action_agent       |     Var. | %5zu |          0 |          0 |\n",
-		lws.action_agent);
+	printf("       | action_agent       |     Var. | %5zu | %10zu |          0 |\n",
+		lws.action_agent, dataSizes.action_agent_local);
 	printf("       -------------------------------------------------------------------\n");
 
 	/* If we got here, everything is OK. */
@@ -1276,12 +2670,6 @@ static void ppg_kernels_get(CCLProgram* prg, PPGKernels* krnls,
 	krnls->reduce_grass2 = ccl_program_get_kernel(
 		prg, "reduce_grass2", &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
-	krnls->reduce_agent1 = ccl_program_get_kernel(
-		prg, "reduce_agent1", &err_internal);
-	g_if_err_propagate_goto(err, err_internal, error_handler);
-	krnls->reduce_agent2 = ccl_program_get_kernel(
-		prg, "reduce_agent2", &err_internal);
-	g_if_err_propagate_goto(err, err_internal, error_handler);
 	krnls->grass = ccl_program_get_kernel(
 		prg, "grass", &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
@@ -1294,6 +2682,39 @@ static void ppg_kernels_get(CCLProgram* prg, PPGKernels* krnls,
 	krnls->action_agent = ccl_program_get_kernel(
 		prg, "action_agent", &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
+	krnls->grass_stats = ccl_program_get_kernel(
+		prg, "grass_stats", &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+	if (ppg_sort_is_count()) {
+		krnls->sort_count = ccl_program_get_kernel(
+			prg, "sort_count", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		krnls->sort_scan = ccl_program_get_kernel(
+			prg, "sort_scan", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		krnls->scan_blocks = ccl_program_get_kernel(
+			prg, "scan_blocks", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		krnls->sort_scatter = ccl_program_get_kernel(
+			prg, "sort_scatter", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		if (ppg_resolve_is_ranked()) {
+			krnls->sort_order = ccl_program_get_kernel(
+				prg, "sort_order", &err_internal);
+			g_if_err_propagate_goto(err, err_internal, error_handler);
+		}
+		krnls->compact_scan = ccl_program_get_kernel(
+			prg, "compact_scan", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+		krnls->compact_scatter = ccl_program_get_kernel(
+			prg, "compact_scatter", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
+	if (ppg_sort_is_inc()) {
+		krnls->compact_layout = ccl_program_get_kernel(
+			prg, "compact_layout", &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
 
 	/* If we got here, everything is OK. */
 	g_assert(*err == NULL);
@@ -1315,28 +2736,35 @@ finish:
  * @param[in] krnls Kernel wrappers.
  * @param[in] buffersDevice Device data buffers.
  * @param[in] dataSizes Size of data buffers.
+ * @param[in] gws Global work sizes.
  * @param[in] lws Local work sizes.
- * @param[out] err Return location for a GError.
  * */
 static void ppg_kernelargs_set(PPGKernels krnls,
-	PPGBuffersDevice buffersDevice, PPGDataSizes dataSizes) {
+	PPGBuffersDevice buffersDevice, PPGDataSizes dataSizes,
+	PPGGlobalWorkSizes gws, PPGLocalWorkSizes lws) {
 
 	/* Cell init kernel. */
 	ccl_kernel_set_args(krnls.init_cell, buffersDevice.cells_grass,
-		buffersDevice.rng_seeds, NULL);
+		buffersDevice.rng_seeds, buffersDevice.grass_regrow, NULL);
 
 	/* Agent init kernel. */
 	ccl_kernel_set_args(krnls.init_agent, buffersDevice.agents_data,
-		buffersDevice.rng_seeds, NULL);
-
-	/* Grass kernel */
-	ccl_kernel_set_args(krnls.grass, buffersDevice.cells_grass,
-		buffersDevice.cells_agents_index, NULL);
+		buffersDevice.rng_seeds, buffersDevice.stats, NULL);
+
+	/* Grass kernel, which with the fused pipeline also derives grass
+	 * statistics, in the iteration set on the fly. */
+	if (ppg_pipeline_is_fused())
+		ccl_kernel_set_args(krnls.grass, buffersDevice.cells_grass,
+			buffersDevice.stats, buffersDevice.grass_regrow,
+			buffersDevice.grass_eaten, ccl_arg_skip, NULL);
+	else
+		ccl_kernel_set_args(krnls.grass, buffersDevice.cells_grass,
+			buffersDevice.cells_agents_index, NULL);
 
 	/* reduce_grass1 kernel */
 	ccl_kernel_set_args(krnls.reduce_grass1, buffersDevice.cells_grass,
 		ccl_arg_full(NULL, dataSizes.reduce_grass_local1),
-		buffersDevice.reduce_grass_global, NULL);
+		buffersDevice.reduce_grass_global, ccl_arg_skip, NULL);
 
 	/* reduce_grass2 kernel */
 	ccl_kernel_set_args(krnls.reduce_grass2,
@@ -1344,30 +2772,122 @@ static void ppg_kernelargs_set(PPGKernels krnls,
 		ccl_arg_full(NULL, dataSizes.reduce_grass_local2),
 		buffersDevice.stats, NULL);
 
-	/* reduce_agent1 kernel */
-	ccl_kernel_set_args(krnls.reduce_agent1, buffersDevice.agents_data,
-		ccl_arg_full(NULL, dataSizes.reduce_agent_local1),
-		buffersDevice.reduce_agent_global, NULL);
-	/* The 3rd argument is set on the fly. */
-
-	/* reduce_agent2 kernel */
-	ccl_kernel_set_args(krnls.reduce_agent2,
-		buffersDevice.reduce_agent_global,
-		ccl_arg_full(NULL, dataSizes.reduce_agent_local2),
-		buffersDevice.stats, NULL);
-
 	/* Agent movement kernel. */
 	ccl_kernel_set_args(krnls.move_agent, buffersDevice.agents_data,
-		buffersDevice.rng_seeds, NULL);
-
-	/* Find cell agent index kernel. */
+		buffersDevice.rng_seeds,
+		ccl_arg_full(NULL, dataSizes.move_agent_local),
+		buffersDevice.stats, buffersDevice.agents_num, NULL);
+	if (ppg_sort_count_in_move())
+		ccl_kernel_set_arg(krnls.move_agent, 6,
+			buffersDevice.sort_cell_count);
+
+	/* Find cell agent index kernel, with the fused pipeline the iteration
+	 * with which cells are tagged is set on the fly. */
 	ccl_kernel_set_args(krnls.find_cell_idx, buffersDevice.agents_data,
-		buffersDevice.cells_agents_index, NULL);
+		buffersDevice.cells_agents_index, buffersDevice.agents_num, NULL);
+	if (ppg_pipeline_is_fused())
+		ccl_kernel_set_arg(krnls.find_cell_idx, 3,
+			buffersDevice.cells_agents_epoch);
 
 	/* Agent actions kernel. */
 	ccl_kernel_set_args(krnls.action_agent, buffersDevice.cells_grass,
 		buffersDevice.cells_agents_index, buffersDevice.agents_data,
-		buffersDevice.agents_data, buffersDevice.rng_seeds, NULL);
+		buffersDevice.agents_data, buffersDevice.rng_seeds, ccl_arg_skip,
+		buffersDevice.grass_eaten, buffersDevice.stats,
+		buffersDevice.agents_num, NULL);
+	if (ppg_repro_is_append()) {
+		ccl_kernel_set_arg(krnls.action_agent, 9, buffersDevice.births);
+		ccl_kernel_set_arg(krnls.action_agent, 10,
+			ccl_arg_full(NULL, dataSizes.action_agent_local));
+	}
+	if (ppg_pipeline_is_fused())
+		ccl_kernel_set_arg(krnls.action_agent,
+			ppg_repro_is_append() ? 11 : 9,
+			buffersDevice.cells_agents_epoch);
+
+	/* Incremental grass statistics kernel. */
+	ccl_kernel_set_args(krnls.grass_stats, buffersDevice.stats,
+		buffersDevice.grass_regrow, buffersDevice.grass_eaten,
+		ccl_arg_skip, NULL);
+
+	/* Counting sort kernels, agent buffers, number of agent slots,
+	 * current iteration and buffers scanned by scan_blocks are set on
+	 * the fly. */
+	if (ppg_sort_is_count()) {
+
+		cl_uint block_size = lws.sort_agent;
+		cl_uint num_blocks = gws.sort_scan / lws.sort_agent;
+
+		ccl_kernel_set_args(krnls.sort_count, ccl_arg_skip,
+			buffersDevice.sort_cell_count, buffersDevice.agents_num,
+			NULL);
+
+		ccl_kernel_set_args(krnls.sort_scan,
+			buffersDevice.sort_cell_count, buffersDevice.sort_cells,
+			buffersDevice.sort_blocks,
+			ccl_arg_full(NULL, dataSizes.sort_scan_local), NULL);
+
+		ccl_kernel_set_args(krnls.scan_blocks, ccl_arg_skip,
+			ccl_arg_full(NULL, dataSizes.sort_scan_local), NULL);
+
+		ccl_kernel_set_args(krnls.sort_scatter, ccl_arg_skip,
+			ccl_arg_skip, buffersDevice.sort_cell_count,
+			buffersDevice.sort_cells, buffersDevice.sort_blocks,
+			ccl_arg_priv(block_size, cl_uint),
+			ccl_arg_priv(num_blocks, cl_uint), ccl_arg_skip,
+			ccl_arg_skip, buffersDevice.agents_num, NULL);
+
+		if (ppg_resolve_is_ranked())
+			ccl_kernel_set_args(krnls.sort_order, ccl_arg_skip,
+				buffersDevice.sort_cells, buffersDevice.sort_blocks,
+				ccl_arg_skip, NULL);
+
+		/* Agent compaction kernels, agent buffers and number of agent
+		 * slots and workgroups are set on the fly. */
+		ccl_kernel_set_args(krnls.compact_scan, ccl_arg_skip,
+			buffersDevice.slots_scan, buffersDevice.slots_scan_sums,
+			ccl_arg_full(NULL, dataSizes.sort_scan_local),
+			buffersDevice.agents_num, NULL);
+
+		ccl_kernel_set_args(krnls.compact_scatter, ccl_arg_skip,
+			ccl_arg_skip, buffersDevice.slots_scan,
+			buffersDevice.slots_scan_sums, ccl_arg_skip, ccl_arg_skip,
+			buffersDevice.agents_num, NULL);
+	}
+
+	/* Incremental counting sort kernels. */
+	if (ppg_sort_is_inc()) {
+
+		ccl_kernel_set_args(krnls.compact_layout,
+			buffersDevice.sort_cells, buffersDevice.sort_blocks,
+			buffersDevice.slots_scan, buffersDevice.slots_scan_sums,
+			NULL);
+
+		ccl_kernel_set_args(krnls.sort_count, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_skip, buffersDevice.sort_cells,
+			buffersDevice.sort_blocks,
+			buffersDevice.slots_scan, buffersDevice.slots_scan_sums,
+			ccl_arg_full(NULL, dataSizes.sort_scan_local), NULL);
+
+		ccl_kernel_set_args(krnls.sort_scan, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_skip, ccl_arg_skip, buffersDevice.sort_stay,
+			buffersDevice.slots_scan, buffersDevice.slots_scan_sums,
+			NULL);
+
+		ccl_kernel_set_args(krnls.sort_scatter, ccl_arg_skip,
+			ccl_arg_skip, ccl_arg_skip, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_skip, ccl_arg_skip, ccl_arg_skip, ccl_arg_skip,
+			ccl_arg_skip, buffersDevice.sort_stay,
+			buffersDevice.slots_scan, buffersDevice.slots_scan_sums,
+			NULL);
+
+		if (ppg_resolve_is_ranked())
+			ccl_kernel_set_arg(krnls.sort_order, 4,
+				buffersDevice.sort_stay);
+	}
+
+	/* The current iteration argument of reduce_grass1, reduce_grass2,
+	 * move_agent, action_agent and grass_stats is set on the fly. */
 
 }
 
@@ -1387,17 +2907,21 @@ static void ppg_datasizes_get(PPGDataSizes * dataSizes,
 	/// memory for sorting.
 	(void)sorter;
 
-	/* Statistics */
+	/* Statistics, and device statistics ring. */
 	dataSizes->stats = (params.iters + 1) * sizeof(PPStatistics);
+	dataSizes->stats_ring = args.stats_ring * sizeof(PPStatistics);
 
 	/* Environment cells */
 	dataSizes->cells_grass =
-		pp_next_multiple(params.grid_xy, args_vw.grass)
+		pp_next_multiple(ppg_cell_slots(params), args_vw.grass)
 		* sizeof(cl_uint);
-	dataSizes->cells_agents_index = params.grid_xy * sizeof(cl_uint2);
+	dataSizes->cells_agents_index =
+		ppg_cell_slots(params) * sizeof(cl_uint2);
+	dataSizes->cells_agents_epoch = ppg_pipeline_is_fused()
+		? ppg_cell_slots(params) * sizeof(cl_uint) : 0;
 
 	/* Agents. */
-	dataSizes->agents_data = args.max_agents * agent_size_bytes;
+	dataSizes->agents_data = gws.init_agent * agent_size_bytes;
 
 	/* Grass reduction. */
 	dataSizes->reduce_grass_local1 =
@@ -1407,11 +2931,27 @@ static void ppg_datasizes_get(PPGDataSizes * dataSizes,
 	dataSizes->reduce_grass_local2 =
 		2 * lws.reduce_grass2 * args_vw.reduce_grass * sizeof(cl_uint);
 
-	/* Agent reduction. */
-	dataSizes->reduce_agent_local1 = 4 * lws.reduce_agent1
-		* args_vw.reduce_agent * agent_size_bytes; /* 4x to count sheep pop, wolves pop, sheep en, wolves en. */
-	dataSizes->reduce_agent_global = dataSizes->reduce_agent_local1;
-	dataSizes->reduce_agent_local2 = dataSizes->reduce_agent_local1;
+	/* Agent statistics, gathered by the agent movement kernel (4x to
+	 * count sheep pop, wolves pop, sheep en, wolves en). */
+	dataSizes->move_agent_local = 4 * lws.move_agent * sizeof(cl_uint);
+
+	/* Newborns of each workgroup, staged by the agent actions kernel. */
+	dataSizes->action_agent_local = ppg_repro_is_append()
+		? lws.action_agent * agent_size_bytes : 0;
+
+	/* Grass regrowth histogram, one entry per iteration in a window of
+	 * grass_restart iterations. */
+	dataSizes->grass_regrow = MAX(params.grass_restart, 1) * sizeof(cl_uint);
+
+	/* Counting sort, the workgroup totals are followed by the total
+	 * number of agents. */
+	dataSizes->sort_cell_count = ppg_sort_keys(params) * sizeof(cl_uint);
+	dataSizes->sort_cells = ppg_sort_keys(params) * sizeof(cl_uint2);
+	dataSizes->sort_blocks =
+		(gws.sort_scan / lws.sort_agent + 1) * sizeof(cl_uint);
+	dataSizes->sort_scan_local = lws.sort_agent * sizeof(cl_uint);
+	dataSizes->sort_stay = ppg_sort_keys(params) * sizeof(cl_uint2);
+	ppg_slots_scan_datasizes(gws.init_agent, lws, dataSizes);
 
 	/* RNG */
 	dataSizes->rng_seeds = clo_rng_get_size(rng_clo);
@@ -1435,9 +2975,15 @@ static void ppg_devicebuffers_create(CCLContext* ctx, CloRng* rng_clo,
 	/* Internal error handling object. */
 	GError* err_internal = NULL;
 
-	/* Statistics */
-	buffersDevice->stats = ccl_buffer_new(ctx,
-		CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, sizeof(PPStatistics),
+	/* Statistics ring (also read by the incremental grass statistics
+	 * kernel), and pinned staging buffer with two halves where the ring is
+	 * alternately read into. */
+	buffersDevice->stats = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+		dataSizes.stats_ring, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	buffersDevice->stats_staging = ccl_buffer_new(ctx,
+		CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, 2 * dataSizes.stats_ring,
 		NULL, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
@@ -1451,6 +2997,13 @@ static void ppg_devicebuffers_create(CCLContext* ctx, CloRng* rng_clo,
 		&err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
+	if (ppg_pipeline_is_fused()) {
+		buffersDevice->cells_agents_epoch = ccl_buffer_new(ctx,
+			CL_MEM_READ_WRITE, dataSizes.cells_agents_epoch, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
+
 	/* Agents. */
 	buffersDevice->agents_data = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
 		dataSizes.agents_data, NULL, &err_internal);
@@ -1462,12 +3015,74 @@ static void ppg_devicebuffers_create(CCLContext* ctx, CloRng* rng_clo,
 		&err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
-	/* Agent reduction (count) */
-	buffersDevice->reduce_agent_global = ccl_buffer_new(ctx,
-		CL_MEM_READ_WRITE, dataSizes.reduce_agent_global, NULL,
-		&err_internal);
+	/* Incremental grass statistics. */
+	buffersDevice->grass_regrow = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+		dataSizes.grass_regrow, NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	buffersDevice->grass_eaten = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+		sizeof(cl_uint), NULL, &err_internal);
+	g_if_err_propagate_goto(err, err_internal, error_handler);
+
+	/* Newborns counter. */
+	if (ppg_repro_is_append()) {
+		buffersDevice->births = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+			sizeof(cl_uint), NULL, &err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
+
+	/* Number of agent slots. */
+	buffersDevice->agents_num = ccl_buffer_new(ctx, CL_MEM_READ_WRITE,
+		sizeof(cl_uint), NULL, &err_internal);
 	g_if_err_propagate_goto(err, err_internal, error_handler);
 
+	/* Counting sort. */
+	if (ppg_sort_is_count()) {
+
+		buffersDevice->agents_data_swap = ccl_buffer_new(ctx,
+			CL_MEM_READ_WRITE, dataSizes.agents_data, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		buffersDevice->sort_cell_count = ccl_buffer_new(ctx,
+			CL_MEM_READ_WRITE, dataSizes.sort_cell_count, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		buffersDevice->sort_cells = ccl_buffer_new(ctx,
+			CL_MEM_READ_WRITE, dataSizes.sort_cells, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		buffersDevice->sort_blocks = ccl_buffer_new(ctx,
+			CL_MEM_READ_WRITE, dataSizes.sort_blocks, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
+
+	/* Incremental counting sort. */
+	if (ppg_sort_is_inc()) {
+		buffersDevice->sort_stay = ccl_buffer_new(ctx,
+			CL_MEM_READ_WRITE, dataSizes.sort_stay, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
+
+	/* Per agent slot scans, of the incremental counting sort and of the
+	 * agent compaction. */
+	if (ppg_sort_is_count()) {
+
+		buffersDevice->slots_scan = ccl_buffer_new(ctx,
+			CL_MEM_READ_WRITE, dataSizes.slots_scan, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+
+		buffersDevice->slots_scan_sums = ccl_buffer_new(ctx,
+			CL_MEM_READ_WRITE, dataSizes.slots_scan_sums, NULL,
+			&err_internal);
+		g_if_err_propagate_goto(err, err_internal, error_handler);
+	}
+
 	/* RNG seeds. */
 	buffersDevice->rng_seeds = clo_rng_get_device_seeds(rng_clo);
 
@@ -1496,16 +3111,40 @@ static void ppg_devicebuffers_free(PPGBuffersDevice* buffersDevice) {
 
 	if (buffersDevice->stats)
 		ccl_buffer_destroy(buffersDevice->stats);
+	if (buffersDevice->stats_staging)
+		ccl_buffer_destroy(buffersDevice->stats_staging);
 	if (buffersDevice->cells_grass)
 		ccl_buffer_destroy(buffersDevice->cells_grass);
 	if (buffersDevice->cells_agents_index)
 		ccl_buffer_destroy(buffersDevice->cells_agents_index);
+	if (buffersDevice->cells_agents_epoch)
+		ccl_buffer_destroy(buffersDevice->cells_agents_epoch);
 	if (buffersDevice->agents_data)
 		ccl_buffer_destroy(buffersDevice->agents_data);
-	if (buffersDevice->reduce_agent_global)
-		ccl_buffer_destroy(buffersDevice->reduce_agent_global);
 	if (buffersDevice->reduce_grass_global)
 		ccl_buffer_destroy(buffersDevice->reduce_grass_global);
+	if (buffersDevice->grass_regrow)
+		ccl_buffer_destroy(buffersDevice->grass_regrow);
+	if (buffersDevice->grass_eaten)
+		ccl_buffer_destroy(buffersDevice->grass_eaten);
+	if (buffersDevice->births)
+		ccl_buffer_destroy(buffersDevice->births);
+	if (buffersDevice->agents_num)
+		ccl_buffer_destroy(buffersDevice->agents_num);
+	if (buffersDevice->agents_data_swap)
+		ccl_buffer_destroy(buffersDevice->agents_data_swap);
+	if (buffersDevice->sort_cell_count)
+		ccl_buffer_destroy(buffersDevice->sort_cell_count);
+	if (buffersDevice->sort_cells)
+		ccl_buffer_destroy(buffersDevice->sort_cells);
+	if (buffersDevice->sort_blocks)
+		ccl_buffer_destroy(buffersDevice->sort_blocks);
+	if (buffersDevice->sort_stay)
+		ccl_buffer_destroy(buffersDevice->sort_stay);
+	if (buffersDevice->slots_scan)
+		ccl_buffer_destroy(buffersDevice->slots_scan);
+	if (buffersDevice->slots_scan_sums)
+		ccl_buffer_destroy(buffersDevice->slots_scan_sums);
 
 }
 
@@ -1529,8 +3168,24 @@ static gchar* ppg_compiler_opts_build(PPGGlobalWorkSizes gws,
 		args_vw.grass);
 	g_string_append_printf(compilerOpts, "-D VW_GRASSREDUCE=%d ",
 		args_vw.reduce_grass);
-	g_string_append_printf(compilerOpts, "-D VW_AGENTREDUCE=%d ",
-		args_vw.reduce_agent);
+	if (ppg_grass_is_lazy())
+		g_string_append(compilerOpts, "-D PP_GRASS_LAZY ");
+	if (ppg_grass_stats_is_inc())
+		g_string_append(compilerOpts, "-D PP_GRASS_STATS_INC ");
+	if (ppg_sort_is_inc())
+		g_string_append(compilerOpts, "-D PPG_SORT_INC ");
+	if (ppg_order_is_typed())
+		g_string_append(compilerOpts, "-D PPG_SORT_TYPED ");
+	if (ppg_repro_is_append())
+		g_string_append(compilerOpts, "-D PPG_REPRO_APPEND ");
+	if (ppg_pipeline_is_fused())
+		g_string_append(compilerOpts, "-D PPG_FUSED ");
+	if (ppg_sort_count_in_move())
+		g_string_append(compilerOpts, "-D PPG_MOVE_COUNT ");
+	if (ppg_resolve_is_ranked())
+		g_string_append(compilerOpts, "-D PPG_RESOLVE_RANKED ");
+	g_string_append_printf(compilerOpts, "-D PPG_STATS_RING=%u ",
+		args.stats_ring);
 	g_string_append_printf(compilerOpts, "-D REDUCE_GRASS_NUM_WORKGROUPS=%d ",
 		(unsigned int) (gws.reduce_grass1 / lws.reduce_grass1));
 	g_string_append_printf(compilerOpts, "-D MAX_LWS=%d ",
@@ -1539,6 +3194,11 @@ static gchar* ppg_compiler_opts_build(PPGGlobalWorkSizes gws,
 		args.max_agents);
 	g_string_append_printf(compilerOpts, "-D CELL_NUM=%d ",
 		params.grid_xy);
+	g_string_append_printf(compilerOpts, "-D CELL_SLOTS=%u ",
+		(unsigned int) ppg_cell_slots(params));
+	if (ppg_cells_is_morton())
+		g_string_append_printf(compilerOpts, "-D PPG_CELL_MORTON=%u ",
+			ppg_morton_bits(params));
 	g_string_append_printf(compilerOpts, "-D INIT_SHEEP=%d ",
 		params.init_sheep);
 	g_string_append_printf(compilerOpts, "-D SHEEP_GAIN_FROM_FOOD=%d ",
@@ -1625,8 +3285,112 @@ static void ppg_args_parse(int argc, char* argv[],
 	/* Determine sorting algorithm. */
 	if (!args_alg.sort) args_alg.sort = g_strdup(PPG_SORT_DEFAULT);
 
+	/* Determine reproduction strategy. */
+	if (!args_alg.repro) args_alg.repro = g_strdup(PPG_REPRO_DEFAULT);
+
+	/* Determine order of agents within each cell. */
+	if (!args_alg.order) args_alg.order = g_strdup(PPG_ORDER_DEFAULT);
+
+	/* Determine resolution of grazing and predation conflicts. */
+	if (!args_alg.resolve)
+		args_alg.resolve = g_strdup(PPG_RESOLVE_DEFAULT);
+
+	/* Determine layout of cells in memory. */
+	if (!args_alg.cells) args_alg.cells = g_strdup(PPG_CELLS_DEFAULT);
+
+	/* Determine pipeline. */
+	if (!args_alg.pipeline)
+		args_alg.pipeline = g_strdup(PPG_PIPELINE_DEFAULT);
+
+	/* Determine grass representation. */
+	if (!args.grass) args.grass = g_strdup(PPG_DEFAULT_GRASS);
+
+	/* Determine grass statistics mode. */
+	if (!args.grass_stats)
+		args.grass_stats = g_strdup(PPG_DEFAULT_GRASS_STATS);
+
 	/* ** Validate arguments. ** */
 
+	/* Validate grass representation. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		(g_strcmp0(args.grass, PPG_DEFAULT_GRASS) != 0)
+		&& !ppg_grass_is_lazy(),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown grass representation '%s'.", args.grass);
+
+	/* Validate grass statistics mode. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		!ppg_grass_stats_is_inc()
+		&& (g_strcmp0(args.grass_stats, "full") != 0),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown grass statistics mode '%s'.", args.grass_stats);
+
+	/* Validate reproduction strategy. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		(g_strcmp0(args_alg.repro, PPG_REPRO_FIXED) != 0)
+		&& !ppg_repro_is_append(),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown reproduction strategy '%s'.", args_alg.repro);
+
+	/* Validate order of agents within each cell. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		(g_strcmp0(args_alg.order, PPG_ORDER_RANDOM) != 0)
+		&& !ppg_order_is_typed(),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown order of agents in cells '%s'.", args_alg.order);
+
+	/* Validate resolution of grazing and predation conflicts. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		(g_strcmp0(args_alg.resolve, PPG_RESOLVE_ATOMIC) != 0)
+		&& !ppg_resolve_is_ranked(),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown conflict resolution '%s'.", args_alg.resolve);
+
+	/* The ranked resolution needs sheep and wolves apart in each cell,
+	 * in the canonical order only the counting sort provides, and
+	 * newborns placed where they do not depend on timing. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		ppg_resolve_is_ranked()
+		&& (!ppg_order_is_typed() || !ppg_sort_is_count()
+			|| ppg_repro_is_append()),
+		PP_INVALID_ARGS, error_handler,
+		"The " PPG_RESOLVE_RANKED " conflict resolution requires the "
+		PPG_ORDER_TYPED " order, a counting sort and " PPG_REPRO_FIXED
+		" reproduction.");
+
+	/* Validate layout of cells in memory. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		(g_strcmp0(args_alg.cells, PPG_CELLS_ROW) != 0)
+		&& !ppg_cells_is_morton(),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown cell layout '%s'.", args_alg.cells);
+
+	/* CL_Ops sorts sort agents by their raw coordinates. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		ppg_cells_is_morton() && !ppg_sort_is_count(),
+		PP_INVALID_ARGS, error_handler,
+		"The " PPG_CELLS_MORTON " cell layout requires a counting sort.");
+
+	/* Validate pipeline. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		(g_strcmp0(args_alg.pipeline, PPG_PIPELINE_SPLIT) != 0)
+		&& !ppg_pipeline_is_fused(),
+		PP_INVALID_ARGS, error_handler,
+		"Unknown pipeline '%s'.", args_alg.pipeline);
+
+	/* Validate statistics ring. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		args.stats_ring == 0,
+		PP_INVALID_ARGS, error_handler,
+		"The --stats-ring parameter must be at least 1.");
+
+	/* Validate run ahead. */
+	g_if_err_create_goto(*err, PP_ERROR,
+		args.run_ahead > PPG_MAX_RUN_AHEAD,
+		PP_INVALID_ARGS, error_handler,
+		"The --run-ahead parameter must be at most %d.",
+		PPG_MAX_RUN_AHEAD);
+
 	/* Validate agent size. */
 	g_if_err_create_goto(*err, PP_ERROR,
 		(args.agent_size != 32) && (args.agent_size != 64),
@@ -1648,11 +3412,6 @@ static void ppg_args_parse(int argc, char* argv[],
 		"The -vw-reduce-grass parameter must be either 0 (auto-detect), 1, 2, "
 		"4, 8 or 16.");
 
-	g_if_err_create_goto(*err, PP_ERROR,
-		(clo_ones32(args_vw.reduce_agent) > 1) || (args_vw.reduce_agent > 16),
-		PP_INVALID_ARGS, error_handler,
-		"The -vw-reduce-agent parameter must be either 0 (auto-detect), 1, 2, "
-		"4, 8 or 16.");
 
 	/* If we got here, everything is OK. */
 	g_assert (*err == NULL);
@@ -1684,9 +3443,16 @@ static void ppg_args_free(GOptionContext* context) {
 	if (args.prof_agg_file) g_free(args.prof_agg_file);
 #endif
 	if (args.compiler_opts) g_free(args.compiler_opts);
+	if (args.grass) g_free(args.grass);
+	if (args.grass_stats) g_free(args.grass_stats);
 	if (args_alg.rng) g_free(args_alg.rng);
 	if (args_alg.sort) g_free(args_alg.sort);
 	if (args_alg.sort_opts) g_free(args_alg.sort_opts);
+	if (args_alg.repro) g_free(args_alg.repro);
+	if (args_alg.pipeline) g_free(args_alg.pipeline);
+	if (args_alg.order) g_free(args_alg.order);
+	if (args_alg.resolve) g_free(args_alg.resolve);
+	if (args_alg.cells) g_free(args_alg.cells);
 }
 
 /**
@@ -1708,11 +3474,14 @@ int main(int argc, char **argv) {
 	/* Predator-Prey simulation data structures. */
 	PPGGlobalWorkSizes gws;
 	PPGLocalWorkSizes lws;
-	PPGDataSizes dataSizes = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-	PPGBuffersDevice buffersDevice = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+	PPGDataSizes dataSizes =
+		{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+	PPGBuffersDevice buffersDevice = {NULL, NULL, NULL, NULL, NULL, NULL,
+		NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+		NULL, NULL, NULL};
 	PPParameters params;
-	PPGKernels krnls =
-		{NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+	PPGKernels krnls = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+		NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
 	PPStatistics * stats_host = NULL;
 	gchar* compilerOpts = NULL;
 
@@ -1751,6 +3520,9 @@ int main(int argc, char **argv) {
 	 * to sort it. */
 	const char * get_key;
 
+	/* Maximum size of device memory allocations. */
+	cl_ulong max_alloc;
+
 	/* Parse and validate arguments. */
 	ppg_args_parse(argc, argv, &context, &err);
 	g_if_err_goto(err, error_handler);
@@ -1765,6 +3537,13 @@ int main(int argc, char **argv) {
 	pp_load_params(&params, args.params, &err);
 	g_if_err_goto(err, error_handler);
 
+	/* Cell slots of the Morton layout must be indexable with 32 bits. */
+	g_if_err_create_goto(err, PP_ERROR,
+		ppg_cells_is_morton()
+		&& (ppg_bits(params.grid_x) + ppg_bits(params.grid_y) > 31),
+		PP_INVALID_ARGS, error_handler,
+		"Grid too large for the " PPG_CELLS_MORTON " cell layout.");
+
 	/* Specify device filters and create context from them. */
 	ccl_devsel_add_indep_filter(
 		&filters, ccl_devsel_indep_type_gpu, NULL);
@@ -1785,27 +3564,47 @@ int main(int argc, char **argv) {
 	cq2 = ccl_queue_new(ctx, dev, PP_QUEUE_PROPERTIES, &err);
 	g_if_err_goto(err, error_handler);
 
-	/* Create RNG object. */
+	/* Get maximum size of device memory allocations, which bounds the
+	 * agents buffer, since it is grown on demand. */
+	max_alloc = ccl_device_get_info_scalar(
+		dev, CL_DEVICE_MAX_MEM_ALLOC_SIZE, cl_ulong, &err);
+	g_if_err_goto(err, error_handler);
+
+	/* Compute work sizes for different kernels. */
+	ppg_worksizes_compute(dev, params, &gws, &lws, &err);
+	g_if_err_goto(err, error_handler);
+
+	/* Create RNG object, with one seed per cell or agent slot. */
 	rng_clo = clo_rng_new(
 		args_alg.rng, CLO_RNG_SEED_HOST_MT, NULL,
-		MAX(args.max_agents, params.grid_xy), args.rng_seed, NULL,
+		MAX(gws.init_agent, ppg_cell_slots(params)), args.rng_seed, NULL,
 		ctx, cq1, &err);
 	g_if_err_goto(err, error_handler);
 
-	/* Create sorter object. */
-	if (args.agent_size == 64) {
-		ag_sort_elem_type = CLO_ULONG;
-		get_key = "((x) >> 17)";
-	} else {
-		ag_sort_elem_type = CLO_UINT;
-		get_key = "((x) >> 12)";
-	}
-	ag_sort_key_type = CLO_ULONG;
-	sorter = clo_sort_new(args_alg.sort, args_alg.sort_opts, ctx,
-		&ag_sort_elem_type, &ag_sort_key_type, NULL, get_key,
-		args.compiler_opts, &err);
+	/* Determine maximum number of agents, if not given by user, and keep
+	 * it within what device memory allocations can hold. */
+	ppg_agents_limit_set(max_alloc, rng_clo, params, gws, lws, &err);
 	g_if_err_goto(err, error_handler);
 
+	/* Create sorter object, unless agents are sorted with the counting
+	 * sort. */
+	if (!ppg_sort_is_count()) {
+		if (args.agent_size == 64) {
+			ag_sort_elem_type = CLO_ULONG;
+			get_key = "((x) >> 17)";
+		} else {
+			ag_sort_elem_type = CLO_UINT;
+			/* With the typed order the key keeps the type, so that
+			 * sheep come before wolves in each cell. */
+			get_key = ppg_order_is_typed() ? "((x) >> 11)" : "((x) >> 12)";
+		}
+		ag_sort_key_type = CLO_ULONG;
+		sorter = clo_sort_new(args_alg.sort, args_alg.sort_opts, ctx,
+			&ag_sort_elem_type, &ag_sort_key_type, NULL, get_key,
+			args.compiler_opts, &err);
+		g_if_err_goto(err, error_handler);
+	}
+
 	/* Concatenate complete source: RNG kernels source + common source
 	 * + GPU source. */
 	src = g_strconcat(clo_rng_get_source(rng_clo), PP_COMMON_SRC,
@@ -1815,10 +3614,6 @@ int main(int argc, char **argv) {
 	prg = ccl_program_new_from_source(ctx, src, &err);
 	g_if_err_goto(err, error_handler);
 
-	/* Compute work sizes for different kernels. */
-	ppg_worksizes_compute(prg, params, &gws, &lws, &err);
-	g_if_err_goto(err, error_handler);
-
 	/* Compiler options. */
 	compilerOpts = ppg_compiler_opts_build(gws, lws, params,
 		args.compiler_opts);
@@ -1844,7 +3639,7 @@ int main(int argc, char **argv) {
 	g_if_err_goto(err, error_handler);
 
 	/*  Set fixed kernel arguments. */
-	ppg_kernelargs_set(krnls, buffersDevice, dataSizes);
+	ppg_kernelargs_set(krnls, buffersDevice, dataSizes, gws, lws);
 
 	/* Print information about simulation. */
 	ppg_info_print(gws, lws, dataSizes, sorter, compilerOpts, &err);
@@ -1854,8 +3649,8 @@ int main(int argc, char **argv) {
 	ccl_prof_start(prof);
 
 	/* Simulation!! */
-	ppg_simulate(krnls, cq1, cq2, sorter, params, gws, lws, dataSizes,
-		stats_host, buffersDevice, &err);
+	ppg_simulate(krnls, ctx, cq1, cq2, sorter, params, gws, lws,
+		dataSizes, stats_host, &rng_clo, &buffersDevice, &err);
 	g_if_err_goto(err, error_handler);
 
 	/* Stop basic timing / profiling. */
@@ -26,18 +26,47 @@
  *
  * * VW_GRASS - Vector size used in grass kernel (vector of uints).
  * * VW_REDUCEGRASS - Vector size used in reduce grass kernels (vector of uints)
- * * VW_REDUCEAGENTS - Vector size used in reduce agents kernels (vector of
- *   ulongs or uints)
  * * REDUCE_GRASS_NUM_WORKGROUPS - Number of work groups in grass reduction
  *   step 1 (equivalent to get_num_groups(0)), but to be used in grass reduction
  *   step 2.
  * * MAX_LWS - Maximum local work size used in simulation.
  * * CELL_NUM - Number of cells in simulation.
+ * * CELL_SLOTS - Number of cell slots in cell buffers, CELL_NUM or more
+ *   with the padding of the Morton cell layout.
  * * MAX_AGENTS - Maximum allowed agents in the simulation.
+ * * PP_GRASS_LAZY - If defined, grass counters keep the iteration at which
+ *   grass regrows, and are not decremented by the grass kernel.
+ * * PP_GRASS_STATS_INC - If defined, grass statistics are derived from the
+ *   number of cells eaten in each iteration and a regrowth histogram, instead
+ *   of being reduced from all cells (except in the first iteration).
  *
  * * PPG_AG_xx - Specifies the size in memory of each agent (32 or 64 bits).
  * * PPG_RNG_xxx - Specifies the random number generation algorithm to use.
  * * PPG_SORT_xxx - Specifies the sorting algorithm to use.
+ * * PPG_STATS_RING - Number of iterations kept in the statistics ring, where
+ *   the statistics of each iteration are gathered before being read back in
+ *   batches.
+ * * PPG_REPRO_APPEND - If defined, the newborns of each workgroup are staged
+ *   in local memory and appended contiguously after the agent slots, using
+ *   one global atomic per workgroup. Otherwise, the newborn of agent `gid`
+ *   is placed at index `num_agents + gid`.
+ * * PPG_SORT_INC - If defined, the counting sort keeps agents which did not
+ *   leave the slots of their cell in place, in order, and only scatters
+ *   the remaining agents.
+ * * PPG_SORT_TYPED - If defined, agents are sorted by cell and then by type,
+ *   sheep first, and only sheep are indexed in cells.
+ * * PPG_FUSED - If defined, grass is regrown by the grass statistics
+ *   kernels, and the agent index in cells is not reset, but tagged with the
+ *   iteration in which agents act.
+ * * PPG_MOVE_COUNT - If defined, the agent movement kernel counts the
+ *   agents in each cell for the counting sort, instead of its first step.
+ * * PPG_RESOLVE_RANKED - If defined, grazing and predation conflicts are
+ *   decided by rank within each cell instead of with atomics, and the
+ *   counting sort puts the agents of each cell in a canonical order.
+ *   Requires PPG_SORT_TYPED, the counting sort and not PPG_REPRO_APPEND.
+ * * PPG_CELL_MORTON - If defined, cells are stored in Morton (Z) order,
+ *   interleaving the given number of low bits of their coordinates,
+ *   instead of row-major order.
  *
  * * INIT_SHEEP - Initial number of sheep.
  * * SHEEP_GAIN_FROM_FOOD - Sheep energy gain when eating grass.
@@ -159,6 +188,13 @@
 	 * * 0000 0000 0001 0000 - Type (1 bit, 0-65535)
 	 * * 0000 0000 0000 ffff - Energy (16 bits, 0-65535)
 	 *
+	 * If PPG_SORT_TYPED is defined, the type comes before the hash, so
+	 * that sorting agents by value places sheep before wolves in each
+	 * cell:
+	 *
+	 * * 0000 0000 8000 0000 - Type (1 bit, 0-1)
+	 * * 0000 0000 7fff 0000 - Hash (15 bits, 0-32767)
+	 *
 	 * */
 
 	#define PPG_AG_ENERGY_GET(agent) ((agent) & 0xffff)
@@ -172,6 +208,19 @@
 	#define PPG_AG_ENERGY_SUB(agent, energy) \
 		(agent) = ((agent) & 0xffffffffffff0000) | (((agent) - energy) & 0xffff)
 
+#ifdef PPG_SORT_TYPED
+
+	#define PPG_AG_TYPE_GET(agent) (((agent) >> 31) & 0x1)
+
+	#define PPG_AG_TYPE_SET(agent, type) \
+		(agent) = ((agent) & 0xffffffff7fffffff) | \
+			(((ulong) ((type) & 0x1)) << 31)
+
+	#define PPG_AG_HASH_SET(agent, hash) \
+		(agent) = ((agent) & 0xffffffff8000ffff) | (((hash) & 0x7fff) << 16)
+
+#else
+
 	#define PPG_AG_TYPE_GET(agent) (((agent) >> 16) & 0x1)
 
 	#define PPG_AG_TYPE_SET(agent, type) \
@@ -180,6 +229,8 @@
 	#define PPG_AG_HASH_SET(agent, hash) \
 		(agent) = ((agent) & 0xffffffff0001ffff) | (((hash) & 0x7fff) << 17)
 
+#endif
+
 	#define PPG_AG_IS_SHEEP(agent) (PPG_AG_TYPE_GET(agent) == SHEEP_ID)
 
 	#define PPG_AG_IS_WOLF(agent) (PPG_AG_TYPE_GET(agent) == WOLF_ID)
@@ -203,8 +254,10 @@
 
 	#define PPG_AG_SET_DEAD(agent) (agent) = 0xffffffffffffffff
 
+#ifndef PPG_CELL_MORTON
 	#define PPG_CELL_IDX(agent) \
 		((((agent) >> 32) & 0xffff) * GRID_X + ((agent) >> 48))
+#endif
 
 	#define PPG_AG_STORE_LO(agent, pos, data) \
 		data[pos * 2 + PPG_AG_LO_IDX] = (uint) (agent & 0xffffffffU)
@@ -244,6 +297,9 @@
 	 * * 00000800 - Type (1 bits, 0-1)
 	 * * 000007ff - Energy (11 bits, 0-2047)
 	 *
+	 * Sorting agents by value, or by a key which keeps the type, places
+	 * sheep before wolves in each cell, as there is no hash.
+	 *
 	 * */
 
 	#define PPG_AG_ENERGY_GET(agent) ((agent) & 0x7ff)
@@ -285,8 +341,10 @@
 
 	#define PPG_AG_SET_DEAD(agent) (agent) = 0xffffffff
 
+#ifndef PPG_CELL_MORTON
 	#define PPG_CELL_IDX(agent) \
 		((((agent) >> 12) & 0x3ff) * GRID_X + ((agent) >> 22))
+#endif
 
 	#define PPG_AG_STORE_LO(agent, pos, data) \
 		data[pos * 2 + PPG_AG_LO_IDX] = (ushort) (agent & 0xffff)
@@ -315,72 +373,134 @@
 
 #endif
 
-/* Macros and type definitions for agent reduction kernels which depend on
- * chosen vector width. */
-#if VW_AGENTREDUCE == 1
+#define CLO_SORT_ELEM_TYPE uagr
 
-	#define VW_AGENTREDUCE_SUM(x) (x)
-	#define convert_agentreduce_uagr(x) convert_uagr(x)
-	typedef uagr agentreduce_uagr;
-	typedef agr agentreduce_agr;
+#ifdef PPG_CELL_MORTON
 
-#elif VW_AGENTREDUCE == 2
+/**
+ * Spread the low 16 bits of the given value to its even bits.
+ *
+ * @param v Value to spread.
+ * @return Spread value.
+ * */
+uint ppg_morton_spread(uint v) {
+
+	v &= 0xffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
 
-	#define VW_AGENTREDUCE_SUM(x) (x.s0 + x.s1)
-	#define convert_agentreduce_uagr(x) convert_uagr2(x)
-	typedef uagr2 agentreduce_uagr;
-	typedef agr2 agentreduce_agr;
+/**
+ * Gather the even bits of the given value into its low 16 bits, i.e. the
+ * inverse of ppg_morton_spread().
+ *
+ * @param v Value to gather.
+ * @return Gathered value.
+ * */
+uint ppg_morton_gather(uint v) {
+
+	v &= 0x55555555;
+	v = (v | (v >> 1)) & 0x33333333;
+	v = (v | (v >> 2)) & 0x0f0f0f0f;
+	v = (v | (v >> 4)) & 0x00ff00ff;
+	v = (v | (v >> 8)) & 0x0000ffff;
+	return v;
+}
 
-#elif VW_AGENTREDUCE == 4
+/**
+ * Morton index of a cell. The low `PPG_CELL_MORTON` bits of the cell
+ * coordinates are interleaved, x in the even bits, and the remaining bits
+ * of the longer grid side follow them.
+ *
+ * @param xy Cell coordinates.
+ * @return Morton index of cell.
+ * */
+uint ppg_morton(ushort2 xy) {
 
-	#define VW_AGENTREDUCE_SUM(x) (x.s0 + x.s1 + x.s2 + x.s3)
-	#define convert_agentreduce_uagr(x) convert_uagr4(x)
-	typedef uagr4 agentreduce_uagr;
-	typedef agr4 agentreduce_agr;
+	uint mask = (1 << PPG_CELL_MORTON) - 1;
+	return ppg_morton_spread(xy.x & mask)
+		| (ppg_morton_spread(xy.y & mask) << 1)
+		| (((uint) (xy.x | xy.y) >> PPG_CELL_MORTON)
+			<< (2 * PPG_CELL_MORTON));
+}
 
-#elif VW_AGENTREDUCE == 8
+/**
+ * Does the given cell slot of the Morton layout hold a cell of the grid,
+ * i.e. is it not padding?
+ *
+ * @param slot Cell slot.
+ * @return True if the slot holds a cell of the grid, false otherwise.
+ * */
+bool ppg_morton_in_grid(uint slot) {
+
+	uint low = slot & ((1 << (2 * PPG_CELL_MORTON)) - 1);
+	uint high = (slot >> (2 * PPG_CELL_MORTON)) << PPG_CELL_MORTON;
+	uint x = ppg_morton_gather(low);
+	uint y = ppg_morton_gather(low >> 1);
+#if GRID_X >= GRID_Y
+	x |= high;
+#else
+	y |= high;
+#endif
+	return (x < GRID_X) && (y < GRID_Y);
+}
 
-	#define VW_AGENTREDUCE_SUM(x) \
-		(x.s0 + x.s1 + x.s2 + x.s3 + x.s4 + x.s5 + x.s6 + x.s7)
-	#define convert_agentreduce_uagr(x) convert_uagr8(x)
-	typedef uagr8 agentreduce_uagr;
-	typedef agr8 agentreduce_agr;
+	#define PPG_CELL_IDX(agent) ppg_morton(PPG_AG_XY_GET(agent))
+	#define PPG_CELL_IN_GRID(slot) ppg_morton_in_grid(slot)
 
-#elif VW_AGENTREDUCE == 16
+#else
 
-	#define VW_AGENTREDUCE_SUM(x) \
-		(x.s0 + x.s1 + x.s2 + x.s3 + x.s4 + x.s5 + x.s6 + x.s7 \
-		+ x.s8 + x.s9 + x.sa + x.sb + x.sc + x.sd + x.se + x.sf)
-	#define convert_agentreduce_uagr(x) convert_uagr16(x)
-	typedef uagr16 agentreduce_uagr;
-	typedef agr16 agentreduce_agr;
+	#define PPG_CELL_IN_GRID(slot) ((slot) < CELL_NUM)
 
 #endif
 
-#define CLO_SORT_ELEM_TYPE uagr
+/* Key by which the counting sort sorts agents, and number of keys. With the
+ * typed order, sheep (SHEEP_ID is zero) come before wolves in each cell. */
+#ifdef PPG_SORT_TYPED
+	#define PPG_SORT_KEY(agent) \
+		(2 * PPG_CELL_IDX(agent) + (PPG_AG_IS_WOLF(agent) ? 1 : 0))
+	#define PPG_SORT_KEY_NUM (2 * CELL_SLOTS)
+#else
+	#define PPG_SORT_KEY(agent) PPG_CELL_IDX(agent)
+	#define PPG_SORT_KEY_NUM CELL_SLOTS
+#endif
+
+/* Counter of padding cells, i.e. cell slots past the grid or, with the
+ * Morton cell layout, outside it. Padding cells never hold grass, are not
+ * regrown and are left out of grass reductions. */
+#define PPG_GRASS_PADDING UINT_MAX
+
+/* Regrow (a vector of) grass countdowns, leaving padding cells as they
+ * are. */
+#define PPG_GRASS_REGROW(g) \
+	select((g), (g) - 1, ((g) > 0) & ((g) != PPG_GRASS_PADDING))
 
 /**
  * Initialize grid cells.
  *
  * @param grass Grass counters (0 means grass is alive).
  * @param seeds RNG seeds.
+ * @param regrow Regrowth histogram, zero-initialized.
  * */
 __kernel void init_cell(
 			__global uint *grass,
-			__global clo_statetype *seeds) {
+			__global clo_statetype *seeds,
+			__global uint *regrow) {
 
 	/* Grid position for this work-item */
 	uint gid = get_global_id(0);
 
-	/* Counter variable, by default it's the maximum possible value. */
-	uint counter = UINT_MAX;
+	/* Counter variable, by default the one of padding cells. */
+	uint counter = PPG_GRASS_PADDING;
 
 	/* Check if this workitem will initialize a cell.*/
-	if (gid < CELL_NUM) {
+	if (PPG_CELL_IN_GRID(gid)) {
 
 		/* Cells within bounds may be dead or alive with 50% chance. */
-		uint is_alive =
-			select((uint) 0, (uint) clo_rng_next_int(seeds, 2), gid < CELL_NUM);
+		uint is_alive = clo_rng_next_int(seeds, 2);
 
 		/* If cell is alive, value will be zero. Otherwise, randomly
 		 * determine a counter value. */
@@ -388,24 +508,49 @@ __kernel void init_cell(
 			(uint) (clo_rng_next_int(seeds, GRASS_RESTART) + 1),
 			(uint) 0,
 			is_alive);
+
+#ifdef PP_GRASS_STATS_INC
+		/* Grass regrows in the iteration given by the counter. */
+		if (counter > 0)
+			atomic_inc(&regrow[PP_GRASS_REGROW_IDX(counter, GRASS_RESTART)]);
+#endif
 	}
 
-	/* Initialize cell counter. Padding cells (gid >= CELL_NUM) will
-	 * have their counter initialized to UINT_MAX, thus this value will
-	 * limit the maximum number of iterations (otherwise padding cells
-	 * will become alive, see grass kernel below). */
+	/* Initialize cell counter. */
 	grass[gid] = counter;
 }
 
+/* Slot of the statistics ring where the statistics of the given iteration
+ * are gathered. */
+#define PPG_STATS_SLOT(iter) ((iter) % PPG_STATS_RING)
+
+/**
+ * Reset agent statistics, which are then accumulated by the agent movement
+ * kernel. Must only be called by one work-item, after the statistics of the
+ * previous iteration have been read.
+ *
+ * @param stats Simulation statistics.
+ * */
+void ppg_agent_stats_reset(__global PPStatisticsOcl *stats) {
+
+	stats[0].sheep = 0;
+	stats[0].wolves = 0;
+	stats[0].sheep_en = 0;
+	stats[0].wolves_en = 0;
+}
+
 /**
  * Initialize agents.
  *
  * @param data The agent data array.
  * @param seeds RNG seeds.
+ * @param stats Statistics ring, agent statistics of the first iteration are
+ * reset.
  * */
 __kernel void init_agent(
 			__global uagr *data,
-			__global clo_statetype *seeds
+			__global clo_statetype *seeds,
+			__global PPStatisticsOcl *stats
 ) {
 
 	/* Agent to be handled by this workitem. */
@@ -413,6 +558,10 @@ __kernel void init_agent(
 	uagr new_agent;
 	PPG_AG_SET_DEAD(new_agent);
 
+	/* Reset agent statistics. */
+	if (gid == 0)
+		ppg_agent_stats_reset(stats);
+
 	/* Determine what this workitem will do. */
 	if (gid < (INIT_SHEEP + INIT_WOLVES)) {
 		/* This workitem will initialize an alive agent. */
@@ -440,30 +589,93 @@ __kernel void init_agent(
 
 
 /**
- * Grass kernel. Grows grass and resets agent indexes in cell.
+ * Derive the grass statistics of the given iteration from those of the
+ * previous iteration, still in the statistics ring, and from the number of
+ * cells eaten by sheep in the given iteration, which is then reset. Must
+ * only be called by one work-item.
+ *
+ * @param stats Statistics ring.
+ * @param regrow Regrowth histogram.
+ * @param grass_eaten Number of cells whose grass was eaten.
+ * @param iter Iteration, larger than zero.
+ * */
+void ppg_grass_stats(__global PPStatisticsOcl * stats,
+	__global uint * regrow, __global uint * grass_eaten, uint iter) {
+
+	uint grass_alive = stats[PPG_STATS_SLOT(iter - 1)].grass;
+	uint grass_en = stats[PPG_STATS_SLOT(iter - 1)].grass_en;
+
+	pp_grass_stats_next(&grass_alive, &grass_en, *grass_eaten, regrow, iter,
+		CELL_NUM, GRASS_RESTART);
+
+	stats[PPG_STATS_SLOT(iter)].grass = grass_alive;
+	stats[PPG_STATS_SLOT(iter)].grass_en = grass_en;
+	*grass_eaten = 0;
+}
+
+/**
+ * Grass kernel. Grows grass and resets agent indexes in cell. With the lazy
+ * grass representation, grass counters are left untouched.
+ *
+ * If `PPG_FUSED` is defined, agent indexes in cells are not reset, and the
+ * first work-item derives the grass statistics of the current iteration,
+ * as the incremental grass statistics kernel does. The kernel then
+ * replaces the latter with grass countdowns, in all iterations except the
+ * first, and grass is not regrown in the last iteration.
  *
  * @param grass Grass counters (0 means grass is alive).
- * @param agents_index Agent start and end indexes in cell.
+ * @param agents_index Agent start and end indexes in cell (only if
+ * `PPG_FUSED` is not defined).
+ * @param stats Statistics ring (only if `PPG_FUSED` is defined).
+ * @param regrow Regrowth histogram (only if `PPG_FUSED` is defined).
+ * @param grass_eaten Number of cells whose grass was eaten in the current
+ * iteration (only if `PPG_FUSED` is defined).
+ * @param iter Current iteration (only if `PPG_FUSED` is defined).
  * */
 __kernel void grass(
 			__global grass_uintx * grass,
-			__global grass_ulongx * agents_index)
+#ifdef PPG_FUSED
+			__global PPStatisticsOcl * stats,
+			__global uint * regrow,
+			__global uint * grass_eaten,
+			__private uint iter
+#else
+			__global grass_ulongx * agents_index
+#endif
+			)
 {
 	/* Grid position for this workitem */
 	size_t gid = get_global_id(0);
 
+#ifdef PPG_FUSED
+
+#ifdef PP_GRASS_STATS_INC
+	/* Derive grass statistics. */
+	if (gid == 0)
+		ppg_grass_stats(stats, regrow, grass_eaten, iter);
+#endif
+
+	/* No grass regrows after the last iteration. */
+	if (iter >= ITERS)
+		return;
+
+#endif
+
 	/* Check if this workitem will do anything */
-	uint half_index = PP_DIV_CEIL(CELL_NUM, VW_GRASS);
+	uint half_index = PP_DIV_CEIL(CELL_SLOTS, VW_GRASS);
 	if (gid < half_index) {
 
+#ifndef PP_GRASS_LAZY
+
 		/* Get grass counter from global memory. */
 		grass_uintx grass_l = grass[gid];
 
-		/* Decrement counter if grass is dead. This might also decrement
-		 * counters of padding cells (which are initialized to UINT_MAX)
-		 * if vw_int > 1. */
-		grass[gid] = select((grass_uintx) 0, grass_l - 1, grass_l > 0);
+		/* Decrement counter if grass is dead. */
+		grass[gid] = PPG_GRASS_REGROW(grass_l);
 
+#endif
+
+#ifndef PPG_FUSED
 		/* Reset cell start and finish. */
 		agents_index[gid] = (grass_ulongx)
 			upsample((grass_uintx) MAX_AGENTS, (grass_uintx) MAX_AGENTS);
@@ -472,20 +684,27 @@ __kernel void grass(
 		/// which were in accordance to int vectorization. Although like this is
 		/// faster for small vector sizes, maybe we should separate the "reset
 		/// cell start and finish" in another kernel?
+#endif
 	}
 }
 
 /**
  * Grass reduction kernel, part 1.
  *
+ * If `PPG_FUSED` is defined, grass countdowns are also decremented, i.e.
+ * grass is regrown, after being counted (except in the last iteration),
+ * so that the grass kernel does not run.
+ *
  * @param grass Grass counters (0 means grass is alive).
  * @param partial_sums Workgroup level (shared memory) grass counts.
  * @param reduce_grass_global Global level grass counts.
+ * @param iter Current iteration.
  * */
 __kernel void reduce_grass1(
 			__global grassreduce_uintx * grass,
 			__local grassreduce_uintx * partial_sums,
-			__global grassreduce_uintx * reduce_grass_global) {
+			__global grassreduce_uintx * reduce_grass_global,
+			__private uint iter) {
 
 	/* Global and local work-item IDs */
 	size_t gid = get_global_id(0);
@@ -499,13 +718,32 @@ __kernel void reduce_grass1(
 	grassreduce_uintx sum_en = 0;
 
 	/* Serial count */
-	uint cellVectorCount = PP_DIV_CEIL(CELL_NUM, VW_GRASSREDUCE);
+	uint cellVectorCount = PP_DIV_CEIL(CELL_SLOTS, VW_GRASSREDUCE);
 	uint serialCount = PP_DIV_CEIL(cellVectorCount, global_size);
 	for (uint i = 0; i < serialCount; i++) {
 		uint index = i * global_size + gid;
 		if (index < cellVectorCount) {
-			sum_qty += 0x1 & convert_grassreduce_uintx(!grass[index]);
-			sum_en += convert_grassreduce_uintx(grass[index]);
+#ifdef PP_GRASS_LAZY
+			/* Grass is alive if it regrows at or before the current
+			 * iteration, otherwise its countdown is the number of
+			 * iterations left. */
+			grassreduce_uintx grass_l = grass[index];
+			sum_qty += 0x1 & convert_grassreduce_uintx(
+				grass_l <= (grassreduce_uintx) iter);
+			sum_en += select(sub_sat(grass_l, (grassreduce_uintx) iter),
+				(grassreduce_uintx) 0,
+				grass_l == (grassreduce_uintx) PPG_GRASS_PADDING);
+#else
+			grassreduce_uintx grass_l = grass[index];
+			sum_qty += 0x1 & convert_grassreduce_uintx(!grass_l);
+			sum_en += select(grass_l, (grassreduce_uintx) 0,
+				grass_l == (grassreduce_uintx) PPG_GRASS_PADDING);
+#ifdef PPG_FUSED
+			/* Regrow grass, as the grass kernel does. */
+			if (iter < ITERS)
+				grass[index] = PPG_GRASS_REGROW(grass_l);
+#endif
+#endif
 		}
 	}
 
@@ -540,12 +778,14 @@ __kernel void reduce_grass1(
  *
  * @param reduce_grass_global Global level grass counts.
  * @param partial_sums Workgroup level (shared memory) grass counts.
- * @param stats Final grass count.
+ * @param stats Statistics ring, where the final grass count is placed.
+ * @param iter Current iteration.
  * */
  __kernel void reduce_grass2(
 			__global grassreduce_uintx * reduce_grass_global,
 			__local grassreduce_uintx * partial_sums,
-			__global PPStatisticsOcl * stats) {
+			__global PPStatisticsOcl * stats,
+			__private uint iter) {
 
 	/* Global and local work-item IDs */
 	size_t lid = get_local_id(0);
@@ -576,181 +816,101 @@ __kernel void reduce_grass1(
 
 	/* Put in global memory */
 	if (lid == 0) {
-		stats[0].grass = VW_GRASSREDUCE_SUM(partial_sums[0]);
-		stats[0].grass_en = VW_GRASSREDUCE_SUM(partial_sums[group_size]);
+		stats[PPG_STATS_SLOT(iter)].grass =
+			VW_GRASSREDUCE_SUM(partial_sums[0]);
+		stats[PPG_STATS_SLOT(iter)].grass_en =
+			VW_GRASSREDUCE_SUM(partial_sums[group_size]);
 	}
 
 }
 
 /**
- * Agent reduction kernel, part 1.
+ * Incremental grass statistics kernel.
  *
- * @param data The agent data array.
- * @param partial_sums Workgroup level (shared memory) agent counts.
- * @param reduce_agent_global Global level agent counts.
- * @param max_agents Maximum agents for current interation.
- * */
-__kernel void reduce_agent1(
-			__global agentreduce_uagr *data,
-			__local agentreduce_uagr *partial_sums,
-			__global agentreduce_uagr *reduce_agent_global,
-			uint max_agents) {
-
-	/* Global and local work-item IDs */
-	size_t gid = get_global_id(0);
-	size_t lid = get_local_id(0);
-	size_t group_size = get_local_size(0);
-	size_t global_size = get_global_size(0);
-	size_t group_id = get_group_id(0);
-
-	/* Serial sum */
-	agentreduce_uagr sumSheep_pop = 0;
-	agentreduce_uagr sumWolves_pop = 0;
-	agentreduce_uagr sumSheep_en = 0;
-	agentreduce_uagr sumWolves_en = 0;
-
-	/* Serial count */
-	uint agentVectorCount = PP_DIV_CEIL(max_agents, VW_AGENTREDUCE);
-	uint serialCount = PP_DIV_CEIL(agentVectorCount, global_size);
-
-	for (uint i = 0; i < serialCount; i++) {
-		uint index = i * global_size + gid;
-		if (index < agentVectorCount) {
-			agentreduce_uagr data_l = data[index];
-			agentreduce_uagr is_alive =
-				0x1 & convert_agentreduce_uagr(PPG_AG_IS_ALIVE(data_l));
-			agentreduce_uagr is_sheep =
-				convert_agentreduce_uagr(PPG_AG_IS_SHEEP(data_l));
-			agentreduce_uagr is_wolf =
-				convert_agentreduce_uagr(PPG_AG_IS_WOLF(data_l));
-			sumSheep_pop += is_alive & is_sheep;
-			sumWolves_pop += is_alive & is_wolf;
-			sumSheep_en += select(
-				(agentreduce_uagr) (0),
-				(agentreduce_uagr) (PPG_AG_ENERGY_GET(data_l)),
-				(agentreduce_agr) (is_alive && is_sheep));
-			sumWolves_en += select(
-				(agentreduce_uagr) (0),
-				(agentreduce_uagr) (PPG_AG_ENERGY_GET(data_l)),
-				(agentreduce_agr) (is_alive && is_wolf));
-		}
-	}
-
-	/* Put serial sum in local memory */
-	partial_sums[lid] = sumSheep_pop;
-	partial_sums[group_size + lid] = sumWolves_pop;
-	partial_sums[2 * group_size + lid] = sumSheep_en;
-	partial_sums[3 * group_size + lid] = sumWolves_en;
-
-	/* Wait for all work items to perform previous operation */
-	barrier(CLK_LOCAL_MEM_FENCE);
-
-	/* Reduce */
-	for (int i = group_size / 2; i > 0; i >>= 1) {
-		if (lid < i) {
-			partial_sums[lid] += partial_sums[lid + i];
-			partial_sums[group_size + lid] +=
-				partial_sums[group_size + lid + i];
-			partial_sums[2 * group_size + lid] +=
-				partial_sums[2 * group_size + lid + i];
-			partial_sums[3 * group_size + lid] +=
-				partial_sums[3 * group_size + lid + i];
-		}
-		barrier(CLK_LOCAL_MEM_FENCE);
-	}
-
-	/* Put in global memory */
-	if (lid == 0) {
-		reduce_agent_global[group_id] = partial_sums[0];
-		reduce_agent_global[MAX_LWS + group_id] = partial_sums[group_size];
-		reduce_agent_global[2 * MAX_LWS + group_id] =
-			partial_sums[2 * group_size];
-		reduce_agent_global[3 * MAX_LWS + group_id] =
-			partial_sums[3 * group_size];
-	}
-
-}
-
-/**
- * Agent reduction kernel, part 2.
+ * Derives the grass statistics of the current iteration from those of the
+ * previous iteration, still in the statistics ring, and from the number of
+ * cells eaten by sheep in the current iteration, which is then reset. Must be
+ * launched with a single work-item, instead of the grass reduction kernels,
+ * in all iterations except the first one.
  *
- * @param reduce_agent_global Global level agent counts.
- * @param partial_sums Workgroup level (shared memory) agent counts.
- * @param stats Final agents count.
- * @param num_slots Number of workgroups in step 1.
+ * @param stats Statistics ring, with the grass statistics of the previous
+ * iteration, where those of the current iteration are placed.
+ * @param regrow Regrowth histogram.
+ * @param grass_eaten Number of cells whose grass was eaten in the current
+ * iteration.
+ * @param iter Current iteration.
  * */
- __kernel void reduce_agent2(
-			__global agentreduce_uagr *reduce_agent_global,
-			__local agentreduce_uagr *partial_sums,
-			__global PPStatisticsOcl *stats,
-			uint num_slots) {
-
-	/* Global and local work-item IDs */
-	size_t lid = get_local_id(0);
-	size_t group_size = get_local_size(0);
-
-	/* Load partial sum in local memory */
-	if (lid < num_slots) {
-		partial_sums[lid] = reduce_agent_global[lid];
-		partial_sums[group_size + lid] = reduce_agent_global[MAX_LWS + lid];
-		partial_sums[2 * group_size + lid] =
-			reduce_agent_global[2 * MAX_LWS + lid];
-		partial_sums[3 * group_size + lid] =
-			reduce_agent_global[3 * MAX_LWS + lid];
-	} else {
-		partial_sums[lid] = 0;
-		partial_sums[group_size + lid] = 0;
-		partial_sums[2 * group_size + lid] = 0;
-		partial_sums[3 * group_size + lid] = 0;
-	}
-
-	/* Wait for all work items to perform previous operation */
-	barrier(CLK_LOCAL_MEM_FENCE);
-
-	/* Reduce */
-	for (int i = group_size / 2; i > 0; i >>= 1) {
-		if (lid < i) {
-			partial_sums[lid] += partial_sums[lid + i];
-			partial_sums[group_size + lid] +=
-				partial_sums[group_size + lid + i];
-			partial_sums[2 * group_size + lid] +=
-				partial_sums[2 * group_size + lid + i];
-			partial_sums[3 * group_size + lid] +=
-				partial_sums[3 * group_size + lid + i];
-		}
-		barrier(CLK_LOCAL_MEM_FENCE);
-	}
-
-	/* Put in global memory */
-	if (lid == 0) {
-		stats[0].sheep =
-			(uint) VW_AGENTREDUCE_SUM(partial_sums[0]);
-		stats[0].wolves =
-			(uint) VW_AGENTREDUCE_SUM(partial_sums[group_size]);
-		stats[0].sheep_en =
-			(uint) VW_AGENTREDUCE_SUM(partial_sums[2 * group_size]);
-		stats[0].wolves_en =
-			(uint) VW_AGENTREDUCE_SUM(partial_sums[3 * group_size]);
-	}
+__kernel void grass_stats(
+			__global PPStatisticsOcl * stats,
+			__global uint * regrow,
+			__global uint * grass_eaten,
+			__private uint iter) {
 
+	ppg_grass_stats(stats, regrow, grass_eaten, iter);
 }
 
 /**
  * Agent movement kernel.
  *
+ * Also gathers agent statistics, i.e. the number and total energy of sheep
+ * and wolves before movement, which is the state left by the agent actions
+ * of the previous iteration (or by agent initialization). Statistics are
+ * reduced in local memory and added to the global statistics with one
+ * atomic operation per workgroup and statistic, so the local work size must
+ * be a power of 2.
+ *
+ * If `PPG_MOVE_COUNT` is defined, agents are also counted in the cell they
+ * move to, which is the first step of the counting sort (except in the
+ * last iteration, where agents are not sorted).
+ *
  * @param data The agent data array.
  * @param seeds RNG seeds.
+ * @param partial_sums Workgroup level (shared memory) agent statistics.
+ * @param stats Statistics ring, where agent statistics are accumulated
+ * (must have been reset).
+ * @param agents_num Number of agent slots, past which agents are dead.
+ * @param iter Current iteration.
+ * @param cell_count Number of agents in each cell (only if
+ * `PPG_MOVE_COUNT` is defined), must be zero before this kernel runs.
  */
 __kernel void move_agent(
 			__global uagr *data,
-			__global clo_statetype *seeds)
+			__global clo_statetype *seeds,
+			__local uint *partial_sums,
+			__global PPStatisticsOcl *stats,
+			__global uint *agents_num,
+			__private uint iter
+#ifdef PPG_MOVE_COUNT
+			, __global uint *cell_count
+#endif
+			)
 {
 
-	/* Global id for this work-item */
+	/* Global and local work-item IDs */
 	size_t gid = get_global_id(0);
+	size_t lid = get_local_id(0);
+	size_t group_size = get_local_size(0);
+
+	/* Slots past the agent slots are dead, and are not read. Workgroups
+	 * past them have nothing to move or count. */
+	uint num_agents = *agents_num;
+	if (get_group_id(0) * group_size >= num_agents)
+		return;
 
 	/* Load agent state locally. */
-	uagr data_l = data[gid];
+	uagr data_l;
+	PPG_AG_SET_DEAD(data_l);
+	if (gid < num_agents)
+		data_l = data[gid];
+
+	/* Put agent statistics in local memory. */
+	uint is_sheep = PPG_AG_IS_ALIVE(data_l) && PPG_AG_IS_SHEEP(data_l);
+	uint is_wolf = PPG_AG_IS_ALIVE(data_l) && PPG_AG_IS_WOLF(data_l);
+	uint energy = (uint) PPG_AG_ENERGY_GET(data_l);
+	partial_sums[lid] = is_sheep;
+	partial_sums[group_size + lid] = is_wolf;
+	partial_sums[2 * group_size + lid] = select((uint) 0, energy, is_sheep);
+	partial_sums[3 * group_size + lid] = select((uint) 0, energy, is_wolf);
 
 	/* Only perform if agent is alive. */
 	if (PPG_AG_IS_ALIVE(data_l)) {
@@ -812,12 +972,637 @@ __kernel void move_agent(
 			/* Otherwise update agent location. */
 			PPG_AG_XY_SET(data_l, xy_l.x, xy_l.y);
 			PPG_AG_HASH_SET(data_l, clo_rng_next_int(seeds, 0x7fff));
+#ifdef PPG_MOVE_COUNT
+			/* Count agent in its new cell. */
+			if (iter < ITERS)
+				atomic_inc(&cell_count[PPG_SORT_KEY(data_l)]);
+#endif
 		}
 		/* Update global mem */
 		data[gid] = data_l;
 
 	}
 
+	/* Wait for all work items to put statistics in local memory */
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	/* Reduce */
+	for (int i = group_size / 2; i > 0; i >>= 1) {
+		if (lid < i) {
+			partial_sums[lid] += partial_sums[lid + i];
+			partial_sums[group_size + lid] +=
+				partial_sums[group_size + lid + i];
+			partial_sums[2 * group_size + lid] +=
+				partial_sums[2 * group_size + lid + i];
+			partial_sums[3 * group_size + lid] +=
+				partial_sums[3 * group_size + lid + i];
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	/* Add workgroup statistics to global statistics */
+	if (lid == 0) {
+		stats += PPG_STATS_SLOT(iter);
+		atomic_add(&stats->sheep, partial_sums[0]);
+		atomic_add(&stats->wolves, partial_sums[group_size]);
+		atomic_add(&stats->sheep_en, partial_sums[2 * group_size]);
+		atomic_add(&stats->wolves_en, partial_sums[3 * group_size]);
+	}
+
+}
+
+/**
+ * Integer hash, used to derive random values which only depend on the
+ * given value.
+ *
+ * @param x Value to hash.
+ * @return Hash of the given value.
+ * */
+uint ppg_hash(uint x) {
+
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+/**
+ * Random permutation of the agents in a cell, used by the counting sort
+ * in order to shuffle agents within each cell. The permutation is the
+ * affine map `rank -> (a * rank + b) % n`, where `a` is coprime with `n`
+ * and `a` and `b` are derived from the cell and the current iteration.
+ *
+ * @param rank Rank of agent in cell, between 0 and `n - 1`.
+ * @param n Number of agents in cell.
+ * @param cell_idx Cell index.
+ * @param iter Current iteration.
+ * @return Position of agent in cell, between 0 and `n - 1`.
+ * */
+uint ppg_sort_perm(uint rank, uint n, uint cell_idx, uint iter) {
+
+	uint h = ppg_hash(cell_idx ^ ppg_hash(iter));
+	uint a = (h >> 16) % n + 1;
+	uint b = (h & 0xffff) % n;
+	uint x, y;
+
+	/* Increment a until it is coprime with n (Euclid's algorithm). This
+	 * terminates at the latest when a is a multiple of n plus one. */
+	for (;;) {
+		for (x = a, y = n; y > 0; ) {
+			uint t = x % y;
+			x = y;
+			y = t;
+		}
+		if (x == 1) break;
+		a++;
+	}
+
+	/* In 64 bits, as the product overflows 32 bits in crowded cells. */
+	return (uint) (((ulong) a * rank + b) % n);
+}
+
+/**
+ * Workgroup level inclusive scan. Must be called by all work-items in the
+ * workgroup.
+ *
+ * @param scan Workgroup level (shared memory) scan.
+ * @param value Value to scan.
+ * @return Sum of the values of this and previous work-items.
+ * */
+uint ppg_scan_local(__local uint *scan, uint value) {
+
+	/* Local work-item ID */
+	size_t lid = get_local_id(0);
+	size_t group_size = get_local_size(0);
+
+	/* Load value in local memory */
+	scan[lid] = value;
+
+	/* Wait for all work items to perform previous operation */
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	/* Inclusive scan */
+	for (uint offset = 1; offset < group_size; offset <<= 1) {
+		uint x = (lid >= offset) ? scan[lid - offset] : 0;
+		barrier(CLK_LOCAL_MEM_FENCE);
+		scan[lid] += x;
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	return scan[lid];
+}
+
+/**
+ * Exclusive scan of a per agent slot value at the given slot, from its
+ * workgroup level scan and the scanned workgroup totals.
+ *
+ * @param slots Scan before each slot, relative to the slot's workgroup.
+ * @param slot_sums Scan before the slots of each workgroup.
+ * @param slot Agent slot, may be one past the last agent.
+ * @param block_size Local work size of the workgroup level scan.
+ * @return Sum of the values of the slots before the given slot.
+ * */
+uint ppg_scan_get(__global uint *slots, __global uint *slot_sums,
+	uint slot, uint block_size) {
+
+	return slot_sums[slot / block_size] + slots[slot];
+}
+
+/**
+ * Counting sort, step 1: count alive agents in each cell.
+ *
+ * Agents are sorted by their sort key, i.e. by cell or, if `PPG_SORT_TYPED`
+ * is defined, by cell and type. In the counting sort kernels, cells stand
+ * for sort keys.
+ *
+ * If `PPG_SORT_INC` is defined, agents still within the slots their cell
+ * took in the previous sort are stayers. They are not counted, and are
+ * scanned within each workgroup instead, so that they can keep their
+ * order.
+ *
+ * @param data The agent data array.
+ * @param cell_count Number of agents in each cell, must be zero before
+ * this kernel runs (which the scatter step ensures).
+ * @param agents_num Number of agent slots, past which agents are dead.
+ * @param cell_sort Cell layout of previous sort (see step 2).
+ * @param block_sums Cell layout of previous sort (see step 3).
+ * @param slots Stayers before each slot, relative to the slot's workgroup.
+ * @param slot_sums Number of stayers in each workgroup.
+ * @param scan Workgroup level (shared memory) scan.
+ * */
+__kernel void sort_count(
+			__global uagr *data,
+			__global uint *cell_count,
+			__global uint *agents_num
+#ifdef PPG_SORT_INC
+			, __global uint2 *cell_sort,
+			__global uint *block_sums,
+			__global uint *slots,
+			__global uint *slot_sums,
+			__local uint *scan
+#endif
+			)
+{
+	/* Agent to be handled by this workitem. */
+	size_t gid = get_global_id(0);
+
+#ifdef PPG_SORT_INC
+
+	size_t lid = get_local_id(0);
+	size_t group_size = get_local_size(0);
+	uint stayer = 0;
+
+	/* Workgroups past the slot after the last agent have no stayers. */
+	if (get_group_id(0) * group_size > *agents_num) {
+		if (lid == 0)
+			slot_sums[get_group_id(0)] = 0;
+		return;
+	}
+
+	/* Slots past the agent slots are dead, and are not read. */
+	uagr data_l;
+	PPG_AG_SET_DEAD(data_l);
+	if (gid < *agents_num)
+		data_l = data[gid];
+
+	if (PPG_AG_IS_ALIVE(data_l)) {
+
+		/* Slots taken by the agent's cell in the previous sort. */
+		uint cell_idx = PPG_SORT_KEY(data_l);
+		uint2 cs = cell_sort[cell_idx];
+		uint start = block_sums[cell_idx / group_size] + cs.s0;
+
+		stayer = (gid >= start) && (gid < start + cs.s1);
+		if (!stayer)
+			atomic_inc(&cell_count[cell_idx]);
+	}
+
+	/* Exclusive scan of stayers within workgroup. */
+	uint stayers = ppg_scan_local(scan, stayer);
+	slots[gid] = stayers - stayer;
+	if (lid == group_size - 1)
+		slot_sums[get_group_id(0)] = stayers;
+
+#else
+
+	if (gid >= *agents_num)
+		return;
+
+	uagr data_l = data[gid];
+	if (PPG_AG_IS_ALIVE(data_l))
+		atomic_inc(&cell_count[PPG_SORT_KEY(data_l)]);
+
+#endif
+}
+
+/**
+ * Counting sort, step 2: exclusive scan of cell counts within each
+ * workgroup.
+ *
+ * If `PPG_SORT_INC` is defined, the stayers of each cell are found from
+ * the previous cell layout and the scan of stayers, and added to the
+ * cell count.
+ *
+ * @param cell_count Number of agents in each cell.
+ * @param cell_sort Start of each cell relative to its workgroup, and
+ * number of agents in each cell.
+ * @param block_sums Number of agents in the cells of each workgroup.
+ * @param scan Workgroup level (shared memory) scan.
+ * @param cell_stay Stayers before the first slot of each cell in the
+ * previous sort, and number of stayers in each cell.
+ * @param slots Stayers before each slot, relative to the slot's workgroup
+ * in step 1.
+ * @param slot_sums Stayers before the slots of each workgroup in step 1.
+ * */
+__kernel void sort_scan(
+			__global uint *cell_count,
+			__global uint2 *cell_sort,
+			__global uint *block_sums,
+			__local uint *scan
+#ifdef PPG_SORT_INC
+			, __global uint2 *cell_stay,
+			__global uint *slots,
+			__global uint *slot_sums
+#endif
+			)
+{
+	/* Global and local work-item IDs */
+	size_t gid = get_global_id(0);
+	size_t lid = get_local_id(0);
+	size_t group_size = get_local_size(0);
+
+	/* Cell count */
+	uint count = (gid < PPG_SORT_KEY_NUM) ? cell_count[gid] : 0;
+
+#ifdef PPG_SORT_INC
+	/* Stayers in cell, within the slots it took in the previous sort,
+	 * which is read before being replaced. */
+	if (gid < PPG_SORT_KEY_NUM) {
+		uint2 cs = cell_sort[gid];
+		uint start = block_sums[get_group_id(0)] + cs.s0;
+		uint2 stay;
+		stay.s0 = ppg_scan_get(slots, slot_sums, start, group_size);
+		stay.s1 = ppg_scan_get(slots, slot_sums, start + cs.s1,
+			group_size) - stay.s0;
+		cell_stay[gid] = stay;
+		count += stay.s1;
+	}
+#endif
+
+	/* Inclusive scan */
+	uint sum = ppg_scan_local(scan, count);
+
+	/* Put in global memory */
+	if (gid < PPG_SORT_KEY_NUM)
+		cell_sort[gid] = (uint2) (sum - count, count);
+	if (lid == group_size - 1)
+		block_sums[get_group_id(0)] = sum;
+}
+
+/**
+ * Exclusive scan of the workgroup totals of a workgroup level scan, i.e.
+ * step 3 of the counting sort, where the cell counts of step 2 are
+ * scanned. It also scans the stayers of step 1 of the incremental counting
+ * sort, and is step 2 of the agent compaction. Must be launched with a
+ * single workgroup, each work-item handling a contiguous chunk of totals.
+ * The overall total is placed after the scanned totals.
+ *
+ * @param block_sums Totals of each workgroup on input, start of each
+ * workgroup on output.
+ * @param scan Workgroup level (shared memory) scan.
+ * @param num_blocks Number of workgroups of the workgroup level scan.
+ * */
+__kernel void scan_blocks(
+			__global uint *block_sums,
+			__local uint *scan,
+			__private uint num_blocks)
+{
+	/* Local work-item ID */
+	size_t lid = get_local_id(0);
+	size_t group_size = get_local_size(0);
+
+	/* Chunk of totals handled by this work-item */
+	uint chunk = PP_DIV_CEIL(num_blocks, group_size);
+	uint first = min((uint) lid * chunk, num_blocks);
+	uint last = min(first + chunk, num_blocks);
+
+	/* Serial sum */
+	uint sum = 0;
+	for (uint i = first; i < last; i++)
+		sum += block_sums[i];
+
+	/* Inclusive scan */
+	uint total = ppg_scan_local(scan, sum);
+
+	/* Serial exclusive scan, put in global memory */
+	uint start = total - sum;
+	for (uint i = first; i < last; i++) {
+		uint x = block_sums[i];
+		block_sums[i] = start;
+		start += x;
+	}
+	if (lid == group_size - 1)
+		block_sums[num_blocks] = total;
+}
+
+/**
+ * Counting sort, step 4: scatter alive agents to their cells in the output
+ * agent array, shuffled within each cell. Slots of the output agent array
+ * after the last alive agent are marked as dead, up to `num_slots`.
+ *
+ * @param data_in The agent data array.
+ * @param data_out The output agent data array.
+ * @param cell_count Number of agents in each cell, reset to zero.
+ * @param cell_sort Start of each cell relative to its workgroup in step 2,
+ * and number of agents in each cell.
+ * @param block_sums Start of the cells of each workgroup in step 2, followed
+ * by the total number of agents.
+ * @param block_size Local work size of step 2.
+ * @param num_blocks Number of workgroups in step 2.
+ * @param num_slots Number of agent slots to handle.
+ * @param iter Current iteration.
+ * @param agents_num Number of agent slots, past which agents are dead.
+ * @param cell_stay Stayers before the first slot of each cell in the
+ * previous sort, and number of stayers in each cell.
+ * @param slots Stayers before each slot, relative to the slot's workgroup
+ * in step 1.
+ * @param slot_sums Stayers before the slots of each workgroup in step 1.
+ * */
+__kernel void sort_scatter(
+			__global uagr *data_in,
+			__global uagr *data_out,
+			__global uint *cell_count,
+			__global uint2 *cell_sort,
+			__global uint *block_sums,
+			__private uint block_size,
+			__private uint num_blocks,
+			__private uint num_slots,
+			__private uint iter,
+			__global uint *agents_num
+#ifdef PPG_SORT_INC
+			, __global uint2 *cell_stay,
+			__global uint *slots,
+			__global uint *slot_sums
+#endif
+			)
+{
+	/* Agent to be handled by this workitem. */
+	size_t gid = get_global_id(0);
+
+	if (gid < num_slots) {
+
+		/* Slots past the agent slots only hold dead agents, which are
+		 * not read. */
+		uagr data_l;
+		PPG_AG_SET_DEAD(data_l);
+		if (gid < *agents_num)
+			data_l = data_in[gid];
+
+		if (PPG_AG_IS_ALIVE(data_l)) {
+
+			/* Determine agent position from its cell and its rank in
+			 * the cell, given by the decreasing cell count. */
+			uint cell_idx = PPG_SORT_KEY(data_l);
+			uint2 cs = cell_sort[cell_idx];
+			uint pos = block_sums[cell_idx / block_size] + cs.s0;
+
+#ifdef PPG_SORT_INC
+			/* Stayers keep their order, at the start of the cell, and
+			 * only the other agents are ranked and shuffled. */
+			uint2 stay = cell_stay[cell_idx];
+			uint stayers = ppg_scan_get(
+				slots, slot_sums, gid, block_size);
+
+			if (ppg_scan_get(slots, slot_sums, gid + 1, block_size)
+				> stayers) {
+				pos += stayers - stay.s0;
+			} else {
+				uint rank = atomic_dec(&cell_count[cell_idx]) - 1;
+				pos += stay.s1
+					+ ppg_sort_perm(rank, cs.s1 - stay.s1, cell_idx, iter);
+			}
+#else
+			uint rank = atomic_dec(&cell_count[cell_idx]) - 1;
+			pos += ppg_sort_perm(rank, cs.s1, cell_idx, iter);
+#endif
+
+			data_out[pos] = data_l;
+		}
+
+		/* Mark slots after the last alive agent as dead. */
+		if (gid >= block_sums[num_blocks]) {
+			PPG_AG_SET_DEAD(data_l);
+			data_out[gid] = data_l;
+		}
+	}
+}
+
+#ifdef PPG_RESOLVE_RANKED
+
+/**
+ * Counting sort, step 5 (only if `PPG_RESOLVE_RANKED` is defined): put the
+ * agents with each key in a canonical order, given by a hash of each agent
+ * which depends on the key and on the current iteration, with ties broken
+ * by agent value. Agent ranks in the scatter step depend on the order of
+ * atomic operations, while this order only depends on the agents
+ * themselves. Each work-item insertion sorts the agents with one key, so
+ * the kernel must be launched with the work sizes of step 2.
+ *
+ * If `PPG_SORT_INC` is defined, stayers keep their place at the start of
+ * the cell, and only the remaining agents are sorted.
+ *
+ * @param data The (sorted) agent data array.
+ * @param cell_sort Start of each cell relative to its workgroup in step 2,
+ * and number of agents in each cell.
+ * @param block_sums Start of the cells of each workgroup in step 2.
+ * @param iter Current iteration.
+ * @param cell_stay Stayers before the first slot of each cell in the
+ * previous sort, and number of stayers in each cell.
+ * */
+__kernel void sort_order(
+			__global uagr *data,
+			__global uint2 *cell_sort,
+			__global uint *block_sums,
+			__private uint iter
+#ifdef PPG_SORT_INC
+			, __global uint2 *cell_stay
+#endif
+			)
+{
+	/* Key to be handled by this workitem. */
+	size_t gid = get_global_id(0);
+
+	if (gid >= PPG_SORT_KEY_NUM)
+		return;
+
+	/* Slots taken by the agents with this key. */
+	uint2 cs = cell_sort[gid];
+	uint start = block_sums[get_group_id(0)] + cs.s0;
+	uint end = start + cs.s1;
+#ifdef PPG_SORT_INC
+	start += cell_stay[gid].s1;
+#endif
+
+	/* Insertion sort, cells hold few agents. */
+	uint salt = ppg_hash((uint) gid ^ ppg_hash(iter));
+	for (uint i = start + 1; i < end; i++) {
+		uagr x = data[i];
+		uint hx = ppg_hash((uint) x ^ salt);
+		uint j;
+		for (j = i; j > start; j--) {
+			uagr y = data[j - 1];
+			uint hy = ppg_hash((uint) y ^ salt);
+			if ((hy < hx) || ((hy == hx) && (y <= x)))
+				break;
+			data[j] = y;
+		}
+		data[j] = x;
+	}
+}
+
+#endif
+
+/**
+ * Agent compaction, step 1: exclusive scan of alive agents within each
+ * workgroup. Step 2 is the scan of workgroup totals.
+ *
+ * @param data The agent data array.
+ * @param slots Alive agents before each slot, relative to the slot's
+ * workgroup.
+ * @param slot_sums Number of alive agents in each workgroup.
+ * @param scan Workgroup level (shared memory) scan.
+ * @param agents_num Number of agent slots before the agent actions, which
+ * place newborns at most that many slots past them.
+ * */
+__kernel void compact_scan(
+			__global uagr *data,
+			__global uint *slots,
+			__global uint *slot_sums,
+			__local uint *scan,
+			__global uint *agents_num)
+{
+	/* Global and local work-item IDs */
+	size_t gid = get_global_id(0);
+	size_t lid = get_local_id(0);
+	size_t group_size = get_local_size(0);
+
+	/* Slots past the last newborn are dead, and are not read. Workgroups
+	 * past the slot after them have no alive agents. */
+	uint num_slots = 2 * *agents_num;
+	if (get_group_id(0) * group_size > num_slots) {
+		if (lid == 0)
+			slot_sums[get_group_id(0)] = 0;
+		return;
+	}
+
+	/* Exclusive scan of alive agents within workgroup. */
+	uint alive = (gid < num_slots) && PPG_AG_IS_ALIVE(data[gid]) ? 1 : 0;
+	uint sum = ppg_scan_local(scan, alive);
+	slots[gid] = sum - alive;
+	if (lid == group_size - 1)
+		slot_sums[get_group_id(0)] = sum;
+}
+
+#ifdef PPG_SORT_INC
+
+/**
+ * Agent compaction, step 3 (only with the incremental counting sort):
+ * update the cell layout of the previous sort to where the compaction
+ * moves the alive agents of each cell, so that the agents which stay in
+ * their cell can still be found. The compaction preserves the order of
+ * alive agents, so each cell still takes a contiguous range of slots.
+ *
+ * @param cell_sort Start of each cell relative to its workgroup, and
+ * number of agents in each cell.
+ * @param block_sums Start of the cells of each workgroup.
+ * @param slots Alive agents before each slot, relative to the slot's
+ * workgroup in step 1.
+ * @param slot_sums Alive agents before the slots of each workgroup in
+ * step 1.
+ * */
+__kernel void compact_layout(
+			__global uint2 *cell_sort,
+			__global uint *block_sums,
+			__global uint *slots,
+			__global uint *slot_sums)
+{
+	/* Global and local work-item IDs */
+	size_t gid = get_global_id(0);
+	size_t lid = get_local_id(0);
+	size_t group_size = get_local_size(0);
+
+	/* Slots taken by the cells of this workgroup, which are read before
+	 * being replaced. */
+	uint block_start = block_sums[get_group_id(0)];
+	uint2 cs = (gid < PPG_SORT_KEY_NUM) ? cell_sort[gid] : (uint2) (0, 0);
+
+	/* Wait for all work items to perform previous operation */
+	barrier(CLK_GLOBAL_MEM_FENCE);
+
+	/* Slots taken after compaction. */
+	uint start = ppg_scan_get(slots, slot_sums, block_start + cs.s0,
+		group_size);
+	uint end = ppg_scan_get(slots, slot_sums, block_start + cs.s0 + cs.s1,
+		group_size);
+	block_start = ppg_scan_get(slots, slot_sums, block_start, group_size);
+
+	if (gid < PPG_SORT_KEY_NUM)
+		cell_sort[gid] = (uint2) (start - block_start, end - start);
+	if (lid == 0)
+		block_sums[get_group_id(0)] = block_start;
+}
+
+#endif
+
+/**
+ * Agent compaction, step 4: pack alive agents, in order, at the start of
+ * the output agent array. Slots of the output agent array after the last
+ * alive agent are marked as dead, up to `num_slots`.
+ *
+ * @param data_in The agent data array.
+ * @param data_out The output agent data array.
+ * @param slots Alive agents before each slot, relative to the slot's
+ * workgroup in step 1.
+ * @param slot_sums Alive agents before the slots of each workgroup in
+ * step 1, followed by the total number of alive agents.
+ * @param num_blocks Number of workgroups in step 1.
+ * @param num_slots Number of agent slots to handle.
+ * @param agents_num Number of agent slots before the agent actions, which
+ * place newborns at most that many slots past them.
+ * */
+__kernel void compact_scatter(
+			__global uagr *data_in,
+			__global uagr *data_out,
+			__global uint *slots,
+			__global uint *slot_sums,
+			__private uint num_blocks,
+			__private uint num_slots,
+			__global uint *agents_num)
+{
+	/* Agent to be handled by this workitem. */
+	size_t gid = get_global_id(0);
+
+	if (gid < num_slots) {
+
+		/* Slots past the last newborn only hold dead agents, which are
+		 * not read. */
+		uagr data_l;
+		PPG_AG_SET_DEAD(data_l);
+		if (gid < 2 * *agents_num)
+			data_l = data_in[gid];
+
+		if (PPG_AG_IS_ALIVE(data_l))
+			data_out[ppg_scan_get(slots, slot_sums, gid,
+				get_local_size(0))] = data_l;
+
+		/* Mark slots after the last alive agent as dead. */
+		if (gid >= slot_sums[num_blocks]) {
+			PPG_AG_SET_DEAD(data_l);
+			data_out[gid] = data_l;
+		}
+	}
 }
 
 /**
@@ -828,38 +1613,74 @@ __kernel void move_agent(
  * will only have to write to an 32-bit address instead of the full
  * 64-bit space occupied by a start and end index.
  *
+ * If `PPG_SORT_TYPED` is defined, only the sheep of each cell, which are
+ * sorted before its wolves, are indexed, as only wolves look them up.
+ *
+ * If `PPG_FUSED` is defined, the agents index in cell array is not reset
+ * beforehand. Instead, the first agent of each cell tags it with the
+ * iteration in which agents act, and entries with older tags are stale.
+ *
  * @param data The agent data array.
  * @param cell_agents_idx The agents index in cell array.
+ * @param agents_num Number of agent slots, past which agents are dead.
+ * @param cell_agents_epoch Iteration with which the agents index of each
+ * cell was tagged (only if `PPG_FUSED` is defined).
+ * @param iter Iteration in which agents act (only if `PPG_FUSED` is
+ * defined).
  * */
 __kernel void find_cell_idx(
 			__global uagr *data,
-			__global uint *cell_agents_idx)
+			__global uint *cell_agents_idx,
+			__global uint *agents_num
+#ifdef PPG_FUSED
+			, __global uint *cell_agents_epoch,
+			__private uint iter
+#endif
+			)
 {
 
 	/* Agent to be handled by this workitem. */
 	size_t gid = get_global_id(0);
 
+	if (gid >= *agents_num)
+		return;
+
 	uagr data_l = data[gid];
 
-	/* Only perform this if agent is alive. */
+	/* Only perform this if agent is alive (and a sheep, with the typed
+	 * order). */
+#ifdef PPG_SORT_TYPED
+	if (PPG_AG_IS_ALIVE(data_l) && PPG_AG_IS_SHEEP(data_l)) {
+#else
 	if (PPG_AG_IS_ALIVE(data_l)) {
+#endif
 
 		/* Find cell where this agent is located... */
 		uint cell_idx = 2 * PPG_CELL_IDX(data_l);
 
 		/* Check if this agent is the start of a cell index. */
+		uagr data_next = data[gid + 1];
 		ushort2 xy_current = PPG_AG_XY_GET(data_l);
 		ushort2 xy_prev = PPG_AG_XY_GET(data[max((int) (gid - 1), (int) 0)]);
-		ushort2 xy_next = PPG_AG_XY_GET(data[gid + 1]);
+		ushort2 xy_next = PPG_AG_XY_GET(data_next);
 
 		ushort2 diff_prev = xy_current - xy_prev;
 		ushort2 diff_next = xy_current - xy_next;
 
 		if ((gid == 0) || any(diff_prev != ((ushort2) (0, 0)))) {
 			cell_agents_idx[cell_idx] = gid;
+#ifdef PPG_FUSED
+			cell_agents_epoch[cell_idx / 2] = iter;
+#endif
 		}
-		/* Check if this agent is the end of a cell index. */
+		/* Check if this agent is the end of a cell index, i.e. the last
+		 * sheep in the cell with the typed order. */
+#ifdef PPG_SORT_TYPED
+		if (any(diff_next != ((ushort2) (0, 0)))
+			|| !PPG_AG_IS_SHEEP(data_next)) {
+#else
 		if (any(diff_next != ((ushort2) (0, 0)))) {
+#endif
 			cell_agents_idx[cell_idx + 1] = gid;
 		}
 	}
@@ -873,26 +1694,85 @@ __kernel void find_cell_idx(
  * Sheep try to eat grass.
  * Both types of agent try to reproduce.
  *
+ * If `PPG_REPRO_APPEND` is defined, newborns are appended contiguously,
+ * after being staged in local memory.
+ *
+ * If `PPG_SORT_TYPED` is defined, the agents index in cell array only
+ * covers sheep, and wolves pick the sheep to eat by their rank.
+ *
+ * If `PPG_RESOLVE_RANKED` is defined, conflicts are decided by rank
+ * without atomics, as if sheep acted before wolves: only the first sheep
+ * in the cell may eat its grass, and the k-th wolf eats the k-th sheep,
+ * which finds its wolf and marks itself as dead.
+ *
  * @param grass Grass counters (0 means grass is alive).
  * @param cell_agents_idx Agent start and end indexes in cell.
  * @param data The agent data array.
  * @param data_half The agent data array, allows direct access to upper or lower
  * half of the agent data.
  * @param seeds RNG seeds.
+ * @param iter Current iteration.
+ * @param grass_eaten Number of cells whose grass was eaten in the current
+ * iteration (only updated if `PP_GRASS_STATS_INC` is defined).
+ * @param stats Statistics ring, agent statistics of the next iteration are
+ * reset.
+ * @param agents_num Number of agent slots, past which agents are dead.
+ * Newborns are placed in the slots after them.
+ * @param births Number of newborns appended in the current iteration (only
+ * if `PPG_REPRO_APPEND` is defined), must be zero before the kernel runs.
+ * @param newborns Local memory for the newborns of the workgroup (only if
+ * `PPG_REPRO_APPEND` is defined).
+ * @param cell_agents_epoch Iteration with which the agents index of each
+ * cell was tagged (only if `PPG_FUSED` is defined), stale if not the
+ * current one.
  */
 __kernel void action_agent(
 			__global uint *grass,
 			__global uint2 *cell_agents_idx,
 			__global uagr *data,
 			__global uagr_half *data_half,
-			__global clo_statetype *seeds)
+			__global clo_statetype *seeds,
+			__private uint iter,
+			__global uint *grass_eaten,
+			__global PPStatisticsOcl *stats,
+			__global uint *agents_num
+#ifdef PPG_REPRO_APPEND
+			, __global uint *births
+			, __local uagr *newborns
+#endif
+#ifdef PPG_FUSED
+			, __global uint *cell_agents_epoch
+#endif
+			)
 {
 
 	/* Global id for this workitem */
 	size_t gid = get_global_id(0);
 
+#ifdef PPG_REPRO_APPEND
+	/* Local id for this workitem */
+	size_t lid = get_local_id(0);
+
+	/* How many newborns there are in this workgroup, and where they go. */
+	__local uint newborns_count, newborns_start;
+
+	if (lid == 0)
+		newborns_count = 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+#endif
+
+	/* Reset agent statistics, gathered again when agents move. */
+	if (gid == 0)
+		ppg_agent_stats_reset(stats + PPG_STATS_SLOT(iter));
+
+	/* Number of agent slots, past which agents are dead and not read. */
+	uint num_agents = *agents_num;
+
 	/* Get agent for this workitem */
-	uagr data_l = data[gid];
+	uagr data_l;
+	PPG_AG_SET_DEAD(data_l);
+	if (gid < num_agents)
+		data_l = data[gid];
 
 	/* Get cell index where agent is */
 	uint cell_idx = PPG_CELL_IDX(data_l);
@@ -900,6 +1780,11 @@ __kernel void action_agent(
 	/* Reproduction threshold and probability (used further ahead) */
 	uchar reproduce_threshold, reproduce_prob;
 
+#ifdef PPG_RESOLVE_RANKED
+	/* Was this agent (a sheep) eaten by a wolf? */
+	bool eaten = false;
+#endif
+
 	/* Perform specific agent actions */
 
 	if (PPG_AG_IS_ALIVE(data_l)) {
@@ -911,12 +1796,44 @@ __kernel void action_agent(
 			reproduce_threshold = SHEEP_REPRODUCE_THRESHOLD;
 			reproduce_prob = SHEEP_REPRODUCE_PROB;
 
+#ifdef PPG_RESOLVE_RANKED
+			/* Sheep are indexed in their own cell in this iteration. */
+			uint2 cai = cell_agents_idx[cell_idx];
+			uint rank = (uint) gid - cai.s0;
+
+			/* If there is grass and I am the first sheep in the cell, eat
+			 * it, no one else will. */
+			uint grass_l = grass[cell_idx];
+			if ((rank == 0) && PP_GRASS_ALIVE(grass_l, iter)) {
+				grass[cell_idx] = PP_GRASS_EATEN(iter, GRASS_RESTART);
+				PPG_AG_ENERGY_ADD(data_l, SHEEP_GAIN_FROM_FOOD);
+#ifdef PP_GRASS_STATS_INC
+				atomic_inc(grass_eaten);
+#endif
+			}
+
+			/* I am eaten if there is a wolf with my rank, which wolves
+			 * only update in their lower half. */
+			uint wolf = cai.s1 + 1 + rank;
+			if (wolf < num_agents) {
+				uagr wolf_l = data[wolf];
+				eaten = PPG_AG_IS_ALIVE(wolf_l) && PPG_AG_IS_WOLF(wolf_l)
+					&& (PPG_CELL_IDX(wolf_l) == cell_idx);
+			}
+#else
 			/* If there is grass, eat it (and I can be the only one to do so) */
-			if (atomic_cmpxchg(&grass[cell_idx], (uint) 0, GRASS_RESTART) == 0)
+			uint grass_l = grass[cell_idx];
+			if (PP_GRASS_ALIVE(grass_l, iter)
+				&& (atomic_cmpxchg(&grass[cell_idx], grass_l,
+					PP_GRASS_EATEN(iter, GRASS_RESTART)) == grass_l))
 			{ /// @todo Maybe a atomic_or or something would be faster
 				/* If grass is alive, sheep eats it and gains energy */
 				PPG_AG_ENERGY_ADD(data_l, SHEEP_GAIN_FROM_FOOD);
+#ifdef PP_GRASS_STATS_INC
+				atomic_inc(grass_eaten);
+#endif
 			}
+#endif
 
 		} else if (PPG_AG_IS_WOLF(data_l)) {
 			/* Agent is wolf, perform wolf actions. */
@@ -928,7 +1845,33 @@ __kernel void action_agent(
 
 			/* Cycle through agents in this cell */
 			uint2 cai = cell_agents_idx[cell_idx];
+#ifdef PPG_FUSED
+			if (cell_agents_epoch[cell_idx] != iter)
+				cai = (uint2) (MAX_AGENTS, MAX_AGENTS);
+#endif
 			if (cai.s0 < MAX_AGENTS) {
+#if defined(PPG_RESOLVE_RANKED)
+				/* Only the sheep in this cell are indexed, and its wolves
+				 * follow them. The k-th wolf eats the k-th sheep, if any,
+				 * which marks itself as dead. */
+				if ((uint) gid - cai.s1 - 1 < cai.s1 - cai.s0 + 1)
+					PPG_AG_ENERGY_ADD(data_l, WOLVES_GAIN_FROM_FOOD);
+#elif defined(PPG_SORT_TYPED)
+				/* Only the sheep in this cell are indexed, and its wolves
+				 * follow them. Each wolf first tries to eat the sheep given
+				 * by its rank among the wolves, so that wolves do not all
+				 * contend for the first sheep, and only tries the
+				 * following ones if it was already eaten. */
+				uint num_sheep = cai.s1 - cai.s0 + 1;
+				uint i = cai.s0 + ((uint) gid - cai.s1 - 1) % num_sheep;
+				for (uint k = 0; k < num_sheep; k++) {
+					if (PPG_ATOMIC_TRY_KILL(i, data, data_half)) {
+						PPG_AG_ENERGY_ADD(data_l, WOLVES_GAIN_FROM_FOOD);
+						break;
+					}
+					i = (i == cai.s1) ? cai.s0 : i + 1;
+				}
+#else
 				for (uint i = cai.s0; i <= cai.s1; i++) {
 					uagr possibleSheep = data[i];
 					if (PPG_AG_IS_SHEEP(possibleSheep)) {
@@ -941,6 +1884,7 @@ __kernel void action_agent(
 						}
 					}
 				}
+#endif
 			}
 		}
 
@@ -951,9 +1895,13 @@ __kernel void action_agent(
 			if (clo_rng_next_int(seeds, 100) < reproduce_prob) {
 
 				/* Agent will reproduce! */
-				size_t pos_new = get_global_size(0) + gid;
 				uagr data_new = PPG_AG_REPRODUCE(data_l);
+#ifdef PPG_REPRO_APPEND
+				newborns[atomic_inc(&newborns_count)] = data_new;
+#else
+				size_t pos_new = num_agents + gid;
 				data[pos_new] = data_new;
+#endif
 
 				/* Current agent's energy will be halved also */
 				PPG_AG_ENERGY_SUB(data_l, PPG_AG_ENERGY_GET(data_new));
@@ -961,19 +1909,26 @@ __kernel void action_agent(
 			}
 		}
 
-		/* @ALTERNATIVE for agent reproduction:
-		 * 1 - Create new agents in workgroup local memory using a local
-		 * atomic counter to determine new agent index.
-		 * 2 - In the end of the workitem put a workgroup local mem
-		 * barrier, then push new agents in a coalesced fashion to
-		 * global memory using a global atomic counter to determine
-		 * the index of the first agent in the group.
-		 * - Problems: the additional complexity and the use of atomics
-		 * will probably not allow for any performance improvements. */
-
 		/* My actions only affect my data (energy), so I will only put back data
-		 * (energy)... */
+		 * (energy)... unless I was eaten. */
+#ifdef PPG_RESOLVE_RANKED
+		if (eaten) {
+			PPG_AG_SET_DEAD(data_l);
+			data[gid] = data_l;
+		} else
+#endif
 		PPG_AG_STORE_LO(data_l, gid, data_half);
 
 	}
+
+#ifdef PPG_REPRO_APPEND
+	/* Reserve room for the newborns of this workgroup with a single global
+	 * atomic, then push them to global memory in a coalesced fashion. */
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if ((lid == 0) && (newborns_count > 0))
+		newborns_start = atomic_add(births, newborns_count);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if (lid < newborns_count)
+		data[num_agents + newborns_start + lid] = newborns[lid];
+#endif
 }
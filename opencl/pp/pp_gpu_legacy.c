@@ -223,7 +223,7 @@ finish:
  *
  * @param[in] argc See `argv`.
  * @param[in] argv All input parameters will be considered compiler
- * options.
+ * options, e.g. `-D PP_GRASS_LAZY` selects the lazy grass representation.
  * @return ::PP_SUCCESS if simulation terminates properly, or another
  * ::pp_error_codes error code otherwise.
  * */
@@ -516,7 +516,8 @@ int main(int argc, char* argv[]) {
 	/* Agent actions kernel */
 	ccl_kernel_set_args(agentaction_kernel, agentArrayDevice,
 		grassMatrixDevice, ccl_arg_priv(sim_params, PPGSSimParams),
-		agentParamsDevice, rngSeedsDevice, numAgentsDevice, NULL);
+		agentParamsDevice, rngSeedsDevice, numAgentsDevice, iterDevice,
+		NULL);
 
 	/* Count agents */
 	ccl_kernel_set_args(countagents1_kernel,
@@ -530,7 +531,7 @@ int main(int argc, char* argv[]) {
 	/* Count grass */
 	ccl_kernel_set_args(countgrass1_kernel, grassMatrixDevice,
 		grassCountDevice, ccl_arg_local(grasscount1_lws, cl_uint),
-		ccl_arg_priv(sim_params, PPGSSimParams), NULL);
+		ccl_arg_priv(sim_params, PPGSSimParams), iterDevice, NULL);
 
 	ccl_kernel_set_args(countgrass2_kernel, grassCountDevice,
 		ccl_arg_local(grasscount2_gws[0], cl_uint), ccl_arg_skip,
@@ -21,6 +21,9 @@
 /**
  * @file
  * OpenCL kernels for the legacy predator-prey OpenCL GPU simulation.
+ *
+ * If `PP_GRASS_LAZY` is defined, grass counters keep the iteration at which
+ * grass regrows, and are not decremented by the grass kernel.
  */
 
 //#pragma OPENCL EXTENSION cl_khr_global_int32_base_atomics : enable
@@ -180,7 +183,7 @@ __kernel void BitonicSort(__global PPGSAgent * agents,
 
 
 /*
- * Grass kernel
+ * Grass kernel (only resets agent counts with lazy grass)
  */
 __kernel void Grass(__global uint * matrix,
 			const PPGSSimParams sim_params)
@@ -190,10 +193,12 @@ __kernel void Grass(__global uint * matrix,
 	uint y = get_global_id(1);
 	// Check if this thread will do anything
 	if ((x < sim_params.size_x) && (y < sim_params.size_y)) {
-		// Decrement counter if grass is dead
 		uint index = sim_params.grid_cell_space*(x + sim_params.size_x * y);
+#ifndef PP_GRASS_LAZY
+		// Decrement counter if grass is dead
 		if (matrix[index] > 0)
 			matrix[index]--;
+#endif
 		// Set number of agents in this place to zero
 		matrix[index + CELL_NUMPPGSAgentS_OFFSET] = 0;
 		matrix[index + CELL_AGINDEX_OFFSET] = sim_params.max_agents;
@@ -307,12 +312,14 @@ __kernel void CountAgents2(__global uint2 * gcounter,
 __kernel void CountGrass1(__global uint * grass,
 			__global uint * gcounter,
 			__local uint * lcounter,
-			const PPGSSimParams sim_params)
+			const PPGSSimParams sim_params,
+			__global uint * iter)
 {
 	uint gid = get_global_id(0);
 	uint lid = get_local_id(0);
 	if (gid < sim_params.size_xy) {
-		lcounter[lid] = (grass[gid * sim_params.grid_cell_space] == 0 ? 1 : 0);
+		lcounter[lid] = PP_GRASS_ALIVE(
+			grass[gid * sim_params.grid_cell_space], iter[0]) ? 1 : 0;
 	} else {
 		lcounter[lid] = 0;
 	}
@@ -381,12 +388,15 @@ PPGSAgent agentReproduction(__global PPGSAgent * agents, PPGSAgent agent, __glob
 PPGSAgent sheepAction( PPGSAgent sheep,
 		__global uint * matrix,
 		const PPGSSimParams sim_params,
-		__global PPAgentParamsOcl * params)
+		__global PPAgentParamsOcl * params,
+		uint iter)
 {
 	// If there is grass, eat it (and I can be the only one to do so)!
 	uint index = (sheep.x + sheep.y * sim_params.size_x) * sim_params.grid_cell_space;
-	uint grassState = atomic_cmpxchg(&matrix[index], (uint) 0, (uint) sim_params.grass_restart);
-	if (grassState == 0) {
+	uint grassState = matrix[index];
+	if (PP_GRASS_ALIVE(grassState, iter)
+		&& (atomic_cmpxchg(&matrix[index], grassState,
+			PP_GRASS_EATEN(iter, sim_params.grass_restart)) == grassState)) {
 		// There is grass, sheep eats it and gains energy (if wolf didn't eat her mean while!)
 		sheep.energy += params[SHEEP_ID].gain_from_food;
 	}
@@ -435,7 +445,8 @@ __kernel void AgentAction( __global PPGSAgent * agents,
 			const PPGSSimParams sim_params,
 			__global PPAgentParamsOcl * params,
 			__global clo_statetype * seeds,
-			__global uint * num_agents)
+			__global uint * num_agents,
+			__global uint * iter)
 {
 	// Global id for this work-item
 	uint gid = get_global_id(0);
@@ -445,7 +456,7 @@ __kernel void AgentAction( __global PPGSAgent * agents,
 	if (agent.alive) {
 		// Perform specific agent actions
 		switch (agent.type) {
-			case SHEEP_ID : agent = sheepAction(agent, matrix, sim_params, params); break;
+			case SHEEP_ID : agent = sheepAction(agent, matrix, sim_params, params, iter[0]); break;
 			case WOLF_ID : agent = wolfAction(agent, agents, matrix, sim_params, params); break;
 			default : break;
 		}
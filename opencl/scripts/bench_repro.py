@@ -0,0 +1,66 @@
+#!/usr/bin/env python
+#
+# Compare the agent reproduction strategies of the GPU predator-prey
+# simulation (--a-repro fixed|append) across population sizes.
+#
+# Usage: bench_repro.py PP_GPU CONFIGS_DIR [REPS] [EXTRA_PP_GPU_ARGS...]
+#
+# For each configNNNv1.txt file in CONFIGS_DIR and each strategy, runs
+# PP_GPU REPS times (default 5) and prints the mean total time and the
+# mean time of the agent actions kernel. The kernel time requires pp_gpu
+# to be built with the --prof-agg option (PP_PROFILE_OPT).
+
+from __future__ import print_function
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+STRATEGIES = ['fixed', 'append']
+KERNEL = 'K: agent actions'
+
+if len(sys.argv) < 3:
+    print('Usage: %s PP_GPU CONFIGS_DIR [REPS] [EXTRA_PP_GPU_ARGS...]'
+        % sys.argv[0])
+    sys.exit(1)
+
+pp_gpu = sys.argv[1]
+configs_dir = sys.argv[2]
+reps = int(sys.argv[3]) if len(sys.argv) > 3 else 5
+extra = sys.argv[4:]
+
+# Configurations sorted by initial population size
+configs = []
+for name in os.listdir(configs_dir):
+    m = re.match(r'config(\d+)v1\.txt$', name)
+    if m:
+        configs.append((int(m.group(1)), os.path.join(configs_dir, name)))
+configs.sort()
+
+prof_fd, prof_file = tempfile.mkstemp(suffix='.tsv')
+os.close(prof_fd)
+
+def run(config, strategy):
+    out = subprocess.check_output([pp_gpu, '-p', config, '--a-repro',
+        strategy, '-i', prof_file] + extra).decode()
+    total = float(re.search(r'Ellapsed time: (\S+)s', out).group(1))
+    kernel = float('nan')
+    f = open(prof_file, 'r')
+    for l in f:
+        fields = l.rstrip('\n').split('\t')
+        if fields[0].strip('"') == KERNEL:
+            kernel = int(fields[1]) * 1e-9
+    f.close()
+    return total, kernel
+
+print('%8s %8s %12s %12s' % ('size', 'repro', 'total (s)', 'actions (s)'))
+for size, config in configs:
+    for strategy in STRATEGIES:
+        times = [run(config, strategy) for i in range(reps)]
+        total = sum(t[0] for t in times) / reps
+        kernel = sum(t[1] for t in times) / reps
+        print('%8d %8s %12.4e %12.4e' % (size, strategy, total, kernel))
+
+os.remove(prof_file)